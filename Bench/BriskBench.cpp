@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Runs BRISK detector and descriptor extractor on a single thread and then
+// on all of them. Checks both runs give exactly the same keypoints and
+// descriptors and reports how much time each takes. Returns non-zero if
+// outputs differ.
+
+#include "Plugin.BRISK/brisk.h"
+
+#include "Kommon/HighResolutionClock.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// Random noise with blocks and discs of different sizes so every octave
+// gets its share of corners
+cv::Mat syntheticImage(int rows, int cols)
+{
+    cv::Mat image(rows, cols, CV_8UC1);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(24));
+
+    for(int y = 0; y < rows; ++y)
+    {
+        uchar* row = image.ptr<uchar>(y);
+        for(int x = 0; x < cols; ++x)
+        {
+            if(((x / 37) + (y / 29)) % 2 == 0)
+                row[x] += 120;
+        }
+    }
+
+    cv::RNG rng(5);
+    for(int i = 0; i < 300; ++i)
+    {
+        int cx = rng.uniform(0, cols);
+        int cy = rng.uniform(0, rows);
+        int radius = rng.uniform(3, 18);
+        uchar value = static_cast<uchar>(rng.uniform(0, 256));
+
+        for(int y = max(0, cy - radius); y < min(rows, cy + radius); ++y)
+        {
+            uchar* row = image.ptr<uchar>(y);
+            for(int x = max(0, cx - radius); x < min(cols, cx + radius); ++x)
+            {
+                if((x - cx) * (x - cx) + (y - cy) * (y - cy) < radius * radius)
+                    row[x] = value;
+            }
+        }
+    }
+
+    return image;
+}
+
+struct BriskResult
+{
+    vector<cv::KeyPoint> keypoints;
+    cv::Mat descriptors;
+    double detectTime;
+    double describeTime;
+};
+
+BriskResult runBrisk(const cv::Mat& image, int threshold, int octaves)
+{
+    BriskResult result;
+
+    HighResolutionClock::time_point start = HighResolutionClock::now();
+    cv::BriskFeatureDetector detector(threshold, octaves);
+    detector.detect(image, result.keypoints);
+    result.detectTime = convertToMilliseconds(HighResolutionClock::now() - start);
+
+    start = HighResolutionClock::now();
+    cv::BriskDescriptorExtractor extractor;
+    extractor.compute(image, result.keypoints, result.descriptors);
+    result.describeTime = convertToMilliseconds(HighResolutionClock::now() - start);
+
+    return result;
+}
+
+bool sameKeypoints(const vector<cv::KeyPoint>& a, const vector<cv::KeyPoint>& b)
+{
+    if(a.size() != b.size())
+        return false;
+
+    for(size_t i = 0; i < a.size(); ++i)
+    {
+        if(a[i].pt != b[i].pt || a[i].size != b[i].size
+                || a[i].angle != b[i].angle || a[i].response != b[i].response
+                || a[i].octave != b[i].octave)
+            return false;
+    }
+
+    return true;
+}
+
+bool sameDescriptors(const cv::Mat& a, const cv::Mat& b)
+{
+    if(a.size() != b.size() || a.type() != b.type())
+        return false;
+    return a.empty() || cv::norm(a, b, cv::NORM_INF) == 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    int rows = 720, cols = 1280;
+    if(argc > 2)
+    {
+        rows = stoi(argv[1]);
+        cols = stoi(argv[2]);
+    }
+
+    const int numThreads = cv::getNumThreads();
+    bool same = true;
+
+    try
+    {
+        cv::Mat image = syntheticImage(rows, cols);
+
+        cout << setw(8) << "Octaves"
+             << setw(12) << "Keypoints"
+             << setw(16) << "Detect 1T [ms]"
+             << setw(16) << "Detect NT [ms]"
+             << setw(18) << "Describe 1T [ms]"
+             << setw(18) << "Describe NT [ms]"
+             << setw(8) << "Same" << "\n";
+
+        for(int octaves = 0; octaves <= 4; ++octaves)
+        {
+            cv::setNumThreads(1);
+            BriskResult serial = runBrisk(image, 30, octaves);
+            cv::setNumThreads(numThreads);
+            BriskResult parallel = runBrisk(image, 30, octaves);
+
+            bool octavesSame = sameKeypoints(serial.keypoints, parallel.keypoints)
+                && sameDescriptors(serial.descriptors, parallel.descriptors);
+            same = same && octavesSame;
+
+            cout << setw(8) << octaves
+                 << setw(12) << serial.keypoints.size()
+                 << setw(16) << fixed << setprecision(1) << serial.detectTime
+                 << setw(16) << parallel.detectTime
+                 << setw(18) << serial.describeTime
+                 << setw(18) << parallel.describeTime
+                 << setw(8) << (octavesSame ? "yes" : "no") << "\n";
+        }
+    }
+    catch(exception& ex)
+    {
+        cv::setNumThreads(numThreads);
+        cerr << "Error: " << ex.what() << endl;
+        return 1;
+    }
+
+    if(!same)
+    {
+        cerr << "Error: parallel BRISK output differs from single-threaded one" << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Compares summed-area table based Kuwahara filter against the windowed one.
+// Checks both give the same output (within rounding) for every radius and
+// reports how much time each takes. Returns non-zero if outputs differ.
+// Also times generalized and anisotropic Kuwahara filters.
+
+#include "Plugin.Kuwahara/cvu.h"
+
+#include "Kommon/HighResolutionClock.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Random noise mixed with blocks so windows see both flat and busy areas
+cv::Mat syntheticImage(int rows, int cols, int type)
+{
+    cv::Mat image(rows, cols, type);
+    cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+
+    for(int y = 0; y < rows; ++y)
+    {
+        uchar* row = image.ptr<uchar>(y);
+        for(int x = 0; x < cols * image.channels(); ++x)
+        {
+            if(((x / 24) + (y / 16)) % 3 == 0)
+                row[x] = static_cast<uchar>((x / 24) * 40 + (y / 16) * 10);
+        }
+    }
+
+    return image;
+}
+
+int maxAbsDifference(const cv::Mat& a, const cv::Mat& b)
+{
+    cv::Mat diff;
+    cv::absdiff(a, b, diff);
+    double maxVal = 0;
+    cv::minMaxLoc(diff.reshape(1), nullptr, &maxVal);
+    return static_cast<int>(maxVal);
+}
+
+template <class Func>
+double measureMilliseconds(Func&& func)
+{
+    HighResolutionClock::time_point start = HighResolutionClock::now();
+    func();
+    return convertToMilliseconds(HighResolutionClock::now() - start);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    // Maximum allowed difference between methods (rounding)
+    const int tolerance = 1;
+    int rows = 720, cols = 1280;
+    if(argc > 2)
+    {
+        rows = stoi(argv[1]);
+        cols = stoi(argv[2]);
+    }
+
+    bool accurate = true;
+
+    try
+    {
+        cout << setw(8) << "Format"
+             << setw(8) << "Radius"
+             << setw(14) << "Window [ms]"
+             << setw(14) << "SAT [ms]"
+             << setw(10) << "Max diff" << "\n";
+
+        for(int type : {CV_8UC1, CV_8UC3})
+        {
+            cv::Mat src = syntheticImage(rows, cols, type);
+
+            for(int radius = 1; radius <= 15; ++radius)
+            {
+                cv::Mat window, integral;
+                double windowTime = measureMilliseconds([&] {
+                    cvu::KuwaharaFilter(src, window, radius);
+                });
+                double integralTime = measureMilliseconds([&] {
+                    cvu::KuwaharaFilterIntegral(src, integral, radius);
+                });
+                int diff = maxAbsDifference(window, integral);
+                accurate = accurate && diff <= tolerance;
+
+                cout << setw(8) << (type == CV_8UC1 ? "Gray" : "BGR")
+                     << setw(8) << radius
+                     << setw(14) << fixed << setprecision(1) << windowTime
+                     << setw(14) << integralTime
+                     << setw(10) << diff << "\n";
+            }
+        }
+
+        // Sector based filters with their default parameters
+        cout << "\n" << setw(8) << "Format"
+             << setw(20) << "Generalized [ms]"
+             << setw(20) << "Anisotropic [ms]" << "\n";
+
+        for(int type : {CV_8UC1, CV_8UC3})
+        {
+            cv::Mat src = syntheticImage(rows, cols, type), dst;
+            double generalizedTime = measureMilliseconds([&] {
+                cvu::generalizedKuwaharaFilter(src, dst);
+            });
+            double anisotropicTime = measureMilliseconds([&] {
+                cvu::anisotropicKuwaharaFilter(src, dst);
+            });
+
+            cout << setw(8) << (type == CV_8UC1 ? "Gray" : "BGR")
+                 << setw(20) << fixed << setprecision(1) << generalizedTime
+                 << setw(20) << anisotropicTime << "\n";
+        }
+    }
+    catch(exception& ex)
+    {
+        cerr << "Error: " << ex.what() << endl;
+        return 1;
+    }
+
+    if(!accurate)
+    {
+        cerr << "Error: summed-area table output differs from windowed filter" << endl;
+        return 1;
+    }
+
+    return 0;
+}
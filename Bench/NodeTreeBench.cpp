@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Micro-benchmark of NodeTree graph queries on large synthetic trees.
+// Reports per-query cost for several tree sizes so it's easy to see
+// whether it stays constant as the tree grows. Checks first that executed
+// nodes are untagged unless they ask for it (or fail).
+
+#include "Logic/NodeSystem.h"
+#include "Logic/NodeTree.h"
+#include "Logic/NodeType.h"
+#include "Logic/NodeFactory.h"
+#include "Logic/NodeLink.h"
+#include "Logic/NodeException.h"
+
+#include "Kommon/HighResolutionClock.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+// Keeps compiler from optimizing measured queries away
+volatile size_t benchmarkSink = 0;
+
+class SyntheticSourceNodeType : public NodeType
+{
+public:
+    SyntheticSourceNodeType()
+    {
+        addOutput("Output", ENodeFlowDataType::Image);
+    }
+
+    ExecutionStatus execute(NodeSocketReader&, NodeSocketWriter&) override
+    {
+        return ExecutionStatus(EStatus::Ok);
+    }
+};
+
+class SyntheticBinaryNodeType : public NodeType
+{
+public:
+    SyntheticBinaryNodeType()
+    {
+        addInput("Source 1", ENodeFlowDataType::Image);
+        addInput("Source 2", ENodeFlowDataType::Image);
+        addOutput("Output", ENodeFlowDataType::Image);
+    }
+
+    ExecutionStatus execute(NodeSocketReader&, NodeSocketWriter&) override
+    {
+        return ExecutionStatus(EStatus::Ok);
+    }
+};
+
+// Source of a two frames long stream - asks to be executed again until it ends
+class SyntheticStreamNodeType : public NodeType
+{
+public:
+    SyntheticStreamNodeType()
+        : _framesLeft(2)
+    {
+        addOutput("Output", ENodeFlowDataType::Image);
+    }
+
+    ExecutionStatus execute(NodeSocketReader&, NodeSocketWriter&) override
+    {
+        return ExecutionStatus(--_framesLeft > 0 ? EStatus::Tag : EStatus::Ok);
+    }
+
+private:
+    int _framesLeft;
+};
+
+class SyntheticThrowingNodeType : public NodeType
+{
+public:
+    SyntheticThrowingNodeType()
+    {
+        addOutput("Output", ENodeFlowDataType::Image);
+    }
+
+    ExecutionStatus execute(NodeSocketReader&, NodeSocketWriter&) override
+    {
+        throw runtime_error("synthetic failure");
+    }
+};
+
+struct SyntheticTree
+{
+    unique_ptr<NodeTree> tree;
+    vector<NodeID> nodes;
+    double buildTime;
+};
+
+// Every binary node takes its inputs from two randomly chosen earlier 
+// nodes (at most 'window' nodes back) which gives long, wide DAG
+SyntheticTree buildTree(NodeSystem& nodeSystem, NodeTypeID sourceType, 
+                        NodeTypeID binaryType, size_t numNodes)
+{
+    const size_t numSources = 16;
+    const size_t window = 64;
+
+    SyntheticTree ret;
+    ret.tree = nodeSystem.createNodeTree();
+    mt19937 rng(1234);
+
+    HighResolutionClock::time_point start = HighResolutionClock::now();
+
+    for(size_t i = 0; i < numNodes; ++i)
+    {
+        NodeTypeID typeID = i < numSources ? sourceType : binaryType;
+        NodeID nodeID = ret.tree->createNode(typeID, "node" + to_string(i));
+        if(nodeID == InvalidNodeID)
+            throw runtime_error("couldn't create node");
+
+        if(i >= numSources)
+        {
+            for(SocketID socketID = 0; socketID < 2; ++socketID)
+            {
+                size_t from = i - 1 - rng() % min(i, window);
+                ret.tree->linkNodes(SocketAddress(ret.nodes[from], 0, true), 
+                                    SocketAddress(nodeID, socketID, false));
+            }
+        }
+
+        ret.nodes.push_back(nodeID);
+    }
+
+    ret.buildTime = convertToMilliseconds(HighResolutionClock::now() - start);
+    return ret;
+}
+
+// Executed nodes are untagged (so execute list of the UI becomes empty once
+// a stream ends) unless they returned EStatus::Tag or failed
+void checkTagging(NodeSystem& nodeSystem, NodeTypeID sourceType, NodeTypeID binaryType,
+                  NodeTypeID streamType, NodeTypeID throwingType, bool parallel)
+{
+    auto expectList = [](NodeTree& tree, vector<NodeID> expected, const char* what) {
+        vector<NodeID> list = tree.prepareList();
+        sort(begin(list), end(list));
+        sort(begin(expected), end(expected));
+        if(list != expected)
+            throw runtime_error(string("tagging check failed: ") + what);
+    };
+
+    unique_ptr<NodeTree> tree = nodeSystem.createNodeTree();
+    tree->setParallelExecution(parallel);
+    NodeID source = tree->createNode(sourceType, "source");
+    NodeID stream = tree->createNode(streamType, "stream");
+    NodeID binary = tree->createNode(binaryType, "binary");
+    tree->linkNodes(SocketAddress(source, 0, true), SocketAddress(binary, 0, false));
+    tree->linkNodes(SocketAddress(stream, 0, true), SocketAddress(binary, 1, false));
+
+    tree->execute(true);
+    expectList(*tree, {stream, binary}, "only stream and its descendant run again");
+
+    tree->execute(false);
+    expectList(*tree, {}, "nothing runs again once stream ends");
+
+    unique_ptr<NodeTree> failing = nodeSystem.createNodeTree();
+    failing->setParallelExecution(parallel);
+    NodeID throwing = failing->createNode(throwingType, "throwing");
+    try
+    {
+        failing->execute(true);
+        throw runtime_error("tagging check failed: exception wasn't propagated");
+    }
+    catch(ExecutionError&)
+    {
+    }
+    expectList(*failing, {throwing}, "node that threw runs again");
+}
+
+template <class Func>
+double measureNanoseconds(size_t numQueries, Func&& func)
+{
+    HighResolutionClock::time_point start = HighResolutionClock::now();
+    func();
+    double elapsed = convertToMilliseconds(HighResolutionClock::now() - start);
+    return elapsed * 1e6 / static_cast<double>(numQueries);
+}
+
+void runBenchmark(NodeSystem& nodeSystem, NodeTypeID sourceType,
+                  NodeTypeID binaryType, size_t numNodes)
+{
+    const int repeats = 10;
+
+    SyntheticTree st = buildTree(nodeSystem, sourceType, binaryType, numNodes);
+    NodeTree& tree = *st.tree;
+    size_t sink = 0;
+
+    double connectedFromTime = measureNanoseconds(repeats * numNodes * 2, [&] {
+        for(int r = 0; r < repeats; ++r)
+            for(NodeID nodeID : st.nodes)
+                for(SocketID socketID = 0; socketID < 2; ++socketID)
+                    sink += tree.connectedFrom(SocketAddress(nodeID, socketID, false)).node;
+    });
+
+    double executableTime = measureNanoseconds(repeats * numNodes, [&] {
+        for(int r = 0; r < repeats; ++r)
+            for(NodeID nodeID : st.nodes)
+                sink += tree.isNodeExecutable(nodeID);
+    });
+
+    // Whole tree is tagged right after it's been built
+    tree.prepareList();
+    double taggedTime = measureNanoseconds(repeats * numNodes, [&] {
+        for(int r = 0; r < repeats; ++r)
+            for(NodeID nodeID : st.nodes)
+                sink += tree.taggedButNotExecuted(nodeID);
+    });
+
+    // Relinking last node only touches small part of the tree
+    NodeID lastID = st.nodes.back();
+    SocketAddress lastInput(lastID, 0, false);
+    SocketAddress lastSource = tree.connectedFrom(lastInput);
+    double relinkTime = measureNanoseconds(repeats, [&] {
+        for(int r = 0; r < repeats; ++r)
+        {
+            tree.unlinkNodes(lastSource, lastInput);
+            if(tree.linkNodes(lastSource, lastInput) != ELinkNodesResult::Ok)
+                throw runtime_error("couldn't relink node");
+        }
+    });
+
+    benchmarkSink = sink;
+
+    cout << setw(8) << numNodes
+         << setw(14) << fixed << setprecision(1) << st.buildTime
+         << setw(16) << setprecision(1) << connectedFromTime
+         << setw(16) << executableTime
+         << setw(16) << taggedTime
+         << setw(14) << setprecision(3) << relinkTime * 1e-6 << "\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    vector<size_t> sizes = {1000, 2500, 5000, 10000};
+    if(argc > 1)
+    {
+        sizes.clear();
+        for(int i = 1; i < argc; ++i)
+            sizes.push_back(stoul(argv[i]));
+    }
+
+    try
+    {
+        NodeSystem nodeSystem;
+        NodeTypeID sourceType = nodeSystem.registerNodeType("Bench/Source",
+            unique_ptr<NodeFactory>(new DefaultNodeFactory<SyntheticSourceNodeType>()));
+        NodeTypeID binaryType = nodeSystem.registerNodeType("Bench/Binary",
+            unique_ptr<NodeFactory>(new DefaultNodeFactory<SyntheticBinaryNodeType>()));
+        NodeTypeID streamType = nodeSystem.registerNodeType("Bench/Stream",
+            unique_ptr<NodeFactory>(new DefaultNodeFactory<SyntheticStreamNodeType>()));
+        NodeTypeID throwingType = nodeSystem.registerNodeType("Bench/Throwing",
+            unique_ptr<NodeFactory>(new DefaultNodeFactory<SyntheticThrowingNodeType>()));
+
+        for(bool parallel : {false, true})
+            checkTagging(nodeSystem, sourceType, binaryType, streamType, throwingType, parallel);
+
+        cout << setw(8) << "Nodes"
+             << setw(14) << "Build [ms]"
+             << setw(16) << "connFrom [ns]"
+             << setw(16) << "exec? [ns]"
+             << setw(16) << "tagged? [ns]"
+             << setw(14) << "relink [ms]" << "\n";
+
+        for(size_t numNodes : sizes)
+            runBenchmark(nodeSystem, sourceType, binaryType, numNodes);
+    }
+    catch(exception& ex)
+    {
+        cerr << "Error: " << ex.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
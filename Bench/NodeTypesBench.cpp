@@ -0,0 +1,647 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+// Throughput benchmark of registered node types. Each node type is fed
+// with synthetic inputs at several resolutions and executed repeatedly.
+// Inputs that can't be synthesized directly (keypoints, descriptors,
+// matches, ...) are produced by other node types which run only once.
+
+#include "Logic/NodeSystem.h"
+#include "Logic/NodeTree.h"
+#include "Logic/NodeType.h"
+#include "Logic/NodeFactory.h"
+#include "Logic/NodeLink.h"
+#include "Logic/NodeException.h"
+
+#include "Logic/OpenCL/IGpuNodeModule.h"
+
+#include "Kommon/HighResolutionClock.h"
+#include "Kommon/ModulePath.h"
+#include "Kommon/StringUtils.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <regex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+#if K_SYSTEM == K_SYSTEM_WINDOWS
+const QString pluginExtensionName = QStringLiteral("*.dll");
+#elif K_SYSTEM == K_SYSTEM_LINUX
+const QString pluginExtensionName = QStringLiteral("*.so");
+#endif
+
+struct Resolution
+{
+    string name;
+    int width;
+    int height;
+};
+
+const vector<Resolution> allResolutions = {
+    {"vga", 640, 480},
+    {"1080p", 1920, 1080},
+    {"4k", 3840, 2160}
+};
+
+struct Options
+{
+    string filter;
+    vector<Resolution> resolutions = allResolutions;
+    vector<string> plugins;
+    string csvPath;
+    double minTime = 250.0;
+    int minIterations = 3;
+    bool useGpu = false;
+    bool list = false;
+};
+
+enum class ESyntheticImage
+{
+    Gray,
+    Rgb,
+    Mask
+};
+
+// Deterministic image with a mix of edges, corners and blobs so 
+// feature detectors have something to work on
+template <ESyntheticImage Kind>
+class SyntheticImageNodeType : public NodeType
+{
+public:
+    SyntheticImageNodeType()
+        : _width(640)
+        , _height(480)
+    {
+        addOutput("Output", Kind == ESyntheticImage::Rgb 
+            ? ENodeFlowDataType::ImageRgb
+            : ENodeFlowDataType::ImageMono);
+        addProperty("Width", _width);
+        addProperty("Height", _height);
+    }
+
+    ExecutionStatus execute(NodeSocketReader&, NodeSocketWriter& writer) override
+    {
+        const int channels = Kind == ESyntheticImage::Rgb ? 3 : 1;
+        NodeFlowData& socket = writer.acquireSocket(0);
+        cv::Mat& output = Kind == ESyntheticImage::Rgb 
+            ? socket.getImageRgb() 
+            : socket.getImageMono();
+        output.create(_height, _width, CV_MAKETYPE(CV_8U, channels));
+        output.setTo(cv::Scalar::all(32));
+
+        cv::RNG rng(0xB3AC4);
+        const int numShapes = std::max(16, (_width * _height) / 4096);
+        for(int i = 0; i < numShapes; ++i)
+        {
+            cv::Point center(rng.uniform(0, _width), rng.uniform(0, _height));
+            cv::Scalar color(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+            int size = rng.uniform(4, 48);
+
+            switch(i % 3)
+            {
+            case 0:
+                cv::rectangle(output, center, center + cv::Point(size, size / 2 + 2), 
+                    color, CV_FILLED);
+                break;
+            case 1:
+                cv::circle(output, center, size / 2, color, CV_FILLED);
+                break;
+            case 2:
+                cv::line(output, center, center + cv::Point(size, -size), color, 2);
+                break;
+            }
+        }
+
+        cv::GaussianBlur(output, output, cv::Size(3, 3), 0);
+
+        if(Kind == ESyntheticImage::Mask)
+            cv::threshold(output, output, 127, 255, cv::THRESH_BINARY);
+
+        return ExecutionStatus(EStatus::Ok);
+    }
+
+private:
+    TypedNodeProperty<int> _width;
+    TypedNodeProperty<int> _height;
+};
+
+const string syntheticGrayName = "Bench/Synthetic gray image";
+const string syntheticRgbName = "Bench/Synthetic RGB image";
+const string syntheticMaskName = "Bench/Synthetic mask";
+
+// Tells which node (and its output) provides data for given input socket.
+// Empty consumer/socket matches any. Rules are checked in order.
+struct InputProvider
+{
+    string consumerPrefix;
+    string socketName;
+    ENodeFlowDataType type;
+    string providerType;
+    string providerOutput;
+};
+
+const vector<InputProvider> inputProviders = {
+    {"", "Structuring element", ENodeFlowDataType::ImageMono, 
+        "Morphology/Structuring element", "Structuring element"},
+    {"", "Mask", ENodeFlowDataType::ImageMono, syntheticMaskName, "Output"},
+    // Hough transform is meant to work on edges
+    {"Features/Hough Lines", "", ENodeFlowDataType::ImageMono, 
+        "Features/Canny edge detector", "Output"},
+    {"", "", ENodeFlowDataType::Keypoints, "Features/SURF", "Keypoints"},
+    {"", "Query descriptors", ENodeFlowDataType::Array, "Features/SURF", "Descriptors"},
+    {"", "Train descriptors", ENodeFlowDataType::Array, "Features/SURF", "Descriptors"},
+    {"", "Descriptors", ENodeFlowDataType::Array, "Features/SURF", "Descriptors"},
+    {"", "", ENodeFlowDataType::Matches, "Features/BForce Matcher", "Matches"},
+    {"", "Homography", ENodeFlowDataType::Array, "Features/Estimate homography", "Homography"},
+    {"", "Shapes", ENodeFlowDataType::Array, "Features/Hough Lines", "Lines"},
+    {"", "", ENodeFlowDataType::Image, syntheticGrayName, "Output"},
+    {"", "", ENodeFlowDataType::ImageMono, syntheticGrayName, "Output"},
+    {"", "", ENodeFlowDataType::ImageRgb, syntheticRgbName, "Output"},
+#if defined(HAVE_OPENCL)
+    {"", "", ENodeFlowDataType::DeviceImage, "OpenCL/Upload image", "Device image"},
+    {"", "", ENodeFlowDataType::DeviceImageMono, "OpenCL/Upload image", "Device image"},
+#endif
+};
+
+const InputProvider* findInputProvider(const string& consumerType, const SocketConfig& input)
+{
+    for(const auto& provider : inputProviders)
+    {
+        if(provider.type != input.type())
+            continue;
+        if(!provider.socketName.empty() && provider.socketName != input.name())
+            continue;
+        if(consumerType.compare(0, provider.consumerPrefix.size(), provider.consumerPrefix) != 0)
+            continue;
+        // Provider can't feed itself
+        if(provider.providerType == consumerType)
+            continue;
+        return &provider;
+    }
+
+    return nullptr;
+}
+
+SocketID findOutput(const NodeConfig& config, const string& name)
+{
+    for(const auto& output : config.outputs())
+    {
+        if(output.name() == name)
+            return output.socketID();
+    }
+    return InvalidSocketID;
+}
+
+// Builds tree with given node and everything that's needed to feed its inputs
+class BenchmarkCase
+{
+public:
+    BenchmarkCase(NodeSystem& nodeSystem, const Resolution& resolution)
+        : _nodeSystem(nodeSystem)
+        , _tree(nodeSystem.createNodeTree())
+        , _resolution(resolution)
+    {
+        // Each iteration needs to do the actual work
+        _tree->setMemoizationEnabled(false);
+    }
+
+    NodeID build(const string& typeName)
+    {
+        return createNodeWithInputs(typeName, 0);
+    }
+
+    NodeTree& tree() { return *_tree; }
+
+private:
+    NodeID createNodeWithInputs(const string& typeName, int depth)
+    {
+        if(depth > 4)
+            throw runtime_error("too deep chain of input providers");
+
+        NodeTypeID typeID = _nodeSystem.nodeTypeID(typeName);
+        if(typeID == InvalidNodeTypeID)
+            throw runtime_error(string_format("missing node type %s", typeName.c_str()));
+
+        NodeID nodeID = _tree->createNode(typeID, _tree->generateNodeName(typeID));
+        if(nodeID == InvalidNodeID)
+            throw runtime_error(string_format("couldn't create %s", typeName.c_str()));
+
+        const NodeConfig& config = _tree->nodeConfiguration(nodeID);
+
+        if(typeName.compare(0, 6, "Bench/") == 0)
+        {
+            _tree->nodeSetProperty(nodeID, 0, NodeProperty{_resolution.width});
+            _tree->nodeSetProperty(nodeID, 1, NodeProperty{_resolution.height});
+        }
+
+        for(const auto& input : config.inputs())
+        {
+            const InputProvider* provider = findInputProvider(typeName, input);
+            if(!provider)
+            {
+                throw runtime_error(string_format("no synthetic data for input '%s' (%s)", 
+                    input.name().c_str(), std::to_string(input.type()).c_str()));
+            }
+
+            // Providers are shared so e.g. matcher gets keypoints and 
+            // descriptors from the same detector
+            auto iter = _providers.find(provider->providerType);
+            NodeID providerID = iter != _providers.end()
+                ? iter->second
+                : createNodeWithInputs(provider->providerType, depth + 1);
+            _providers[provider->providerType] = providerID;
+
+            SocketID outputID = findOutput(_tree->nodeConfiguration(providerID), 
+                provider->providerOutput);
+            if(outputID == InvalidSocketID ||
+               _tree->linkNodes(SocketAddress(providerID, outputID, true),
+                    SocketAddress(nodeID, input.socketID(), false)) != ELinkNodesResult::Ok)
+            {
+                throw runtime_error(string_format("couldn't connect input '%s'", 
+                    input.name().c_str()));
+            }
+        }
+
+        return nodeID;
+    }
+
+private:
+    NodeSystem& _nodeSystem;
+    unique_ptr<NodeTree> _tree;
+    Resolution _resolution;
+    map<string, NodeID> _providers;
+};
+
+struct BenchmarkResult
+{
+    string typeName;
+    string resolution;
+    int iterations = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double megapixelsPerSecond = 0.0;
+    string error;
+};
+
+// GPU nodes return before their device outputs are computed. Returns true
+// if there was any such output to wait for
+bool waitForDeviceOutputs(const NodeTree& tree, NodeID nodeID)
+{
+    bool waited = false;
+#if defined(HAVE_OPENCL)
+    const NodeConfig& nodeConfig = tree.nodeConfiguration(nodeID);
+    for(SocketID socketID = 0; socketID < nodeConfig.outputs().size(); ++socketID)
+    {
+        const NodeFlowData& data = tree.outputSocket(nodeID, socketID);
+        switch(data.type())
+        {
+        case ENodeFlowDataType::DeviceImage:
+        case ENodeFlowDataType::DeviceImageMono:
+        case ENodeFlowDataType::DeviceImageRgb:
+        case ENodeFlowDataType::DeviceArray:
+            data.waitForDeviceData();
+            waited = true;
+            break;
+        default:
+            break;
+        }
+    }
+#else
+    (void) tree;
+    (void) nodeID;
+#endif
+    return waited;
+}
+
+BenchmarkResult runCase(NodeSystem& nodeSystem, const string& typeName,
+                        const Resolution& resolution, const Options& options)
+{
+    BenchmarkResult result;
+    result.typeName = typeName;
+    result.resolution = resolution.name;
+
+    try
+    {
+        BenchmarkCase bench(nodeSystem, resolution);
+        NodeID nodeID = bench.build(typeName);
+        NodeTree& tree = bench.tree();
+
+        // First run initializes modules and computes all the inputs
+        tree.execute(true);
+
+        vector<double> times;
+        double total = 0.0;
+        while((total < options.minTime || 
+               static_cast<int>(times.size()) < options.minIterations) && times.size() < 10000)
+        {
+            tree.tagNode(nodeID);
+            HighResolutionClock::time_point start = HighResolutionClock::now();
+            tree.execute();
+            double elapsed = waitForDeviceOutputs(tree, nodeID)
+                ? convertToMilliseconds(HighResolutionClock::now() - start)
+                : tree.nodeTimeElapsed(nodeID);
+            times.push_back(elapsed);
+            // Don't spin forever on nodes with sub-timer resolution
+            total += std::max(elapsed, 0.001);
+        }
+
+        tree.notifyFinish();
+
+        result.iterations = static_cast<int>(times.size());
+        result.mean = total / times.size();
+        result.min = *std::min_element(begin(times), end(times));
+        if(result.mean > 0.0)
+        {
+            result.megapixelsPerSecond = (resolution.width * resolution.height * 1e-6) 
+                / (result.mean * 1e-3);
+        }
+    }
+    catch(ExecutionError& ex)
+    {
+        result.error = ex.errorMessage;
+    }
+    catch(exception& ex)
+    {
+        result.error = ex.what();
+    }
+
+    return result;
+}
+
+bool isBenchmarkable(const NodeSystem& nodeSystem, const string& typeName, 
+                     const Options& options, string& reason)
+{
+    static const vector<string> excludedPrefixes = {"Bench/", "Sources/", "Sink/"};
+    for(const auto& prefix : excludedPrefixes)
+    {
+        if(typeName.compare(0, prefix.size(), prefix) == 0)
+        {
+            reason = "excluded category";
+            return false;
+        }
+    }
+
+    if(!options.filter.empty() && !regex_search(typeName, regex(options.filter)))
+        return false;
+
+    unique_ptr<NodeType> nodeType = nodeSystem.createNode(nodeSystem.nodeTypeID(typeName));
+    if(!nodeType || nodeType->inputs().empty())
+    {
+        reason = "no inputs";
+        return false;
+    }
+
+    if(!nodeType->module().empty() && !options.useGpu)
+    {
+        reason = "requires module " + nodeType->module();
+        return false;
+    }
+
+    return true;
+}
+
+void loadPlugins(NodeSystem& nodeSystem, const vector<string>& extraPlugins)
+{
+    QFileInfo execInfo(QString::fromStdString(executablePath()));
+    QDir pluginDir = execInfo.absoluteDir();
+
+    vector<string> plugins;
+    if(pluginDir.cd(QStringLiteral("plugins")))
+    {
+        for(const auto& pluginInfo : pluginDir.entryInfoList(
+                QStringList(pluginExtensionName), QDir::Files))
+            plugins.push_back(pluginInfo.absoluteFilePath().toStdString());
+    }
+    plugins.insert(end(plugins), begin(extraPlugins), end(extraPlugins));
+
+    for(const auto& plugin : plugins)
+    {
+        try
+        {
+            nodeSystem.loadPlugin(plugin);
+        }
+        catch(exception& ex)
+        {
+            cerr << "Couldn't load plugin " << plugin << " - details: " << ex.what() << endl;
+        }
+    }
+}
+
+void printUsage()
+{
+    cout << "Usage: Mouve.Bench [options]\n"
+        "Options:\n"
+        "  -f, --filter <regex>               Benchmark only matching node types\n"
+        "  -r, --resolution <name>            vga, 1080p or 4k (repeatable,\n"
+        "                                     default: all of them)\n"
+        "  -t, --min-time <ms>                Minimum measured time per case (default: 250)\n"
+        "  -n, --min-iterations <count>       Minimum iterations per case (default: 3)\n"
+        "      --csv <file>                   Save results as CSV\n"
+        "      --plugin <path>                Load additional plugin (repeatable)\n"
+        "      --gpu                          Initialize OpenCL module and benchmark its nodes\n"
+        "  -l, --list                         List node types that would be benchmarked\n"
+        "  -h, --help                         Show this help\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    auto nextValue = [&](int& i) -> string {
+        if(i + 1 >= argc)
+            throw invalid_argument(string_format("Missing value for %s", argv[i]));
+        return argv[++i];
+    };
+
+    bool defaultResolutions = true;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if(arg == "-h" || arg == "--help")
+            return false;
+        else if(arg == "-f" || arg == "--filter")
+            options.filter = nextValue(i);
+        else if(arg == "-r" || arg == "--resolution")
+        {
+            string name = nextValue(i);
+            auto iter = find_if(begin(allResolutions), end(allResolutions),
+                [&](const Resolution& res) { return res.name == name; });
+            if(iter == end(allResolutions))
+                throw invalid_argument(string_format("Unknown resolution: %s", name.c_str()));
+            if(defaultResolutions)
+                options.resolutions.clear();
+            defaultResolutions = false;
+            options.resolutions.push_back(*iter);
+        }
+        else if(arg == "-t" || arg == "--min-time")
+            options.minTime = stod(nextValue(i));
+        else if(arg == "-n" || arg == "--min-iterations")
+            options.minIterations = stoi(nextValue(i));
+        else if(arg == "--csv")
+            options.csvPath = nextValue(i);
+        else if(arg == "--plugin")
+            options.plugins.push_back(nextValue(i));
+        else if(arg == "--gpu")
+            options.useGpu = true;
+        else if(arg == "-l" || arg == "--list")
+            options.list = true;
+        else
+            throw invalid_argument(string_format("Unknown option: %s", arg.c_str()));
+    }
+
+    return true;
+}
+
+void printResult(const BenchmarkResult& result)
+{
+    cout << left << setw(48) << result.typeName << setw(8) << result.resolution << right;
+    if(!result.error.empty())
+    {
+        cout << "  failed: " << result.error << "\n";
+        return;
+    }
+
+    cout << setw(8) << result.iterations
+         << setw(12) << fixed << setprecision(3) << result.mean
+         << setw(12) << result.min
+         << setw(12) << setprecision(1) << result.megapixelsPerSecond << "\n";
+}
+
+void saveCsv(const string& path, const vector<BenchmarkResult>& results)
+{
+    ofstream file(path);
+    if(!file)
+        throw runtime_error(string_format("Couldn't open %s for writing", path.c_str()));
+
+    file << "node type,resolution,iterations,mean [ms],min [ms],MPix/s,error\n";
+    for(const auto& result : results)
+    {
+        file << '"' << result.typeName << "\"," << result.resolution << ","
+             << result.iterations << "," << result.mean << "," << result.min << ","
+             << result.megapixelsPerSecond << ",\"" << result.error << "\"\n";
+    }
+}
+
+int run(const Options& options)
+{
+    NodeSystem nodeSystem;
+
+    if(options.useGpu)
+    {
+        shared_ptr<IGpuNodeModule> gpuModule = createGpuModule();
+        if(gpuModule)
+        {
+            gpuModule->setInteractiveInit(false); // Just use default device
+            nodeSystem.registerNodeModule(gpuModule);
+        }
+    }
+
+    loadPlugins(nodeSystem, options.plugins);
+
+    nodeSystem.registerNodeType(syntheticGrayName, unique_ptr<NodeFactory>(
+        new DefaultNodeFactory<SyntheticImageNodeType<ESyntheticImage::Gray>>()));
+    nodeSystem.registerNodeType(syntheticRgbName, unique_ptr<NodeFactory>(
+        new DefaultNodeFactory<SyntheticImageNodeType<ESyntheticImage::Rgb>>()));
+    nodeSystem.registerNodeType(syntheticMaskName, unique_ptr<NodeFactory>(
+        new DefaultNodeFactory<SyntheticImageNodeType<ESyntheticImage::Mask>>()));
+
+    vector<string> typeNames;
+    auto iter = nodeSystem.createNodeTypeIterator();
+    NodeTypeIterator::NodeTypeInfo info;
+    while(iter->next(info))
+    {
+        string reason;
+        if(isBenchmarkable(nodeSystem, info.typeName, options, reason))
+            typeNames.push_back(info.typeName);
+        else if(options.list && !reason.empty())
+            cout << left << setw(48) << info.typeName << "skipped: " << reason << "\n";
+    }
+    sort(begin(typeNames), end(typeNames));
+
+    if(options.list)
+    {
+        for(const auto& typeName : typeNames)
+            cout << typeName << "\n";
+        return 0;
+    }
+
+    cout << left << setw(48) << "Node type" << setw(8) << "Res." << right
+         << setw(8) << "Iters" << setw(12) << "Mean [ms]" << setw(12) << "Min [ms]"
+         << setw(12) << "MPix/s" << "\n";
+
+    vector<BenchmarkResult> results;
+    for(const auto& typeName : typeNames)
+    {
+        for(const auto& resolution : options.resolutions)
+        {
+            results.push_back(runCase(nodeSystem, typeName, resolution, options));
+            printResult(results.back());
+        }
+    }
+
+    if(!options.csvPath.empty())
+        saveCsv(options.csvPath, results);
+
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        Options options;
+        if(!parseOptions(argc, argv, options))
+        {
+            printUsage();
+            return 1;
+        }
+
+        return run(options);
+    }
+    catch(ExecutionError& ex)
+    {
+        cerr << "Execution error in:\nNode: " << ex.nodeName << "\n"
+            "Node typename: " << ex.nodeTypeName << "\n\nError message:\n" 
+            << ex.errorMessage << endl;
+    }
+    catch(exception& ex)
+    {
+        cerr << "Error: " << ex.what() << endl;
+    }
+
+    return 1;
+}
@@ -23,6 +23,8 @@
 
 #include "Hash.h"
 
+#include <cstring>
+
 #undef get16bits
 #if (defined(__GNUC__) && defined(__i386__)) || defined(__WATCOMC__) \
     || defined(_MSC_VER) || defined (__BORLANDC__) || defined (__TURBOC__)
@@ -77,4 +79,46 @@ uint32_t SuperFastHash (const char * data, int len) {
     hash += hash >> 6;
 
     return hash;
-}
\ No newline at end of file
+}
+
+uint64_t MurmurHash64A (const void * key, size_t len, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    uint64_t h = seed ^ (len * m);
+
+    const unsigned char * data = (const unsigned char *) key;
+    const unsigned char * end = data + (len & ~size_t(7));
+
+    /* Main loop - memcpy avoids unaligned reads */
+    while (data != end) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+        data += sizeof(k);
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    /* Handle end cases */
+    switch (len & 7) {
+    case 7: h ^= uint64_t(data[6]) << 48;
+    case 6: h ^= uint64_t(data[5]) << 40;
+    case 5: h ^= uint64_t(data[4]) << 32;
+    case 4: h ^= uint64_t(data[3]) << 24;
+    case 3: h ^= uint64_t(data[2]) << 16;
+    case 2: h ^= uint64_t(data[1]) << 8;
+    case 1: h ^= uint64_t(data[0]);
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
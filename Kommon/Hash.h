@@ -24,6 +24,10 @@
 #pragma once
 
 #include <cstdint>
+#include <cstddef>
 
 // From http://www.azillionmonkeys.com/qed/hash.html
-uint32_t SuperFastHash (const char * data, int len);
\ No newline at end of file
+uint32_t SuperFastHash (const char * data, int len);
+
+// MurmurHash64A from https://github.com/aappleby/smhasher (public domain)
+uint64_t MurmurHash64A (const void * key, size_t len, uint64_t seed);
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "ImageBufferPool.h"
+
+#include <algorithm>
+
+namespace {
+// Buffer is free if the pool holds the only reference to it
+bool isFree(const cv::Mat& buffer)
+{
+#if CV_MAJOR_VERSION >= 3
+    // Reference counter moved to UMatData in OpenCV 3
+    return buffer.u && buffer.u->refcount == 1;
+#else
+    return buffer.refcount && *buffer.refcount == 1;
+#endif
+}
+
+size_t bufferBytes(const cv::Mat& buffer)
+{
+    return buffer.total() * buffer.elemSize();
+}
+}
+
+ImageBufferPool::Statistics::Statistics()
+    : hits(0)
+    , misses(0)
+    , buffers(0)
+    , bytes(0)
+{
+}
+
+ImageBufferPool::ImageBufferPool()
+    : _maxBytes(size_t(512) << 20)
+    , _bytes(0)
+    , _hits(0)
+    , _misses(0)
+{
+}
+
+cv::Mat ImageBufferPool::acquire(int rows, int cols, int type)
+{
+    if(rows <= 0 || cols <= 0)
+        return cv::Mat();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = std::find_if(_buckets.begin(), _buckets.end(), [&](const Bucket& bucket)
+    {
+        return bucket.rows == rows && bucket.cols == cols && bucket.type == type;
+    });
+
+    if(it == _buckets.end())
+    {
+        Bucket bucket;
+        bucket.rows = rows;
+        bucket.cols = cols;
+        bucket.type = type;
+        it = _buckets.insert(_buckets.end(), std::move(bucket));
+    }
+
+    for(const cv::Mat& buffer : it->buffers)
+    {
+        if(isFree(buffer))
+        {
+            ++_hits;
+            return buffer;
+        }
+    }
+
+    ++_misses;
+    cv::Mat buffer(rows, cols, type);
+    it->buffers.push_back(buffer);
+    _bytes += bufferBytes(buffer);
+
+    // Buffer we've just created is referenced twice so it's safe here
+    if(_bytes > _maxBytes)
+        trimImpl();
+
+    return buffer;
+}
+
+cv::Mat ImageBufferPool::acquire(cv::Size size, int type)
+{
+    return acquire(size.height, size.width, type);
+}
+
+void ImageBufferPool::trim()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    trimImpl();
+}
+
+void ImageBufferPool::trimImpl()
+{
+    for(Bucket& bucket : _buckets)
+    {
+        auto it = std::remove_if(bucket.buffers.begin(), bucket.buffers.end(), isFree);
+        for(auto jt = it; jt != bucket.buffers.end(); ++jt)
+            _bytes -= bufferBytes(*jt);
+        bucket.buffers.erase(it, bucket.buffers.end());
+    }
+
+    _buckets.erase(std::remove_if(_buckets.begin(), _buckets.end(), [](const Bucket& bucket)
+    {
+        return bucket.buffers.empty();
+    }), _buckets.end());
+}
+
+void ImageBufferPool::setMaxBytes(size_t maxBytes)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _maxBytes = maxBytes;
+    if(_bytes > _maxBytes)
+        trimImpl();
+}
+
+ImageBufferPool::Statistics ImageBufferPool::statistics() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    Statistics stats;
+    stats.hits = _hits;
+    stats.misses = _misses;
+    stats.bytes = _bytes;
+    for(const Bucket& bucket : _buckets)
+        stats.buffers += bucket.buffers.size();
+    return stats;
+}
+
+void ImageBufferPool::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _hits = 0;
+    _misses = 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "Prerequisites.h"
+
+#include <opencv2/core/core.hpp>
+
+#include <mutex>
+
+// Keeps image buffers bucketed by size and type so they can be reused
+// between executions instead of being allocated every time
+class LOGIC_EXPORT ImageBufferPool
+{
+    K_DISABLE_COPY(ImageBufferPool);
+public:
+    struct Statistics
+    {
+        Statistics();
+
+        // Number of requests served with already allocated buffer
+        size_t hits;
+        // Number of requests that needed new allocation
+        size_t misses;
+        // Buffers owned by the pool (in use or not)
+        size_t buffers;
+        size_t bytes;
+    };
+
+    ImageBufferPool();
+
+    // Returns buffer of given size and type not referenced by anyone else.
+    // Buffer returns to the pool as soon as last cv::Mat referencing it is released.
+    // Content of the buffer is undefined.
+    cv::Mat acquire(int rows, int cols, int type);
+    cv::Mat acquire(cv::Size size, int type);
+
+    // Frees buffers that aren't used at the moment
+    void trim();
+    // Pool trims itself when its buffers take more memory than that
+    void setMaxBytes(size_t maxBytes);
+
+    Statistics statistics() const;
+    void resetStatistics();
+
+private:
+    struct Bucket
+    {
+        int rows;
+        int cols;
+        int type;
+        std::vector<cv::Mat> buffers;
+    };
+
+    void trimImpl();
+
+private:
+    mutable std::mutex _mutex;
+    // Usually there's only a handful of different sizes
+    std::vector<Bucket> _buckets;
+    size_t _maxBytes;
+    size_t _bytes;
+    size_t _hits;
+    size_t _misses;
+};
@@ -35,6 +35,7 @@ Node::Node()
     , _nodeTypeID(InvalidNodeTypeID)
     , _flags(0)
     , _timeElapsed(0)
+    , _deviceTimeElapsed(0)
 {
 }
 
@@ -48,6 +49,7 @@ Node::Node(std::unique_ptr<NodeType> nodeType,
     , _nodeTypeID(nodeTypeID)
     , _flags(0)
     , _timeElapsed(0)
+    , _deviceTimeElapsed(0)
 {
     const NodeConfig& config = _nodeType->config();
 
@@ -79,6 +81,7 @@ Node& Node::operator=(Node&& rhs)
     if(&rhs != this)
     {
         _outputSockets = std::move(rhs._outputSockets);
+        _delayedOutputSockets = std::move(rhs._delayedOutputSockets);
         _nodeType = std::move(rhs._nodeType);
         _nodeName = std::move(rhs._nodeName);
         _numInputs = rhs._numInputs;
@@ -86,6 +89,7 @@ Node& Node::operator=(Node&& rhs)
         _nodeTypeID = rhs._nodeTypeID;
         _flags = rhs._flags;
         _timeElapsed = rhs._timeElapsed;
+        _deviceTimeElapsed = rhs._deviceTimeElapsed;
         _message = rhs._message;
     }
     return *this;
@@ -109,6 +113,33 @@ const NodeFlowData& Node::outputSocket(SocketID socketID) const
     return _outputSockets[socketID];
 }
 
+const NodeFlowData& Node::delayedOutputSocket(SocketID socketID) const
+{
+    assert(socketID < numOutputSockets());
+    if(!validateSocket(socketID, true))
+        throw BadSocketException();
+
+    if(_delayedOutputSockets.empty())
+    {
+        static NodeFlowData _default = NodeFlowData();
+        return _default;
+    }
+
+    return _delayedOutputSockets[socketID];
+}
+
+void Node::swapOutputSockets()
+{
+    // Lazily create second set of output sockets
+    if(_delayedOutputSockets.empty())
+    {
+        for(const SocketConfig& output : config().outputs())
+            _delayedOutputSockets.emplace_back(output.type());
+    }
+
+    std::swap(_outputSockets, _delayedOutputSockets);
+}
+
 const NodeConfig& Node::config() const
 {
     return _nodeType->config();
@@ -118,17 +149,36 @@ ExecutionStatus Node::execute(NodeSocketReader& reader, NodeSocketWriter& writer
 {
     writer.setOutputSockets(_outputSockets);
     HighResolutionClock::time_point start = HighResolutionClock::now();
-    ExecutionStatus status = _nodeType->execute(reader, writer);
+    ExecutionStatus status;
+    try
+    {
+        status = _nodeType->execute(reader, writer);
+    }
+    catch(...)
+    {
+        // Collect commands issued before the failure so they don't
+        // end up in the device time of next execution
+        _deviceTimeElapsed = _nodeType->deviceTimeElapsed();
+        throw;
+    }
     HighResolutionClock::time_point stop = HighResolutionClock::now();
 
     _message = status.message;
     _timeElapsed = !flag(ENodeFlags::OverridesTimeComp)
         ? convertToMilliseconds(stop - start)
         : status.timeElapsed;
+    // Might wait for the device to finish so it's done after host time is taken
+    _deviceTimeElapsed = _nodeType->deviceTimeElapsed();
 
     return status;
 }
 
+void Node::skipExecution()
+{
+    _timeElapsed = 0;
+    _deviceTimeElapsed = 0;
+}
+
 bool Node::setProperty(PropertyID propID, const NodeProperty& value)
 {
     if(propID < 0 || propID >= static_cast<PropertyID>(config().properties().size()))
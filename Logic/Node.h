@@ -61,6 +61,11 @@ public:
     NodeFlowData& outputSocket(SocketID socketID);
     const NodeFlowData& outputSocket(SocketID socketID) const;
 
+    // Output sockets from before last swapOutputSockets() call
+    const NodeFlowData& delayedOutputSocket(SocketID socketID) const;
+    // Swaps current and delayed output sockets (used by pipelined execution)
+    void swapOutputSockets();
+
     const std::string& nodeName() const;
     void setNodeName(const std::string& nodeName);
 
@@ -68,10 +73,13 @@ public:
     SocketID numOutputSockets() const;
     NodeTypeID nodeTypeID() const;
     double timeElapsed() const;
+    double deviceTimeElapsed() const;
 
     // Below methods are thin wrapper for held NodeType interface
     const NodeConfig& config() const;
     ExecutionStatus execute(NodeSocketReader& reader, NodeSocketWriter& writer);
+    // Node kept its outputs instead of being executed - nothing was spent on it
+    void skipExecution();
     bool setProperty(PropertyID propID, const NodeProperty& value);
     NodeProperty property(PropertyID propID) const;
     const std::string& executeInformation() const;
@@ -86,12 +94,14 @@ private:
     // NOTE: If you add any new fields be sure to also handle them in move constructor/operator
     std::unique_ptr<NodeType> _nodeType;
     std::vector<NodeFlowData> _outputSockets;
+    std::vector<NodeFlowData> _delayedOutputSockets;
     std::string _nodeName;
     SocketID _numInputs;
     SocketID _numOutputs;
     NodeTypeID _nodeTypeID;
     uint32_t _flags;
     double _timeElapsed;
+    double _deviceTimeElapsed;
     std::string _message;
 };
 
@@ -129,6 +139,9 @@ inline NodeTypeID Node::nodeTypeID() const
 inline double Node::timeElapsed() const
 { return _timeElapsed; }
 
+inline double Node::deviceTimeElapsed() const
+{ return _deviceTimeElapsed; }
+
 inline bool Node::flag(ENodeFlags flag) const
 { return (_flags & uint32_t(flag)) != 0; }
 
@@ -24,8 +24,151 @@
 #include "NodeFlowData.h"
 #include "NodeException.h"
 
+#include "Kommon/Hash.h"
+
 #include <opencv2/highgui/highgui.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+struct NodeFlowData::ImageData
+{
+    explicit ImageData(bool onDevice)
+        : hostValid(!onDevice)
+#if defined(HAVE_OPENCL)
+        , deviceValid(onDevice)
+#endif
+    {
+    }
+
+    // Copies only headers, image buffers stay shared (as with cv::Mat)
+    ImageData(const ImageData& other)
+    {
+#if defined(HAVE_OPENCL)
+        std::lock_guard<std::mutex> lock(other.mutex);
+        device = other.device;
+        deviceValid = other.deviceValid;
+#endif
+        host = other.host;
+        hostValid = other.hostValid;
+    }
+
+    // Number of channels of up to date copy (RGBA device image counts as 3)
+    int channels() const
+    {
+#if defined(HAVE_OPENCL)
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!hostValid)
+        {
+            if(device.isNull())
+                return 0;
+            return device.bytesPerElement() == 4 ? 3 : int(device.bytesPerElement());
+        }
+#endif
+        return host.channels();
+    }
+
+    cv::Mat host;
+    bool hostValid;
+#if defined(HAVE_OPENCL)
+    clw::Image2D device;
+    bool deviceValid;
+    // Outdated copy is brought up to date from const accessors,
+    // possibly by a few readers at once
+    mutable std::mutex mutex;
+#endif
+};
+
+namespace {
+// Counter of the tree whose node is being executed on this thread
+static thread_local std::atomic<std::uint64_t>* copyCounter = nullptr;
+#if defined(HAVE_OPENCL)
+static std::atomic<IDeviceImageTransfer*> imageTransfer(nullptr);
+#endif
+
+enum class EImageKind
+{
+    None,
+    Any,
+    Mono,
+    Rgb
+};
+
+static EImageKind imageKind(ENodeFlowDataType type)
+{
+    switch(type)
+    {
+    case ENodeFlowDataType::Image:
+#if defined(HAVE_OPENCL)
+    case ENodeFlowDataType::DeviceImage:
+#endif
+        return EImageKind::Any;
+    case ENodeFlowDataType::ImageMono:
+#if defined(HAVE_OPENCL)
+    case ENodeFlowDataType::DeviceImageMono:
+#endif
+        return EImageKind::Mono;
+    case ENodeFlowDataType::ImageRgb:
+#if defined(HAVE_OPENCL)
+    case ENodeFlowDataType::DeviceImageRgb:
+#endif
+        return EImageKind::Rgb;
+    default:
+        return EImageKind::None;
+    }
+}
+
+static size_t payloadBytes(const KeyPoints& kp)
+{
+    return kp.kpoints.size() * sizeof(cv::KeyPoint);
+}
+
+static size_t payloadBytes(const Matches& mt)
+{
+    return (mt.queryPoints.size() + mt.trainPoints.size()) * sizeof(cv::Point2f);
+}
+
+template <class T>
+static T& detach(std::shared_ptr<T>& payload)
+{
+    // Someone else still sees the payload - make a private copy
+    if(payload.use_count() > 1)
+    {
+        payload = std::make_shared<T>(*payload);
+        if(copyCounter)
+            *copyCounter += payloadBytes(*payload);
+    }
+    return *payload;
+}
+
+static void hashCombine(std::uint64_t& seed, const void* data, size_t len)
+{
+    // Previous hash seeds the next one so order of chunks matters
+    seed = MurmurHash64A(data, len, seed);
+}
+
+static void hashMat(std::uint64_t& seed, const cv::Mat& mat)
+{
+    const int header[] = { mat.rows, mat.cols, mat.type() };
+    hashCombine(seed, header, sizeof(header));
+
+    if(mat.empty())
+        return;
+
+    const size_t rowBytes = mat.cols * mat.elemSize();
+    if(mat.isContinuous())
+    {
+        hashCombine(seed, mat.data, rowBytes * mat.rows);
+    }
+    else
+    {
+        for(int y = 0; y < mat.rows; ++y)
+            hashCombine(seed, mat.ptr(y), rowBytes);
+    }
+}
+}
+
 NodeFlowData::NodeFlowData()
     : _type(ENodeFlowDataType::Invalid)
     , _data()
@@ -41,22 +184,22 @@ NodeFlowData::NodeFlowData(ENodeFlowDataType dataType)
     case ENodeFlowDataType::Image:
     case ENodeFlowDataType::ImageMono:
     case ENodeFlowDataType::ImageRgb:
-        _data = cv::Mat();
+        _data = std::make_shared<ImageData>(false);
         break;
     case ENodeFlowDataType::Array:
         _data = cv::Mat();
         break;
     case ENodeFlowDataType::Keypoints:
-        _data = KeyPoints();
+        _data = std::make_shared<KeyPoints>();
         break;
     case ENodeFlowDataType::Matches:
-        _data = Matches();
+        _data = std::make_shared<Matches>();
         break;
 #if defined(HAVE_OPENCL)
     case ENodeFlowDataType::DeviceImage:
     case ENodeFlowDataType::DeviceImageMono:
     case ENodeFlowDataType::DeviceImageRgb:
-        _data = clw::Image2D();
+        _data = std::make_shared<ImageData>(true);
         break;
     case ENodeFlowDataType::DeviceArray:
         _data = DeviceArray();
@@ -74,7 +217,7 @@ void NodeFlowData::saveToDisk(const std::string& filename) const
         || _type == ENodeFlowDataType::ImageMono
         || _type == ENodeFlowDataType::ImageRgb)
     {
-        const cv::Mat& img = boost::get<cv::Mat>(_data);
+        const cv::Mat& img = readHostImage(_type);
         if(!img.empty())
             cv::imwrite(filename, img);
     }
@@ -86,110 +229,193 @@ bool NodeFlowData::isValidImage() const
         || _type == ENodeFlowDataType::ImageMono
         || _type == ENodeFlowDataType::ImageRgb)
     {
-        const cv::Mat& img = boost::get<cv::Mat>(_data);
+        const cv::Mat& img = readHostImage(_type);
         if(!img.empty())
             return true;
     }
     return false;
 }
 
-bool NodeFlowData::isConvertible(ENodeFlowDataType from, 
-                                 ENodeFlowDataType to) const
+size_t NodeFlowData::byteSize() const
 {
-    if(from == to)
-        return true;
-
-    switch(from)
+    switch(_type)
     {
     case ENodeFlowDataType::Image:
-        if(to == ENodeFlowDataType::ImageMono)
-            return boost::get<cv::Mat>(_data).channels() == 1;
-        else if(to == ENodeFlowDataType::ImageRgb)
-            return boost::get<cv::Mat>(_data).channels() == 3;
-        break;
     case ENodeFlowDataType::ImageMono:
-        if(to == ENodeFlowDataType::Image)
-            return boost::get<cv::Mat>(_data).channels() == 1;
-        break;
     case ENodeFlowDataType::ImageRgb:
-        if(to == ENodeFlowDataType::Image)
-            return boost::get<cv::Mat>(_data).channels() == 3;
-        break;
-    case ENodeFlowDataType::Invalid:
-    case ENodeFlowDataType::Array:
-    case ENodeFlowDataType::Keypoints:
-    case ENodeFlowDataType::Matches:
 #if defined(HAVE_OPENCL)
     case ENodeFlowDataType::DeviceImage:
-        if(to == ENodeFlowDataType::DeviceImageMono)
-            return boost::get<clw::Image2D>(_data).bytesPerElement() == 1;
-        else if(to == ENodeFlowDataType::DeviceImageRgb)
-            return boost::get<clw::Image2D>(_data).bytesPerElement() == 4;
-        break;
     case ENodeFlowDataType::DeviceImageMono:
-        if(to == ENodeFlowDataType::DeviceImage)
-            return boost::get<clw::Image2D>(_data).bytesPerElement() == 1;
-        break;
     case ENodeFlowDataType::DeviceImageRgb:
-        if(to == ENodeFlowDataType::DeviceImage)
-            return boost::get<clw::Image2D>(_data).bytesPerElement() == 4;
-        break;
+#endif
+    {
+        // Both copies are kept, even outdated one
+        const ImageData& image = *boost::get<std::shared_ptr<ImageData>>(_data);
+#if defined(HAVE_OPENCL)
+        std::lock_guard<std::mutex> lock(image.mutex);
+        const size_t deviceBytes = image.device.isNull() ? 0 
+            : image.device.width() * image.device.height() * image.device.bytesPerElement();
+        return image.host.total() * image.host.elemSize() + deviceBytes;
+#else
+        return image.host.total() * image.host.elemSize();
+#endif
+    }
+    case ENodeFlowDataType::Array:
+    {
+        const cv::Mat& mat = boost::get<cv::Mat>(_data);
+        return mat.total() * mat.elemSize();
+    }
+    case ENodeFlowDataType::Keypoints:
+        return payloadBytes(getKeypoints());
+    case ENodeFlowDataType::Matches:
+        return payloadBytes(getMatches());
+#if defined(HAVE_OPENCL)
     case ENodeFlowDataType::DeviceArray:
+        return boost::get<DeviceArray>(_data).size();
 #endif
-        break;
+    case ENodeFlowDataType::Invalid:
+    default:
+        return 0;
+    }
+}
+
+bool NodeFlowData::contentHash(std::uint64_t& hash) const
+{
+    hash = static_cast<std::uint64_t>(_type);
+
+    switch(_type)
+    {
+    case ENodeFlowDataType::Image:
+    case ENodeFlowDataType::ImageMono:
+    case ENodeFlowDataType::ImageRgb:
+        hashMat(hash, readHostImage(_type));
+        return true;
+    case ENodeFlowDataType::Array:
+        hashMat(hash, boost::get<cv::Mat>(_data));
+        return true;
+    case ENodeFlowDataType::Keypoints:
+    {
+        const KeyPoints& kp = getKeypoints();
+        const size_t count = kp.kpoints.size();
+        hashCombine(hash, &count, sizeof(count));
+        hashCombine(hash, kp.kpoints.data(), kp.kpoints.size() * sizeof(cv::KeyPoint));
+        hashMat(hash, kp.image);
+        return true;
     }
+    case ENodeFlowDataType::Matches:
+    {
+        const Matches& mt = getMatches();
+        const size_t counts[] = { mt.queryPoints.size(), mt.trainPoints.size() };
+        hashCombine(hash, counts, sizeof(counts));
+        hashCombine(hash, mt.queryPoints.data(), mt.queryPoints.size() * sizeof(cv::Point2f));
+        hashCombine(hash, mt.trainPoints.data(), mt.trainPoints.size() * sizeof(cv::Point2f));
+        hashMat(hash, mt.queryImage);
+        hashMat(hash, mt.trainImage);
+        return true;
+    }
+    case ENodeFlowDataType::Invalid:
+        return true;
+    default:
+        // Device data would need to be read back first
+        return false;
+    }
+}
 
-    return false;
+void NodeFlowData::share(const NodeFlowData& other)
+{
+    if(!isConvertible(other._type, _type))
+        throw BadConnectionException();
+    _data = other._data;
+#if defined(HAVE_OPENCL)
+    _deviceEvent = other._deviceEvent;
+#endif
+}
+
+void NodeFlowData::setCopyCounter(std::atomic<std::uint64_t>* counter)
+{
+    copyCounter = counter;
+}
+
+bool NodeFlowData::isConvertible(ENodeFlowDataType from, 
+                                 ENodeFlowDataType to) const
+{
+    if(from == to)
+        return true;
+
+    // Host and device images are interchangeable, only number of channels matter
+    const EImageKind fromKind = imageKind(from);
+    const EImageKind toKind = imageKind(to);
+    if(fromKind == EImageKind::None || toKind == EImageKind::None)
+        return false;
+
+    EImageKind kind = fromKind;
+    if(toKind != EImageKind::Any)
+    {
+        if(fromKind != EImageKind::Any && fromKind != toKind)
+            return false;
+        kind = toKind;
+    }
+
+    const ImageData& image = *boost::get<std::shared_ptr<ImageData>>(_data);
+    switch(kind)
+    {
+    case EImageKind::Mono:
+        return image.channels() == 1;
+    case EImageKind::Rgb:
+        return image.channels() == 3;
+    default:
+        return true;
+    }
 }
 
 cv::Mat& NodeFlowData::getImage()
-{ 
-    return getTyped<cv::Mat>(ENodeFlowDataType::Image);
+{
+    return writeHostImage(ENodeFlowDataType::Image);
 }
 
-const cv::Mat& NodeFlowData::getImage() const 
-{ 
-    return getTyped<cv::Mat>(ENodeFlowDataType::Image);
+const cv::Mat& NodeFlowData::getImage() const
+{
+    return readHostImage(ENodeFlowDataType::Image);
 }
 
 cv::Mat& NodeFlowData::getImageMono()
 {
-    return getTyped<cv::Mat>(ENodeFlowDataType::ImageMono);
+    return writeHostImage(ENodeFlowDataType::ImageMono);
 }
 
 const cv::Mat& NodeFlowData::getImageMono() const
 {
-    return getTyped<cv::Mat>(ENodeFlowDataType::ImageMono);
+    return readHostImage(ENodeFlowDataType::ImageMono);
 }
 
 cv::Mat& NodeFlowData::getImageRgb()
 {
-    return getTyped<cv::Mat>(ENodeFlowDataType::ImageRgb);
+    return writeHostImage(ENodeFlowDataType::ImageRgb);
 }
 
 const cv::Mat& NodeFlowData::getImageRgb() const
 {
-    return getTyped<cv::Mat>(ENodeFlowDataType::ImageRgb);
+    return readHostImage(ENodeFlowDataType::ImageRgb);
 }
 
 KeyPoints& NodeFlowData::getKeypoints()
 {
-    return getTyped<KeyPoints>(ENodeFlowDataType::Keypoints);
+    return detach(getTyped<std::shared_ptr<KeyPoints>>(ENodeFlowDataType::Keypoints));
 }
 
 const KeyPoints& NodeFlowData::getKeypoints() const
 {
-    return getTyped<KeyPoints>(ENodeFlowDataType::Keypoints);
+    return *getTyped<std::shared_ptr<KeyPoints>>(ENodeFlowDataType::Keypoints);
 }
 
 Matches& NodeFlowData::getMatches()
 {
-    return getTyped<Matches>(ENodeFlowDataType::Matches);
+    return detach(getTyped<std::shared_ptr<Matches>>(ENodeFlowDataType::Matches));
 }
 
 const Matches& NodeFlowData::getMatches() const
 {
-    return getTyped<Matches>(ENodeFlowDataType::Matches);
+    return *getTyped<std::shared_ptr<Matches>>(ENodeFlowDataType::Matches);
 }
 
 cv::Mat& NodeFlowData::getArray()
@@ -206,32 +432,32 @@ const cv::Mat& NodeFlowData::getArray() const
 
 clw::Image2D& NodeFlowData::getDeviceImage()
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImage);
+    return writeDeviceImage(ENodeFlowDataType::DeviceImage);
 }
 
 const clw::Image2D& NodeFlowData::getDeviceImage() const
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImage);
+    return readDeviceImage(ENodeFlowDataType::DeviceImage);
 }
 
 clw::Image2D& NodeFlowData::getDeviceImageMono()
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImageMono);
+    return writeDeviceImage(ENodeFlowDataType::DeviceImageMono);
 }
 
 const clw::Image2D& NodeFlowData::getDeviceImageMono() const
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImageMono);
+    return readDeviceImage(ENodeFlowDataType::DeviceImageMono);
 }
 
 clw::Image2D& NodeFlowData::getDeviceImageRgb()
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImageRgb);
+    return writeDeviceImage(ENodeFlowDataType::DeviceImageRgb);
 }
 
 const clw::Image2D& NodeFlowData::getDeviceImageRgb() const
 {
-    return getTyped<clw::Image2D>(ENodeFlowDataType::DeviceImageRgb);
+    return readDeviceImage(ENodeFlowDataType::DeviceImageRgb);
 }
 
 DeviceArray& NodeFlowData::getDeviceArray()
@@ -244,6 +470,116 @@ const DeviceArray& NodeFlowData::getDeviceArray() const
     return getTyped<DeviceArray>(ENodeFlowDataType::DeviceArray);
 }
 
+const clw::Event& NodeFlowData::deviceEvent() const
+{
+    return _deviceEvent;
+}
+
+void NodeFlowData::setDeviceEvent(const clw::Event& deviceEvent)
+{
+    _deviceEvent = deviceEvent;
+}
+
+void NodeFlowData::waitForDeviceData() const
+{
+    if(!_deviceEvent.isNull())
+    {
+        clw::Event event = _deviceEvent;
+        event.waitForFinished();
+    }
+}
+
+void NodeFlowData::setDeviceImageTransfer(IDeviceImageTransfer* transfer)
+{
+    imageTransfer = transfer;
+}
+
+IDeviceImageTransfer* NodeFlowData::deviceImageTransfer()
+{
+    return imageTransfer;
+}
+
+#endif
+
+NodeFlowData::ImageData& NodeFlowData::writeImage(ENodeFlowDataType requestedType)
+{
+    std::shared_ptr<ImageData>& payload = 
+        getTyped<std::shared_ptr<ImageData>>(requestedType);
+    // Don't change which copy is up to date for others
+    if(payload.use_count() > 1)
+        payload = std::make_shared<ImageData>(*payload);
+    return *payload;
+}
+
+cv::Mat& NodeFlowData::writeHostImage(ENodeFlowDataType requestedType)
+{
+    ImageData& image = writeImage(requestedType);
+    image.hostValid = true;
+#if defined(HAVE_OPENCL)
+    // Device copy is kept only for reuse of its memory
+    image.deviceValid = false;
+    _deviceEvent = clw::Event();
+#endif
+    return image.host;
+}
+
+const cv::Mat& NodeFlowData::readHostImage(ENodeFlowDataType requestedType) const
+{
+    ImageData& image = *getTyped<std::shared_ptr<ImageData>>(requestedType);
+#if defined(HAVE_OPENCL)
+    std::lock_guard<std::mutex> lock(image.mutex);
+    if(!image.hostValid)
+    {
+        if(image.device.isNull() || image.device.size() == 0)
+        {
+            image.host = cv::Mat();
+        }
+        else
+        {
+            IDeviceImageTransfer* transfer = deviceImageTransfer();
+            if(!transfer || !transfer->downloadImage(image.device, image.host))
+                throw BadConnectionException();
+        }
+        image.hostValid = true;
+    }
+#endif
+    return image.host;
+}
+
+#if defined(HAVE_OPENCL)
+
+clw::Image2D& NodeFlowData::writeDeviceImage(ENodeFlowDataType requestedType)
+{
+    ImageData& image = writeImage(requestedType);
+    image.deviceValid = true;
+    // Host copy is kept only for reuse of its memory
+    image.hostValid = false;
+    // Writer sets its own event if it doesn't wait for the device
+    _deviceEvent = clw::Event();
+    return image.device;
+}
+
+const clw::Image2D& NodeFlowData::readDeviceImage(ENodeFlowDataType requestedType) const
+{
+    ImageData& image = *getTyped<std::shared_ptr<ImageData>>(requestedType);
+    std::lock_guard<std::mutex> lock(image.mutex);
+    if(!image.deviceValid)
+    {
+        if(image.host.empty())
+        {
+            image.device = clw::Image2D();
+        }
+        else
+        {
+            IDeviceImageTransfer* transfer = deviceImageTransfer();
+            if(!transfer || !transfer->uploadImage(image.host, image.device))
+                throw BadConnectionException();
+        }
+        image.deviceValid = true;
+    }
+    return image.device;
+}
+
 #endif
 
 template <class Type>
@@ -33,6 +33,9 @@
 #include <opencv2/core/core.hpp>
 #include <opencv2/features2d/features2d.hpp>
 
+#include <atomic>
+#include <memory>
+
 #if defined(HAVE_OPENCL)
 // Device data
 #  include "OpenCL/DeviceArray.h"
@@ -70,8 +73,8 @@ enum class ENodeFlowDataType : int
     Matches,
 #if defined(HAVE_OPENCL)
     // Gpu part
-    // TODO: Could merge this with above ones and add bool flag
-    //       indicating if it's in device or host memory
+    // Images share one payload with host ones and can be linked with them -
+    // data is transferred on first read from the other side
     DeviceImage,
     DeviceImageMono,
     // In fact, its RGBA (BGRA, ARGB), as RGB noone seems to support
@@ -84,15 +87,39 @@ namespace std {
 LOGIC_EXPORT string to_string(ENodeFlowDataType);
 }
 
+#if defined(HAVE_OPENCL)
+// Moves images between host and device memory when image flow data
+// is read on the other side than it was written (provided by OpenCL module).
+// Device images are 1 (R) or 4 (RGBA) channel, host ones are mono or BGR.
+class LOGIC_EXPORT IDeviceImageTransfer
+{
+public:
+    virtual ~IDeviceImageTransfer() {}
+
+    // Both return false if image format isn't supported and block until
+    // the transfer is done (device commands are ordered on the same queue).
+    // Transfers aren't part of device time of any node - being blocking,
+    // they count towards host time of the node reading the image instead
+    virtual bool uploadImage(const cv::Mat& hostImage, clw::Image2D& deviceImage) = 0;
+    virtual bool downloadImage(const clw::Image2D& deviceImage, cv::Mat& hostImage) = 0;
+};
+#endif
+
 class LOGIC_EXPORT NodeFlowData
 {
+    // Host and device copy of an image with info which one is up to date
+    struct ImageData;
+
+    // Keypoints and matches are shared between copies of flow data
+    // and copied only when mutable access is requested (copy-on-write).
+    // Image data is copied then only shallowly - pixels stay shared as with cv::Mat
     typedef boost::variant<
         cv::Mat,
-        KeyPoints,
-        Matches
+        std::shared_ptr<ImageData>,
+        std::shared_ptr<KeyPoints>,
+        std::shared_ptr<Matches>
     #if defined(HAVE_OPENCL)
-        ,clw::Image2D, // TODO - replace this with some thin wrapper
-        DeviceArray
+        ,DeviceArray
     #endif
     > flow_data;
 
@@ -102,8 +129,22 @@ public:
 
     void saveToDisk(const std::string& filename) const;
     bool isValidImage() const;
-
-    // Host data
+    // Size in bytes of data referenced by this object. Payloads shared with
+    // other flow data (pass-through outputs) are counted by each of them.
+    size_t byteSize() const;
+    // Computes 64-bit hash of data content (including its type and
+    // dimensions). Returns false if content can't be inspected from
+    // the host (device data)
+    bool contentHash(std::uint64_t& hash) const;
+    // Makes this object share payload of the other one (of compatible type) 
+    // instead of copying it. Works like assignment but keeps declared type.
+    void share(const NodeFlowData& other);
+    // Bytes deep-copied by copy-on-write payloads on the calling thread
+    // are added to given counter (nullptr stops counting)
+    static void setCopyCounter(std::atomic<std::uint64_t>* counter);
+
+    // Host data. Mutable access to any image marks the other (device) copy
+    // as outdated, const one downloads it first if it's the fresh one
     cv::Mat& getImage();
     const cv::Mat& getImage() const;
 
@@ -113,16 +154,18 @@ public:
     cv::Mat& getImageRgb();
     const cv::Mat& getImageRgb() const;
 
+    // Mutable access copies the payload if it's shared
     KeyPoints& getKeypoints();
     const KeyPoints& getKeypoints() const;
 
+    // Mutable access copies the payload if it's shared
     Matches& getMatches();
     const Matches& getMatches() const;
 
     cv::Mat& getArray();
     const cv::Mat& getArray() const;
 
-    // Device data
+    // Device data. Images behave as host ones, just the other way round
 #if defined(HAVE_OPENCL)
     clw::Image2D& getDeviceImage();
     const clw::Image2D& getDeviceImage() const;
@@ -135,6 +178,20 @@ public:
 
     DeviceArray& getDeviceArray();
     const DeviceArray& getDeviceArray() const;
+
+    // Device data might still be computed when producing node returns.
+    // All GPU nodes share one in-order queue so their commands are implicitly 
+    // ordered - event needs to be waited for only when accessing the data 
+    // from the host or from a different command queue.
+    const clw::Event& deviceEvent() const;
+    void setDeviceEvent(const clw::Event& deviceEvent);
+    // Blocks until device data is ready
+    void waitForDeviceData() const;
+
+    // Used for moving images between host and device memory on demand.
+    // Without it host and device images can't be used interchangeably.
+    static void setDeviceImageTransfer(IDeviceImageTransfer* transfer);
+    static IDeviceImageTransfer* deviceImageTransfer();
 #endif
 
     bool isValid() const;
@@ -150,9 +207,21 @@ private:
     template <class Type>
     const Type& getTyped(ENodeFlowDataType requestedType) const;
 
+    // Copies image payload (shallowly) if it's shared
+    ImageData& writeImage(ENodeFlowDataType requestedType);
+    cv::Mat& writeHostImage(ENodeFlowDataType requestedType);
+    const cv::Mat& readHostImage(ENodeFlowDataType requestedType) const;
+#if defined(HAVE_OPENCL)
+    clw::Image2D& writeDeviceImage(ENodeFlowDataType requestedType);
+    const clw::Image2D& readDeviceImage(ENodeFlowDataType requestedType) const;
+#endif
+
 private:
     ENodeFlowDataType _type;
     flow_data _data;
+#if defined(HAVE_OPENCL)
+    clw::Event _deviceEvent;
+#endif
 };
 
 inline bool NodeFlowData::isValid() const
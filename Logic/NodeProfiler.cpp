@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "NodeProfiler.h"
+
+#include "Kommon/StringUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+// Histogram covers range from 1us to 100s with 8 buckets per octave
+const double histogramMin = 1e-3;
+const int bucketsPerOctave = 8;
+const size_t numBuckets = 1 + 27 * bucketsPerOctave;
+
+void saveToFile(const json11::Json& json, const std::string& filePath)
+{
+    try
+    {
+        std::ofstream file{filePath, std::ios::out};
+        file.exceptions(~std::ios::goodbit);
+        file << json.dump();
+    }
+    catch (std::exception&)
+    {
+        std::throw_with_nested(std::runtime_error{
+            string_format("Couldn't open target file: %s", filePath.c_str())});
+    }
+}
+}
+
+NodeProfiler::NodeStatistics::NodeStatistics()
+    : calls(0)
+    , total(0.0)
+    , min(0.0)
+    , max(0.0)
+    , deviceTotal(0.0)
+    , histogram(numBuckets, 0)
+{
+}
+
+double NodeProfiler::NodeStatistics::percentile(double p) const
+{
+    if(calls == 0)
+        return 0.0;
+
+    size_t rank = static_cast<size_t>(std::ceil(p * calls));
+    size_t count = 0;
+
+    for(size_t bucket = 0; bucket < histogram.size(); ++bucket)
+    {
+        count += histogram[bucket];
+        if(count >= rank)
+        {
+            // Upper bound of the bucket is never worse than observed extremes
+            double value = histogramBucketValue(bucket);
+            return std::max(min, std::min(max, value));
+        }
+    }
+
+    return max;
+}
+
+NodeProfiler::NodeProfiler()
+    : _epoch(HighResolutionClock::now())
+    , _maxTraceEvents(1 << 20)
+{
+}
+
+void NodeProfiler::reset()
+{
+    _statistics.clear();
+    _samples.clear();
+    _epoch = HighResolutionClock::now();
+}
+
+void NodeProfiler::addSample(const Sample& sample,
+                             const std::string& nodeName,
+                             const std::string& nodeTypeName,
+                             const std::vector<size_t>& outputBytes)
+{
+    NodeStatistics& stats = _statistics[sample.nodeID];
+
+    // NodeID could've been recycled by another node
+    if(stats.nodeName != nodeName || stats.nodeTypeName != nodeTypeName)
+    {
+        stats = NodeStatistics();
+        stats.nodeName = nodeName;
+        stats.nodeTypeName = nodeTypeName;
+    }
+
+    stats.min = stats.calls > 0 ? std::min(stats.min, sample.elapsed) : sample.elapsed;
+    stats.max = std::max(stats.max, sample.elapsed);
+    stats.total += sample.elapsed;
+    stats.deviceTotal += sample.deviceElapsed;
+    ++stats.calls;
+    ++stats.histogram[histogramBucket(sample.elapsed)];
+
+    if(stats.bytesProduced.size() < outputBytes.size())
+        stats.bytesProduced.resize(outputBytes.size(), 0);
+    for(size_t i = 0; i < outputBytes.size(); ++i)
+        stats.bytesProduced[i] += outputBytes[i];
+
+    if(_samples.size() < _maxTraceEvents)
+        _samples.push_back(sample);
+}
+
+void NodeProfiler::setMaxTraceEvents(size_t maxTraceEvents)
+{
+    _maxTraceEvents = maxTraceEvents;
+}
+
+json11::Json NodeProfiler::toJson() const
+{
+    json11::Json::array jsonNodes;
+
+    for(const auto& entry : _statistics)
+    {
+        const NodeStatistics& stats = entry.second;
+
+        json11::Json::array jsonBytes;
+        for(std::uint64_t bytes : stats.bytesProduced)
+            jsonBytes.push_back(static_cast<double>(bytes));
+
+        jsonNodes.push_back(json11::Json::object{
+            {"id", entry.first},
+            {"name", stats.nodeName},
+            {"class", stats.nodeTypeName},
+            {"calls", static_cast<double>(stats.calls)},
+            {"totalMs", stats.total},
+            {"meanMs", stats.calls > 0 ? stats.total / stats.calls : 0.0},
+            {"minMs", stats.min},
+            {"p50Ms", stats.percentile(0.50)},
+            {"p95Ms", stats.percentile(0.95)},
+            {"p99Ms", stats.percentile(0.99)},
+            {"maxMs", stats.max},
+            {"deviceTotalMs", stats.deviceTotal},
+            {"deviceMeanMs", stats.calls > 0 ? stats.deviceTotal / stats.calls : 0.0},
+            {"bytesProduced", jsonBytes}});
+    }
+
+    return json11::Json::object{{"nodes", jsonNodes}};
+}
+
+json11::Json NodeProfiler::toChromeTrace() const
+{
+    json11::Json::array traceEvents;
+    std::vector<std::thread::id> threads;
+
+    for(const Sample& sample : _samples)
+    {
+        auto iter = std::find(std::begin(threads), std::end(threads), sample.thread);
+        int tid = static_cast<int>(iter - std::begin(threads));
+        if(iter == std::end(threads))
+            threads.push_back(sample.thread);
+
+        auto stats = _statistics.find(sample.nodeID);
+        const std::string& name = stats != _statistics.end()
+            ? stats->second.nodeName : std::string();
+        const std::string& typeName = stats != _statistics.end()
+            ? stats->second.nodeTypeName : std::string();
+
+        using namespace std::chrono;
+        double ts = static_cast<double>(
+            duration_cast<microseconds>(sample.start - _epoch).count());
+
+        // Complete event ("X") with timestamps and duration in microseconds
+        traceEvents.push_back(json11::Json::object{
+            {"name", name},
+            {"cat", typeName},
+            {"ph", "X"},
+            {"ts", ts},
+            {"dur", sample.elapsed * 1e3},
+            {"pid", 0},
+            {"tid", tid},
+            {"args", json11::Json::object{
+                {"nodeID", sample.nodeID},
+                {"deviceMs", sample.deviceElapsed}}}});
+    }
+
+    return json11::Json::object{
+        {"traceEvents", traceEvents},
+        {"displayTimeUnit", "ms"}};
+}
+
+void NodeProfiler::saveJson(const std::string& filePath) const
+{
+    saveToFile(toJson(), filePath);
+}
+
+void NodeProfiler::saveChromeTrace(const std::string& filePath) const
+{
+    saveToFile(toChromeTrace(), filePath);
+}
+
+size_t NodeProfiler::histogramBucket(double elapsed)
+{
+    if(elapsed <= histogramMin)
+        return 0;
+
+    double octaves = std::log2(elapsed / histogramMin);
+    size_t bucket = 1 + static_cast<size_t>(octaves * bucketsPerOctave);
+    return std::min(bucket, numBuckets - 1);
+}
+
+double NodeProfiler::histogramBucketValue(size_t bucket)
+{
+    return histogramMin * std::pow(2.0, static_cast<double>(bucket) / bucketsPerOctave);
+}
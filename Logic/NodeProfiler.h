@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "Prerequisites.h"
+#include "Kommon/HighResolutionClock.h"
+#include "Kommon/json11.hpp"
+
+#include <thread>
+
+// Collects execution statistics of nodes over many runs of a tree
+class LOGIC_EXPORT NodeProfiler
+{
+public:
+    struct Sample
+    {
+        NodeID nodeID;
+        HighResolutionClock::time_point start;
+        // Time elapsed in milliseconds
+        double elapsed;
+        // Time spent on a device (e.g. by OpenCL commands) in milliseconds
+        double deviceElapsed;
+        std::thread::id thread;
+    };
+
+    struct NodeStatistics
+    {
+        NodeStatistics();
+
+        double percentile(double p) const;
+
+        std::string nodeName;
+        std::string nodeTypeName;
+        size_t calls;
+        double total;
+        double min;
+        double max;
+        double deviceTotal;
+        // Logarithmic histogram of times elapsed
+        std::vector<size_t> histogram;
+        // Sum of bytes written to each output socket
+        std::vector<std::uint64_t> bytesProduced;
+    };
+
+    NodeProfiler();
+
+    void reset();
+
+    void addSample(const Sample& sample,
+                   const std::string& nodeName,
+                   const std::string& nodeTypeName,
+                   const std::vector<size_t>& outputBytes);
+
+    // Limit of stored samples for trace export (statistics are unaffected)
+    void setMaxTraceEvents(size_t maxTraceEvents);
+
+    const std::map<NodeID, NodeStatistics>& statistics() const { return _statistics; }
+
+    // Statistics of all profiled nodes
+    json11::Json toJson() const;
+    // Trace events in Chrome trace event format (chrome://tracing)
+    json11::Json toChromeTrace() const;
+
+    // Both may throw on failure
+    void saveJson(const std::string& filePath) const;
+    void saveChromeTrace(const std::string& filePath) const;
+
+private:
+    static size_t histogramBucket(double elapsed);
+    static double histogramBucketValue(size_t bucket);
+
+private:
+    std::map<NodeID, NodeStatistics> _statistics;
+    std::vector<Sample> _samples;
+    HighResolutionClock::time_point _epoch;
+    size_t _maxTraceEvents;
+};
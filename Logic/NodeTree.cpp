@@ -28,17 +28,197 @@
 #include "NodeSystem.h"
 #include "NodeModule.h"
 #include "NodeException.h"
+#include "NodeProfiler.h"
+#include "ImageBufferPool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#if defined(HAVE_TBB)
+#  include <tbb/task_group.h>
+#endif
+
+// Threads kept for the lifetime of a tree and running submitted jobs.
+// Used when TBB isn't available. Each worker has its own deque: jobs
+// submitted from a worker go to its back and are taken from there (most
+// recently readied node, its inputs are still in cache), idle workers
+// steal from the front of other deques. Jobs from outside are spread
+// round-robin.
+class NodeTree::WorkerPool
+{
+public:
+    explicit WorkerPool(size_t numThreads)
+        : _pending(0)
+        , _next(0)
+        , _stop(false)
+    {
+        for(size_t i = 0; i < numThreads; ++i)
+            _queues.emplace_back(new JobQueue());
+        for(size_t i = 0; i < numThreads; ++i)
+            _threads.emplace_back([this, i] { run(i); });
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _condition.notify_all();
+
+        for(auto& thread : _threads)
+            thread.join();
+    }
+
+    void submit(std::function<void()> job)
+    {
+        size_t index = currentWorker();
+        if(index == _threads.size())
+            index = _next++ % _queues.size();
+
+        {
+            JobQueue& queue = *_queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_pending;
+        }
+        _condition.notify_one();
+    }
+
+private:
+    struct JobQueue
+    {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    void run(size_t index)
+    {
+        for(;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this] { return _stop || _pending > 0; });
+                if(_pending == 0)
+                    return;
+                // Job is counted after it's queued so there's one to take
+                --_pending;
+            }
+
+            std::function<void()> job;
+            while(!take(index, job))
+                std::this_thread::yield();
+            job();
+        }
+    }
+
+    bool take(size_t index, std::function<void()>& job)
+    {
+        const size_t count = _queues.size();
+        for(size_t i = 0; i < count; ++i)
+        {
+            JobQueue& queue = *_queues[(index + i) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(queue.jobs.empty())
+                continue;
+
+            if(i == 0)
+            {
+                job = std::move(queue.jobs.back());
+                queue.jobs.pop_back();
+            }
+            else
+            {
+                job = std::move(queue.jobs.front());
+                queue.jobs.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Index of calling worker or number of workers if called from outside
+    size_t currentWorker() const
+    {
+        const std::thread::id id = std::this_thread::get_id();
+        for(size_t i = 0; i < _threads.size(); ++i)
+        {
+            if(_threads[i].get_id() == id)
+                return i;
+        }
+        return _threads.size();
+    }
+
+private:
+    std::vector<std::thread> _threads;
+    std::vector<std::unique_ptr<JobQueue>> _queues;
+    // Queued jobs not taken by any worker yet
+    size_t _pending;
+    std::atomic<size_t> _next;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    bool _stop;
+};
 
 namespace {
 static bool validateNodeName(const std::string& nodeName)
 {
     return nodeName.find('/') == std::string::npos;
 }
+
+template <class T>
+static void appendKey(std::vector<char>& key, const T& value)
+{
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    key.insert(key.end(), bytes, bytes + sizeof(T));
+}
+
+static void appendKey(std::vector<char>& key, const std::string& value)
+{
+    appendKey(key, value.size());
+    key.insert(key.end(), value.begin(), value.end());
+}
+
+// Counts bytes copied by copy-on-write flow data while node runs on this thread
+struct CopyCounterScope
+{
+    explicit CopyCounterScope(std::atomic<std::uint64_t>& counter)
+    {
+        NodeFlowData::setCopyCounter(&counter);
+    }
+
+    ~CopyCounterScope()
+    {
+        NodeFlowData::setCopyCounter(nullptr);
+    }
+};
 }
 
 NodeTree::NodeTree(NodeSystem* nodeSystem)
-    : _nodeSystem(nodeSystem)
+    : _linkIndexDirty(false)
+    , _topologicalHoles(0)
+    , _blockedNodesDirty(false)
+    , _visitGeneration(0)
+    , _nodeSystem(nodeSystem)
     , _executeListDirty(false)
+    , _parallelExecution(false)
+    , _pipelinedExecution(false)
+    , _frameCount(0)
+    , _pipelinePendingFrame(0)
+    , _bufferPool(new ImageBufferPool())
+    , _bytesCopied(0)
+    , _memoVersion(0)
+    , _memoization(false)
 {
 }
 
@@ -52,9 +232,29 @@ void NodeTree::clear()
     _nodes.clear();
     _recycledIDs.clear();
     _links.clear();
+    _outLinkOffsets.clear();
+    _inLinks.clear();
+    _inLinkOffsets.clear();
+    _inputLinks.clear();
+    _inputLinkOffsets.clear();
+    _linkIndexDirty = false;
+    _topologicalOrder.clear();
+    _topologicalPositions.clear();
+    _topologicalHoles = 0;
+    _blockedNodes.clear();
+    _blockedNodesDirty = false;
+    _taggedNodes.clear();
+    _visitMarks.clear();
+    _visitGeneration = 0;
     _executeList.clear();
+    _executePositions.clear();
     _nodeNameToNodeID.clear();
     _executeListDirty = false;
+    _pipelineStages.clear();
+    _pipelineSwapped.clear();
+    _pipelinePending.clear();
+    _outputFrames.clear();
+    _memos.clear();
 }
 
 size_t NodeTree::nodesCount() const
@@ -72,7 +272,11 @@ void NodeTree::tagNode(NodeID nodeID)
     if(!validateNode(nodeID))
         return;
 
-    _nodes[nodeID].setFlag(ENodeFlags::Tagged);
+    Node& node = _nodes[nodeID];
+    if(!node.flag(ENodeFlags::Tagged))
+        _taggedNodes.push_back(nodeID);
+
+    node.setFlag(ENodeFlags::Tagged);
     _executeListDirty = true;
 }
 
@@ -100,6 +304,7 @@ void NodeTree::setNodeEnable(NodeID nodeID, bool enable)
     if(node.flag(ENodeFlags::Disabled) == enable)
     {
         _executeListDirty = true;
+        _blockedNodesDirty = true;
 
         if(enable)
             node.unsetFlag(ENodeFlags::Disabled);
@@ -131,103 +336,868 @@ std::vector<NodeID> NodeTree::prepareList()
     if(!_executeListDirty)
         return _executeList;
 
-    prepareListImpl();
+    prepareListImpl();
+
+    _executeListDirty = false;
+    return _executeList;
+}
+
+void NodeTree::handleException(NodeID nodeID, const NodeSocketTracer& tracer)
+{
+    // Exception dispatcher pattern
+    try
+    {
+        _executeListDirty = true;
+        throw;
+    }
+    catch(ExecutionError&)
+    {
+        // Dummy but a must - if not std::exception handler would catch it
+        throw;
+    }
+    catch(BadConnectionException& ex)
+    {
+        if (tracer.isLastOutput())
+            // Means node tried to acquired socket
+            // with different type than declared in config
+            throw BadConfigException();
+        ex.node = tracer.lastNode();
+        ex.socket = tracer.lastSocket();
+        throw;
+    }
+    catch(cv::Exception& ex)
+    {
+        throw ExecutionError(nodeName(nodeID), nodeTypeName(nodeID), 
+            std::string("OpenCV exception - ") + ex.what());
+    }
+    catch(std::exception& ex)
+    {
+        throw ExecutionError(nodeName(nodeID), nodeTypeName(nodeID), ex.what());
+    }
+}
+
+void NodeTree::execute(bool withInit)
+{
+    // Worker threads only read the link index
+    if(_linkIndexDirty)
+        rebuildLinkIndex();
+    if(_executeListDirty)
+        prepareList();
+
+    ++_frameCount;
+    _bytesCopied = 0;
+
+    if(_pipelinedExecution)
+    {
+        executePipelined(withInit);
+        return;
+    }
+
+    if(_parallelExecution)
+    {
+        executeParallel(withInit);
+        return;
+    }
+
+    NodeSocketTracer tracer;
+    NodeSocketReader reader(this, tracer);
+    NodeSocketWriter writer(tracer, _bufferPool.get());
+    const bool memoization = isMemoizationActive();
+
+    // Traverse through just-built exec list and process each node 
+    for(NodeID nodeID : _executeList)
+    {
+        Node& node = _nodes[nodeID];
+        // Node is going to be executed - untag it
+        node.unsetFlag(ENodeFlags::Tagged);
+        _outputFrames[nodeID] = _frameCount;
+
+        if(memoization && reuseMemoizedOutputs(nodeID))
+            continue;
+
+        tracer.setNode(nodeID);
+        reader.setNode(nodeID, node.numInputSockets());
+
+        try
+        {
+            if(withInit && _nodes[nodeID].flag(ENodeFlags::StateNode))
+            {
+                // Try to restart node internal state if any
+                if(!node.restart())
+                {
+                    throw ExecutionError{node.nodeName(), nodeTypeName(nodeID), 
+                        "Error during node state restart"};
+                }
+            }
+
+            CopyCounterScope copyCounter(_bytesCopied);
+            HighResolutionClock::time_point start = HighResolutionClock::now();
+            ExecutionStatus ret = node.execute(reader, writer);
+            if(_profiler)
+                profileNode(nodeID, start, std::this_thread::get_id());
+            if(memoization)
+                updateMemo(nodeID, ret);
+
+            switch (ret.status)
+            {
+            case EStatus::Tag:
+                // Tag for next execution
+                tagNode(nodeID);
+                break;
+
+            case EStatus::Error:
+                // If node reported an error
+                tagNode(nodeID);
+                throw ExecutionError{node.nodeName(), nodeTypeName(nodeID), 
+                    ret.message};
+                break;
+
+            case EStatus::Ok:
+            default:
+                break;
+            }
+        }
+        catch(...)
+        {
+            // Node was untagged before - make sure it runs again next time
+            tagNode(nodeID);
+            handleException(nodeID, tracer);
+        }
+    }
+
+    _executeListDirty = true;
+}
+
+// Everything a node needs to be executed independently of others
+struct NodeTree::NodeTask
+{
+    explicit NodeTask(NodeTree* tree)
+        : nodeID(InvalidNodeID)
+        , reader(tree, tracer)
+        , writer(tracer, tree->_bufferPool.get())
+        , frame(tree->_frameCount)
+        , executed(false)
+        , memoized(false)
+    {
+    }
+
+    NodeID nodeID;
+    NodeSocketTracer tracer;
+    NodeSocketReader reader;
+    NodeSocketWriter writer;
+    ExecutionStatus status;
+    std::exception_ptr error;
+    HighResolutionClock::time_point start;
+    std::thread::id thread;
+    // Frame (execute() step) the node is working on
+    std::uint64_t frame;
+    // Node was run (or skipped) - nodes after a failure never are
+    bool executed;
+    // Node was skipped and kept its previous outputs
+    bool memoized;
+};
+
+void NodeTree::runNodeTask(NodeTask& task, bool withInit)
+{
+    NodeID nodeID = task.nodeID;
+    Node& node = _nodes[nodeID];
+    // Node is going to be executed - untag it
+    node.unsetFlag(ENodeFlags::Tagged);
+    task.executed = true;
+    _outputFrames[nodeID] = task.frame;
+
+    const bool memoization = isMemoizationActive();
+    task.memoized = memoization && reuseMemoizedOutputs(nodeID);
+    if(task.memoized)
+        return;
+
+    task.tracer.setNode(nodeID);
+    task.reader.setNode(nodeID, node.numInputSockets());
+
+    try
+    {
+        if(withInit && node.flag(ENodeFlags::StateNode))
+        {
+            // Try to restart node internal state if any
+            if(!node.restart())
+            {
+                throw ExecutionError{node.nodeName(), nodeTypeName(nodeID),
+                    "Error during node state restart"};
+            }
+        }
+
+        CopyCounterScope copyCounter(_bytesCopied);
+        task.start = HighResolutionClock::now();
+        task.thread = std::this_thread::get_id();
+        task.status = node.execute(task.reader, task.writer);
+        if(memoization)
+            updateMemo(nodeID, task.status);
+    }
+    catch(...)
+    {
+        task.error = std::current_exception();
+    }
+}
+
+void NodeTree::finishNodeTask(const NodeTask& task)
+{
+    NodeID nodeID = task.nodeID;
+
+    if(_profiler && !task.error && !task.memoized)
+        profileNode(nodeID, task.start, task.thread);
+
+    try
+    {
+        if(task.error)
+            std::rethrow_exception(task.error);
+
+        switch(task.status.status)
+        {
+        case EStatus::Tag:
+            // Tag for next execution
+            tagNode(nodeID);
+            break;
+
+        case EStatus::Error:
+            // If node reported an error
+            tagNode(nodeID);
+            throw ExecutionError{_nodes[nodeID].nodeName(), 
+                nodeTypeName(nodeID), task.status.message};
+            break;
+
+        case EStatus::Ok:
+        default:
+            break;
+        }
+    }
+    catch(...)
+    {
+        // Node was untagged before - make sure it runs again next time
+        tagNode(nodeID);
+        handleException(nodeID, task.tracer);
+    }
+}
+
+void NodeTree::executeParallel(bool withInit)
+{
+    const size_t count = _executeList.size();
+
+    std::vector<std::unique_ptr<NodeTask>> tasks;
+    tasks.reserve(count);
+    // Number of links coming from nodes that still need to be executed
+    std::vector<size_t> pending(count, 0);
+
+    for(size_t pos = 0; pos < count; ++pos)
+    {
+        tasks.emplace_back(new NodeTask(this));
+        tasks.back()->nodeID = _executeList[pos];
+
+        size_t link, link_end;
+        std::tie(link, link_end) = outLinks(_executeList[pos]);
+        for(; link != link_end; ++link)
+        {
+            const size_t toPos = _executePositions[_links[link].toNode];
+            if(toPos < count)
+                ++pending[toPos];
+        }
+    }
+
+    // Nodes belonging to a module (e.g. OpenCL) share its resources
+    // (command queue, kernels) so they are run on the calling thread
+    auto isSerial = [&](size_t pos) {
+        return !_nodes[_executeList[pos]].config().module().empty();
+    };
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::deque<size_t> serialReady;
+    // Nodes scheduled but not finished yet
+    size_t running = 0;
+    bool failed = false;
+
+#if defined(HAVE_TBB)
+    tbb::task_group group;
+#else
+    if(!_workerPool)
+        _workerPool.reset(new WorkerPool(std::max(std::thread::hardware_concurrency(), 1U)));
+#endif
+
+    std::function<void(size_t)> spawn;
+    // Executes given node and then any node it made ready (on the same thread)
+    auto runTask = [&](size_t pos)
+    {
+        std::vector<size_t> ready;
+
+        for(;;)
+        {
+            NodeTask& task = *tasks[pos];
+            runNodeTask(task, withInit);
+
+            ready.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+
+            // Stop scheduling at first failure - just like sequential execution
+            if(task.error || task.status.status == EStatus::Error)
+                failed = true;
+
+            if(!failed)
+            {
+                size_t link, link_end;
+                std::tie(link, link_end) = outLinks(task.nodeID);
+                for(; link != link_end; ++link)
+                {
+                    const size_t toPos = _executePositions[_links[link].toNode];
+                    if(toPos >= count || --pending[toPos] > 0)
+                        continue;
+
+                    ++running;
+                    if(isSerial(toPos))
+                        serialReady.push_back(toPos);
+                    else
+                        ready.push_back(toPos);
+                }
+            }
+
+            --running;
+            // Notify under the lock - waiting thread might return right after
+            finished.notify_one();
+
+            if(ready.empty())
+                return;
+
+            for(size_t i = 1; i < ready.size(); ++i)
+                spawn(ready[i]);
+            pos = ready.front();
+        }
+    };
+
+    spawn = [&](size_t pos)
+    {
+#if defined(HAVE_TBB)
+        group.run([&runTask, pos] { runTask(pos); });
+#else
+        _workerPool->submit([&runTask, pos] { runTask(pos); });
+#endif
+    };
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for(size_t pos = 0; pos < count; ++pos)
+    {
+        if(pending[pos] > 0)
+            continue;
+
+        ++running;
+        if(isSerial(pos))
+            serialReady.push_back(pos);
+        else
+            spawn(pos);
+    }
+
+    for(;;)
+    {
+        if(!serialReady.empty())
+        {
+            size_t pos = serialReady.front();
+            serialReady.pop_front();
+
+            lock.unlock();
+            runTask(pos);
+            lock.lock();
+        }
+        else if(running > 0)
+        {
+            finished.wait(lock);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    lock.unlock();
+#if defined(HAVE_TBB)
+    group.wait();
+#endif
+
+    // Process results in the same order as sequential execution would
+    for(const auto& task : tasks)
+    {
+        if(task->executed)
+            finishNodeTask(*task);
+    }
+
+    _executeListDirty = true;
+}
+
+void NodeTree::executePipelined(bool withInit)
+{
+    if(withInit || !isPipelineValid())
+        preparePipeline();
+
+    std::vector<std::unique_ptr<NodeTask>> upstream, downstream;
+    std::vector<NodeID> nextPending;
+    std::fill(std::begin(_pipelineSwapped), std::end(_pipelineSwapped), 0);
+
+    // Partition execute list preserving topological order within each stage.
+    // Downstream part will process the frame produced now during next step.
+    for(NodeID nodeID : _executeList)
+    {
+        if(_pipelineStages[nodeID] == 0)
+        {
+            upstream.emplace_back(new NodeTask(this));
+            upstream.back()->nodeID = nodeID;
+        }
+        else
+        {
+            nextPending.push_back(nodeID);
+        }
+    }
+
+    for(NodeID nodeID : _pipelinePending)
+    {
+        if(!validateNode(nodeID))
+            continue;
+        downstream.emplace_back(new NodeTask(this));
+        downstream.back()->nodeID = nodeID;
+        downstream.back()->frame = _pipelinePendingFrame;
+    }
+
+    // Stateful downstream nodes are restarted now even though
+    // they will see their first frame during next step
+    if(withInit)
+    {
+        for(NodeID nodeID : nextPending)
+        {
+            Node& node = _nodes[nodeID];
+            if(!node.flag(ENodeFlags::StateNode) || node.restart())
+                continue;
+
+            NodeSocketTracer tracer;
+            tracer.setNode(nodeID);
+
+            try
+            {
+                throw ExecutionError{node.nodeName(), nodeTypeName(nodeID),
+                    "Error during node state restart"};
+            }
+            catch(...)
+            {
+                handleException(nodeID, tracer);
+            }
+        }
+    }
+
+    // Upstream nodes are going to write next frame - keep previous one
+    // available for downstream stage
+    for(const auto& task : upstream)
+    {
+        _nodes[task->nodeID].swapOutputSockets();
+        _pipelineSwapped[task->nodeID] = 1;
+    }
+
+    if(downstream.empty())
+    {
+        runStage(upstream, withInit);
+    }
+    else
+    {
+        if(!_stageWorker)
+            _stageWorker.reset(new WorkerPool(1));
+
+        std::promise<void> downstreamDone;
+        _stageWorker->submit([&] {
+            runStage(downstream, false);
+            downstreamDone.set_value();
+        });
+        runStage(upstream, withInit);
+        downstreamDone.get_future().wait();
+    }
+
+    // Upstream produced a valid frame only if all of its streaming
+    // sources asked to be executed again (otherwise stream has ended)
+    bool frameProduced = !upstream.empty();
+    for(const auto& task : upstream)
+    {
+        if(_nodes[task->nodeID].flag(ENodeFlags::AutoTag)
+            && (task->error || task->status.status != EStatus::Tag))
+        {
+            frameProduced = false;
+        }
+    }
+
+    // Frame dropped at the end of stream is never sent downstream
+    _pipelinePending.clear();
+    if(frameProduced)
+    {
+        _pipelinePending = std::move(nextPending);
+        _pipelinePendingFrame = _frameCount;
+    }
+
+    for(const auto& task : upstream)
+        finishNodeTask(*task);
+    for(const auto& task : downstream)
+        finishNodeTask(*task);
+
+    _executeListDirty = true;
+}
+
+void NodeTree::flushPipeline()
+{
+    _bytesCopied = 0;
+    if(!_pipelinedExecution || _pipelinePending.empty() || !isPipelineValid())
+        return;
+
+    std::vector<std::unique_ptr<NodeTask>> downstream;
+    for(NodeID nodeID : _pipelinePending)
+    {
+        if(!validateNode(nodeID))
+            continue;
+        downstream.emplace_back(new NodeTask(this));
+        downstream.back()->nodeID = nodeID;
+        downstream.back()->frame = _pipelinePendingFrame;
+    }
+
+    // Last frame is in current output sockets of upstream nodes
+    std::fill(std::begin(_pipelineSwapped), std::end(_pipelineSwapped), 0);
+    _pipelinePending.clear();
+
+    runStage(downstream, false);
+
+    for(const auto& task : downstream)
+        finishNodeTask(*task);
+
+    _executeListDirty = true;
+}
+
+void NodeTree::runStage(std::vector<std::unique_ptr<NodeTask>>& tasks, bool withInit)
+{
+    for(auto it = std::begin(tasks); it != std::end(tasks); ++it)
+    {
+        NodeTask& task = **it;
+        // Other stage might be running a module node at the same time
+        if(!_nodes[task.nodeID].config().module().empty())
+        {
+            std::lock_guard<std::mutex> lock(_moduleMutex);
+            runNodeTask(task, withInit);
+        }
+        else
+        {
+            runNodeTask(task, withInit);
+        }
+
+        // Stop at first failure - just like sequential execution
+        if(task.error || task.status.status == EStatus::Error)
+        {
+            tasks.erase(it + 1, std::end(tasks));
+            break;
+        }
+    }
+}
+
+// Splits all valid nodes into two stages so that no link goes from
+// downstream to upstream stage while balancing time spent in each of them
+void NodeTree::preparePipeline()
+{
+    _pipelineStages.assign(_nodes.size(), 0);
+    _pipelineSwapped.assign(_nodes.size(), 0);
+    _pipelinePending.clear();
+
+    // Compute level of each node (longest path from any source node)
+    std::vector<size_t> levels(_nodes.size(), 0);
+    std::vector<size_t> inDegree(_nodes.size(), 0);
+    for(const NodeLink& link : _links)
+        ++inDegree[link.toNode];
+
+    std::vector<NodeID> queue;
+    for(NodeID nodeID = 0; nodeID < NodeID(_nodes.size()); ++nodeID)
+    {
+        if(validateNode(nodeID) && inDegree[nodeID] == 0)
+            queue.push_back(nodeID);
+    }
+
+    size_t maxLevel = 0;
+    for(size_t i = 0; i < queue.size(); ++i)
+    {
+        NodeID nodeID = queue[i];
+        maxLevel = std::max(maxLevel, levels[nodeID]);
+
+        size_t link, link_end;
+        std::tie(link, link_end) = outLinks(nodeID);
+        for(; link != link_end; ++link)
+        {
+            NodeID toNodeID = _links[link].toNode;
+            levels[toNodeID] = std::max(levels[toNodeID], levels[nodeID] + 1);
+            if(--inDegree[toNodeID] == 0)
+                queue.push_back(toNodeID);
+        }
+    }
+
+    // Use last measured execution times as a cost of each level
+    std::vector<double> levelCost(maxLevel + 1, 0.0);
+    for(NodeID nodeID : queue)
+        levelCost[levels[nodeID]] += std::max(_nodes[nodeID].timeElapsed(), 1e-3);
+
+    double totalCost = std::accumulate(std::begin(levelCost), std::end(levelCost), 0.0);
+    double upstreamCost = 0.0;
+    double bestCost = totalCost;
+    size_t splitLevel = maxLevel + 1;
+
+    for(size_t level = 1; level <= maxLevel; ++level)
+    {
+        upstreamCost += levelCost[level - 1];
+        double cost = std::max(upstreamCost, totalCost - upstreamCost);
+        if(cost < bestCost)
+        {
+            bestCost = cost;
+            splitLevel = level;
+        }
+    }
+
+    for(NodeID nodeID : queue)
+        _pipelineStages[nodeID] = levels[nodeID] < splitLevel ? 0 : 1;
+}
+
+bool NodeTree::isPipelineValid() const
+{
+    if(_pipelineStages.size() != _nodes.size())
+        return false;
+
+    // Links can only go forward (or within one stage)
+    return std::none_of(std::begin(_links), std::end(_links),
+        [&](const NodeLink& link) {
+            return _pipelineStages[link.fromNode] > _pipelineStages[link.toNode];
+        });
+}
+
+const NodeFlowData& NodeTree::readOutputSocket(NodeID nodeID, 
+                                               SocketAddress outputAddr) const
+{
+    // Downstream stage needs to see previous frame of upstream nodes
+    if(_pipelinedExecution
+        && !_pipelineSwapped.empty()
+        && _pipelineSwapped[outputAddr.node]
+        && _pipelineStages[nodeID] > _pipelineStages[outputAddr.node])
+    {
+        if(!validateNode(outputAddr.node))
+            throw BadNodeException();
+
+        return _nodes[outputAddr.node].delayedOutputSocket(outputAddr.socket);
+    }
+
+    return outputSocket(outputAddr.node, outputAddr.socket);
+}
+
+void NodeTree::setPipelinedExecution(bool enable)
+{
+    _pipelinedExecution = enable;
+    _pipelineStages.clear();
+    _pipelineSwapped.clear();
+    _pipelinePending.clear();
+    // Versions aren't tracked in pipelined mode
+    resetMemos();
+}
+
+bool NodeTree::pipelinedExecution() const
+{
+    return _pipelinedExecution;
+}
+
+std::uint64_t NodeTree::outputFrame(NodeID nodeID) const
+{
+    if(!validateNode(nodeID))
+        throw BadNodeException();
+    return _outputFrames[nodeID];
+}
+
+void NodeTree::setProfilingEnabled(bool enable)
+{
+    if(!enable)
+        _profiler.reset();
+    else if(!_profiler)
+        _profiler.reset(new NodeProfiler());
+}
+
+bool NodeTree::isProfilingEnabled() const
+{
+    return static_cast<bool>(_profiler);
+}
+
+NodeProfiler* NodeTree::profiler()
+{
+    return _profiler.get();
+}
+
+const NodeProfiler* NodeTree::profiler() const
+{
+    return _profiler.get();
+}
+
+void NodeTree::profileNode(NodeID nodeID, HighResolutionClock::time_point start,
+                           std::thread::id thread)
+{
+    const Node& node = _nodes[nodeID];
+
+    std::vector<size_t> outputBytes(node.numOutputSockets());
+    for(SocketID socketID = 0; socketID < node.numOutputSockets(); ++socketID)
+        outputBytes[socketID] = node.outputSocket(socketID).byteSize();
+
+    NodeProfiler::Sample sample;
+    sample.nodeID = nodeID;
+    sample.start = start;
+    sample.elapsed = node.timeElapsed();
+    sample.deviceElapsed = node.deviceTimeElapsed();
+    sample.thread = thread;
+
+    _profiler->addSample(sample, node.nodeName(), nodeTypeName(nodeID), outputBytes);
+}
+
+std::uint64_t NodeTree::bytesCopied() const
+{
+    return _bytesCopied;
+}
+
+ImageBufferPool& NodeTree::bufferPool()
+{
+    return *_bufferPool;
+}
+
+const ImageBufferPool& NodeTree::bufferPool() const
+{
+    return *_bufferPool;
+}
+
+void NodeTree::setMemoizationEnabled(bool enable)
+{
+    if(_memoization == enable)
+        return;
+
+    _memoization = enable;
+    resetMemos();
+}
+
+bool NodeTree::isMemoizationEnabled() const
+{
+    return _memoization;
+}
 
-    _executeListDirty = false;
-    return _executeList;
+bool NodeTree::isMemoizationActive() const
+{
+    // Swapped output sockets of pipelined mode would hold stale data
+    return _memoization && !_pipelinedExecution;
 }
 
-void NodeTree::handleException(NodeID nodeID, const NodeSocketTracer& tracer)
+void NodeTree::resetMemos()
 {
-    // Exception dispatcher pattern
-    try
+    // Versions are never reused so no old key can match again
+    for(NodeMemo& memo : _memos)
     {
-        _executeListDirty = true;
-        throw;
+        memo = NodeMemo();
+        memo.version = ++_memoVersion;
     }
-    catch(ExecutionError&)
+}
+
+bool NodeTree::reuseMemoizedOutputs(NodeID nodeID)
+{
+    const Node& node = _nodes[nodeID];
+    NodeMemo& memo = _memos[nodeID];
+
+    // Only nodes being pure function of their properties and inputs can be
+    // skipped. Sources are always executed as they read external data.
+    // Module (GPU) nodes qualify too - their outputs stay untouched while
+    // they're skipped even though we can't hash them
+    if(node.flag(ENodeFlags::StateNode) 
+        || node.flag(ENodeFlags::AutoTag)
+        || node.numInputSockets() == 0)
     {
-        // Dummy but a must - if not std::exception handler would catch it
-        throw;
+        memo.valid = false;
+        memo.key.clear();
+        return false;
     }
-    catch(BadConnectionException& ex)
+
+    std::vector<char> key;
+    key.reserve(memo.key.size());
+
+    for(const PropertyConfig& propConfig : node.config().properties())
     {
-        if (tracer.isLastOutput())
-            // Means node tried to acquired socket
-            // with different type than declared in config
-            throw BadConfigException();
-        ex.node = tracer.lastNode();
-        ex.socket = tracer.lastSocket();
-        throw;
+        const NodeProperty& prop = propConfig.propertyValue();
+        appendKey(key, prop.type());
+
+        switch(prop.type())
+        {
+        case EPropertyType::Boolean: appendKey(key, prop.toBool()); break;
+        case EPropertyType::Integer: appendKey(key, prop.toInt()); break;
+        case EPropertyType::Double: appendKey(key, prop.toDouble()); break;
+        case EPropertyType::Enum: appendKey(key, prop.toEnum().data()); break;
+        case EPropertyType::Matrix: appendKey(key, prop.toMatrix3x3()); break;
+        case EPropertyType::Filepath: appendKey(key, prop.toFilepath().data()); break;
+        case EPropertyType::String: appendKey(key, prop.toString()); break;
+        case EPropertyType::Unknown:
+        default:
+            break;
+        }
     }
-    catch(cv::Exception& ex)
+
+    for(SocketID socketID = 0; socketID < node.numInputSockets(); ++socketID)
     {
-        throw ExecutionError(nodeName(nodeID), nodeTypeName(nodeID), 
-            std::string("OpenCV exception - ") + ex.what());
+        SocketAddress from = connectedFrom(SocketAddress(nodeID, socketID, false));
+        appendKey(key, from.node);
+        appendKey(key, from.socket);
+        appendKey(key, from.isValid() ? _memos[from.node].version : std::uint64_t(0));
     }
-    catch(std::exception& ex)
+
+    if(memo.valid && memo.key == key)
     {
-        throw ExecutionError(nodeName(nodeID), nodeTypeName(nodeID), ex.what());
+        _nodes[nodeID].skipExecution();
+        return true;
     }
+
+    memo.valid = false;
+    memo.key = std::move(key);
+    return false;
 }
 
-void NodeTree::execute(bool withInit)
+void NodeTree::updateMemo(NodeID nodeID, const ExecutionStatus& status)
 {
-    if(_executeListDirty)
-        prepareList();
+    const Node& node = _nodes[nodeID];
+    NodeMemo& memo = _memos[nodeID];
 
-    NodeSocketTracer tracer;
-    NodeSocketReader reader(this, tracer);
-    NodeSocketWriter writer(tracer);
+    bool changed = memo.outputs.size() != node.numOutputSockets();
+    memo.outputs.resize(node.numOutputSockets(), 
+        NodeMemo::Digest{ENodeFlowDataType::Invalid, 0, 0});
 
-    // Traverse through just-built exec list and process each node 
-    for(NodeID nodeID : _executeList)
+    for(SocketID socketID = 0; socketID < node.numOutputSockets(); ++socketID)
     {
-        Node& node = _nodes[nodeID];
-
-        tracer.setNode(nodeID);
-        reader.setNode(nodeID, node.numInputSockets());
-
-        try
+        const NodeFlowData& data = node.outputSocket(socketID);
+        NodeMemo::Digest digest{data.type(), data.byteSize(), 0};
+
+        // Data we can't inspect is assumed to be changed
+        if(!data.contentHash(digest.hash)
+            || digest.type != memo.outputs[socketID].type
+            || digest.bytes != memo.outputs[socketID].bytes
+            || digest.hash != memo.outputs[socketID].hash)
         {
-            if(withInit && _nodes[nodeID].flag(ENodeFlags::StateNode))
-            {
-                // Try to restart node internal state if any
-                if(!node.restart())
-                {
-                    throw ExecutionError{node.nodeName(), nodeTypeName(nodeID), 
-                        "Error during node state restart"};
-                }
-            }
-
-            ExecutionStatus ret = node.execute(reader, writer);
+            changed = true;
+        }
+        memo.outputs[socketID] = digest;
+    }
 
-            switch (ret.status)
-            {
-            case EStatus::Tag:
-                // Tag for next execution
-                tagNode(nodeID);
-                break;
+    // Bit-identical outputs keep the version so descendants can be skipped
+    if(changed)
+        memo.version = ++_memoVersion;
 
-            case EStatus::Error:
-                // If node reported an error
-                tagNode(nodeID);
-                throw ExecutionError{node.nodeName(), nodeTypeName(nodeID), 
-                    ret.message};
-                break;
+    // Node asking for another execution can't be skipped next time
+    memo.valid = !memo.key.empty() && status.status == EStatus::Ok;
+}
 
-            case EStatus::Ok:
-            default:
-                break;
-            }
-        }
-        catch(...)
-        {
-            handleException(nodeID, tracer);
-        }
-    }
+void NodeTree::setParallelExecution(bool enable)
+{
+    _parallelExecution = enable;
+}
 
-    _executeListDirty = true;
+bool NodeTree::parallelExecution() const
+{
+    return _parallelExecution;
 }
 
 void NodeTree::notifyFinish()
@@ -300,6 +1270,8 @@ NodeID NodeTree::createNode(NodeTypeID typeID, const std::string& name)
 
     // Create actual node object
     _nodes[id] = Node(std::move(nodeType), name, typeID);
+    appendToTopologicalOrder(id);
+    _blockedNodesDirty = true;
     // Add the pair <node name, node ID> to hash map
     _nodeNameToNodeID.insert(std::make_pair(name, id));
     // Tag it for next execution
@@ -329,9 +1301,7 @@ bool NodeTree::removeNode(NodeID nodeID)
                    nodeLink.toNode   == nodeID;
         });
     _links.erase(removeFirstNodeLink, std::end(_links));
-
-    // Keep links sorted
-    std::sort(std::begin(_links), std::end(_links));
+    invalidateLinkIndex();
 
     // Finally remove the node
     deallocateNodeID(nodeID);
@@ -390,39 +1360,15 @@ ELinkNodesResult NodeTree::linkNodes(SocketAddress from, SocketAddress to)
         return ELinkNodesResult::InvalidAddress;
 
     // Check if we are not trying to link input socket with more than one output
-    bool alreadyExisingConnection = std::any_of(std::begin(_links), std::end(_links), 
-        [&](const NodeLink& link) {
-            return link.toNode == to.node && link.toSocket == to.socket;
-        });
-    if(alreadyExisingConnection)
+    if(inputLink(to.node, to.socket) != _links.size())
         return ELinkNodesResult::TwoOutputsOnInput;
 
-    // Try to make a connection
-    _links.emplace_back(NodeLink(from, to));
-
-    // Keep links sorted
-    std::sort(std::begin(_links), std::end(_links));
-
-    // Check for created cycle(s)
-    if(checkCycle(to.node))
-    {
-        // Look for given node link
-        NodeLink nodeLinkToFind(from, to);
-        auto iter = std::lower_bound(std::begin(_links), 
-            std::end(_links), nodeLinkToFind);
-
-        assert(iter != std::end(_links));
-
-        if(iter != std::end(_links))
-        {
-            _links.erase(iter);
-
-            // Keep links sorted
-            std::sort(std::begin(_links), std::end(_links));
-        }
-
+    // Check for cycle(s) that would be created and keep nodes sorted topologically
+    if(!updateTopologicalOrder(from.node, to.node))
         return ELinkNodesResult::CycleDetected;
-    }
+
+    // Make a connection
+    insertLink(NodeLink(from, to));
 
     // tag affected node
     tagNode(to.node);
@@ -445,10 +1391,9 @@ bool NodeTree::unlinkNodes(SocketAddress from, SocketAddress to)
         // Need to store ID before erase() invalidates iterator
         NodeID nodeID = iter->toNode;
 
+        // Removing a link keeps links sorted and topological order valid
         _links.erase(iter);
-
-        // Keep links sorted
-        std::sort(std::begin(_links), std::end(_links));
+        invalidateLinkIndex();
 
         // tag affected node
         tagNode(nodeID);
@@ -538,23 +1483,18 @@ const std::string& NodeTree::nodeTypeName(NodeID nodeID) const
 
 SocketAddress NodeTree::connectedFrom(SocketAddress iSocketAddr) const
 {
-    // This function does not rely on a assumption that links are sorted
     SocketAddress ret(InvalidNodeID, InvalidSocketID, false);
 
-    // ... and only works when addr points to input socket
+    // Only works when addr points to input socket
     if(iSocketAddr.isOutput)
         return ret;
 
-    for(const NodeLink& link: _links)
+    size_t link = inputLink(iSocketAddr.node, iSocketAddr.socket);
+    if(link != _links.size())
     {
-        if(link.toNode == iSocketAddr.node &&
-           link.toSocket == iSocketAddr.socket)
-        {
-            ret.node = link.fromNode;
-            ret.socket = link.fromSocket;
-            ret.isOutput = true;
-            break;
-        }
+        ret.node = _links[link].fromNode;
+        ret.socket = _links[link].fromSocket;
+        ret.isOutput = true;
     }
 
     return ret;
@@ -608,8 +1548,7 @@ bool NodeTree::allRequiredInputSocketConnected(NodeID nodeID) const
 
     for(SocketID socketID = 0; socketID < node.numInputSockets(); ++socketID)
     {
-        SocketAddress outputAddr = connectedFrom(SocketAddress(nodeID, socketID, false));
-        if(outputAddr.node == InvalidNodeID || outputAddr.socket == InvalidSocketID)
+        if(inputLink(nodeID, socketID) == _links.size())
             return false;
     }
 
@@ -621,7 +1560,7 @@ bool NodeTree::taggedButNotExecuted(NodeID nodeID) const
     // Node is tagged ..
     if(_nodes[nodeID].flag(ENodeFlags::Tagged)
         // .. and isn't on the executed list
-        && std::find(_executeList.begin(), _executeList.end(), nodeID) == _executeList.end())
+        && _executePositions[nodeID] == std::numeric_limits<size_t>::max())
     {
         return true;
     }
@@ -679,6 +1618,14 @@ double NodeTree::nodeTimeElapsed(NodeID nodeID) const
     return _nodes[nodeID].timeElapsed();
 }
 
+double NodeTree::nodeDeviceTimeElapsed(NodeID nodeID) const
+{
+    if(!validateNode(nodeID))
+        return 0.0;
+
+    return _nodes[nodeID].deviceTimeElapsed();
+}
+
 NodeID NodeTree::allocateNodeID()
 {
     NodeID id = InvalidNodeID;
@@ -690,6 +1637,13 @@ NodeID NodeTree::allocateNodeID()
         id = NodeID(_nodes.size());
         // Expand node array - createNode relies on it
         _nodes.resize(_nodes.size() + 1); 
+        _memos.resize(_nodes.size());
+        _outputFrames.resize(_nodes.size(), 0);
+        _visitMarks.resize(_nodes.size(), 0);
+        _executePositions.resize(_nodes.size(), 
+            std::numeric_limits<size_t>::max());
+        _topologicalPositions.resize(_nodes.size(), 
+            std::numeric_limits<size_t>::max());
     }
     else
     {
@@ -710,9 +1664,14 @@ void NodeTree::deallocateNodeID(NodeID id)
     _nodeNameToNodeID.erase(_nodes[id].nodeName());
 
     untagNode(id);
+    removeFromTopologicalOrder(id);
+    _blockedNodesDirty = true;
 
     // Invalidate node
     _nodes[id] = Node();
+    _memos[id] = NodeMemo();
+    _memos[id].version = ++_memoVersion;
+    _outputFrames[id] = 0;
 
     // Add NodeID to recycled ones
     _recycledIDs.push_back(id);
@@ -721,44 +1680,108 @@ void NodeTree::deallocateNodeID(NodeID id)
 size_t NodeTree::firstOutputLink(NodeID fromNode,
     SocketID fromSocket, size_t start) const
 {
-    for(size_t i = start; i < _links.size(); ++i)
-    {
-        const auto& link = _links[i];
+    size_t link, link_end;
+    std::tie(link, link_end) = outLinks(fromNode);
 
-        if(link.fromNode == fromNode &&
-           link.fromSocket == fromSocket)
-        {
+    for(size_t i = std::max(start, link); i < link_end; ++i)
+    {
+        if(_links[i].fromSocket == fromSocket)
             return i;
-        }
     }
     return _links.size();
 }
 
 std::tuple<size_t, size_t> NodeTree::outLinks(NodeID fromNode) const
 {
-    auto start = std::find_if(std::begin(_links), std::end(_links), 
-        [=](const NodeLink& link) {
-            return link.fromNode == fromNode;
-    });
+    if(_linkIndexDirty)
+        rebuildLinkIndex();
 
-    // There are some output links from this node
-    if(start != std::end(_links))
-    {
-        // Now, get last+1 output link index
-        auto end = std::find_if(start + 1, std::end(_links), 
-            [=](const NodeLink& link) {
-                return link.fromNode != fromNode;
-        });
+    // No output links from this node (or node is newer than the index)
+    if(size_t(fromNode) + 1 >= _outLinkOffsets.size())
+        return std::make_tuple(_links.size(), _links.size());
+
+    return std::make_tuple(_outLinkOffsets[fromNode], _outLinkOffsets[fromNode + 1]);
+}
+
+std::tuple<size_t, size_t> NodeTree::inLinks(NodeID toNode) const
+{
+    if(_linkIndexDirty)
+        rebuildLinkIndex();
+
+    if(size_t(toNode) + 1 >= _inLinkOffsets.size())
+        return std::make_tuple(_inLinks.size(), _inLinks.size());
+
+    return std::make_tuple(_inLinkOffsets[toNode], _inLinkOffsets[toNode + 1]);
+}
+
+size_t NodeTree::inputLink(NodeID toNode, SocketID toSocket) const
+{
+    if(_linkIndexDirty)
+        rebuildLinkIndex();
+
+    // Node might be newer than the index (thus without any link)
+    if(size_t(toNode) + 1 >= _inputLinkOffsets.size())
+        return _links.size();
+
+    size_t index = _inputLinkOffsets[toNode] + toSocket;
+    if(index >= _inputLinkOffsets[toNode + 1])
+        return _links.size();
+
+    return _inputLinks[index];
+}
+
+void NodeTree::insertLink(const NodeLink& nodeLink)
+{
+    // Keep links sorted
+    _links.insert(std::upper_bound(std::begin(_links), std::end(_links), nodeLink), nodeLink);
+    invalidateLinkIndex();
+}
+
+// Needs to be called whenever _links changes
+void NodeTree::invalidateLinkIndex()
+{
+    _linkIndexDirty = true;
+    _blockedNodesDirty = true;
+}
+
+// Builds CSR-like index of in and out links of each node
+void NodeTree::rebuildLinkIndex() const
+{
+    const size_t numNodes = _nodes.size();
+
+    _outLinkOffsets.assign(numNodes + 1, 0);
+    _inLinkOffsets.assign(numNodes + 1, 0);
 
-        return std::make_tuple(
-            size_t(start - std::begin(_links)), 
-            size_t(end - std::begin(_links)));
+    for(const NodeLink& link : _links)
+    {
+        ++_outLinkOffsets[link.fromNode + 1];
+        ++_inLinkOffsets[link.toNode + 1];
     }
-    else
+
+    std::partial_sum(std::begin(_outLinkOffsets), std::end(_outLinkOffsets), 
+        std::begin(_outLinkOffsets));
+    std::partial_sum(std::begin(_inLinkOffsets), std::end(_inLinkOffsets), 
+        std::begin(_inLinkOffsets));
+
+    std::vector<size_t> next(std::begin(_inLinkOffsets), std::end(_inLinkOffsets) - 1);
+    _inLinks.resize(_links.size());
+    for(size_t i = 0; i < _links.size(); ++i)
+        _inLinks[next[_links[i].toNode]++] = i;
+
+    // Each input socket can have at most one link
+    _inputLinkOffsets.assign(numNodes + 1, 0);
+    for(size_t index = 0; index < numNodes; ++index)
     {
-        // No output links from this node
-        return std::make_tuple(_links.size(), _links.size());
+        NodeID nodeID = NodeID(index);
+        _inputLinkOffsets[index + 1] = _inputLinkOffsets[index] 
+            + (validateNode(nodeID) ? _nodes[nodeID].numInputSockets() : 0);
     }
+
+    _inputLinks.assign(_inputLinkOffsets.back(), _links.size());
+    for(size_t i = 0; i < _links.size(); ++i)
+        _inputLinks[_inputLinkOffsets[_links[i].toNode] + _links[i].toSocket] = i;
+
+    _linkIndexDirty = false;
 }
 
 enum class NodeTree::ENodeColor : int
@@ -768,25 +1791,81 @@ enum class NodeTree::ENodeColor : int
     Black
 };
 
-// Internally uses DFS for graph traversal
-bool NodeTree::checkCycle(NodeID startNode)
+void NodeTree::prepareListImpl()
 {
-    // Initialize color map with white color
-    std::vector<ENodeColor> colorMap(_nodes.size(), ENodeColor::White);
+    for(NodeID nodeID : _executeList)
+        _executePositions[nodeID] = std::numeric_limits<size_t>::max();
+    _executeList.clear();
+
+    if(_blockedNodesDirty)
+        updateBlockedNodes();
+
+    // Gather tagged nodes along with everything downstream of them.
+    // Cost depends only on number of nodes that are going to be executed.
+    const std::uint32_t visit = beginVisit();
+    // Scratch buffers keep their capacity between calls
+    std::vector<NodeID>& stillTagged = _taggedScratch;
+    std::vector<NodeID>& stack = _stackScratch;
+    stillTagged.clear();
+    stack.clear();
+
+    for(NodeID nodeID : _taggedNodes)
+    {
+        if(!validateNode(nodeID) || !_nodes[nodeID].flag(ENodeFlags::Tagged))
+            continue;
+
+        stillTagged.push_back(nodeID);
+
+        if(_blockedNodes[nodeID] || _visitMarks[nodeID] == visit)
+            continue;
+
+        _visitMarks[nodeID] = visit;
+        stack.push_back(nodeID);
+
+        while(!stack.empty())
+        {
+            NodeID currentID = stack.back();
+            stack.pop_back();
+            _executeList.push_back(currentID);
+
+            size_t link, link_end;
+            std::tie(link, link_end) = outLinks(currentID);
+
+            for(; link != link_end; ++link)
+            {
+                NodeID toNodeID = _links[link].toNode;
+                if(!_blockedNodes[toNodeID] && _visitMarks[toNodeID] != visit)
+                {
+                    _visitMarks[toNodeID] = visit;
+                    stack.push_back(toNodeID);
+                }
+            }
+        }
+    }
+
+    std::sort(std::begin(stillTagged), std::end(stillTagged));
+    stillTagged.erase(std::unique(std::begin(stillTagged), std::end(stillTagged)),
+        std::end(stillTagged));
+    _taggedNodes.swap(stillTagged);
+
+    // Order gathered nodes using maintained topological order
+    std::sort(std::begin(_executeList), std::end(_executeList),
+        [&](NodeID lhs, NodeID rhs) {
+            return _topologicalPositions[lhs] < _topologicalPositions[rhs];
+        });
 
-    return !depthFirstSearch(startNode, colorMap);
+    for(size_t pos = 0; pos < _executeList.size(); ++pos)
+        _executePositions[_executeList[pos]] = pos;
 }
 
-// Internally uses DFS for graph traversal (in fact it's topological sort)
-void NodeTree::prepareListImpl()
+// Internally uses DFS for graph traversal
+void NodeTree::updateBlockedNodes()
 {
     // Initialize color map with white color
     std::vector<ENodeColor> colorMap(_nodes.size(), ENodeColor::White);
 
-    _executeList.clear();
-
     // For each invalid nodes (in terms of executable) mark them black
-    // so "true" graph traversal can skip them
+    // along with their descendants
     for(NodeID nodeID = 0; nodeID < NodeID(_nodes.size()); ++nodeID)
     {
         if(!validateNode(nodeID))
@@ -798,31 +1877,155 @@ void NodeTree::prepareListImpl()
         if(isNodeExecutable(nodeID))
             continue;
 
-        if(!depthFirstSearch(nodeID, colorMap))
-            return;
-    }	
+        depthFirstSearch(nodeID, colorMap);
+    }
 
-    // For each tagged and valid nodes that haven't been visited yet do ..
+    _blockedNodes.resize(_nodes.size());
     for(NodeID nodeID = 0; nodeID < NodeID(_nodes.size()); ++nodeID)
+        _blockedNodes[nodeID] = colorMap[nodeID] == ENodeColor::Black;
+
+    _blockedNodesDirty = false;
+}
+
+std::uint32_t NodeTree::beginVisit()
+{
+    if(++_visitGeneration == 0)
     {
-        if(!validateNode(nodeID))
-            continue;
+        // Wrapped around - old marks could match again
+        std::fill(std::begin(_visitMarks), std::end(_visitMarks), 0);
+        _visitGeneration = 1;
+    }
+    return _visitGeneration;
+}
 
-        if(colorMap[nodeID] != ENodeColor::White)
-            continue;
+void NodeTree::appendToTopologicalOrder(NodeID nodeID)
+{
+    // Node without any links can be placed anywhere
+    _topologicalPositions[nodeID] = _topologicalOrder.size();
+    _topologicalOrder.push_back(nodeID);
+}
 
-        if(!_nodes[nodeID].flag(ENodeFlags::Tagged))
-            continue;
+void NodeTree::removeFromTopologicalOrder(NodeID nodeID)
+{
+    size_t& position = _topologicalPositions[nodeID];
+    if(position >= _topologicalOrder.size())
+        return;
+
+    _topologicalOrder[position] = InvalidNodeID;
+    position = std::numeric_limits<size_t>::max();
+
+    // Compact the order once there are too many holes
+    if(++_topologicalHoles > _topologicalOrder.size() / 2)
+    {
+        _topologicalOrder.erase(std::remove(std::begin(_topologicalOrder), 
+            std::end(_topologicalOrder), InvalidNodeID), std::end(_topologicalOrder));
+        for(size_t pos = 0; pos < _topologicalOrder.size(); ++pos)
+            _topologicalPositions[_topologicalOrder[pos]] = pos;
+        _topologicalHoles = 0;
+    }
+}
+
+// Restores topological order before link from -> to is added
+// (Pearce-Kelly dynamic topological sort). Returns false if
+// such link would create a cycle.
+bool NodeTree::updateTopologicalOrder(NodeID fromNode, NodeID toNode)
+{
+    if(fromNode == toNode)
+        return false;
+
+    const size_t lowerBound = _topologicalPositions[toNode];
+    const size_t upperBound = _topologicalPositions[fromNode];
+
+    // Order is already correct
+    if(upperBound < lowerBound)
+        return true;
+
+    // Nodes reachable from 'to' that are placed no later than 'from'
+    std::vector<NodeID> forward;
+    std::vector<NodeID> stack(1, toNode);
+    std::uint32_t visit = beginVisit();
+    _visitMarks[toNode] = visit;
+
+    while(!stack.empty())
+    {
+        NodeID nodeID = stack.back();
+        stack.pop_back();
+        forward.push_back(nodeID);
+
+        size_t link, link_end;
+        std::tie(link, link_end) = outLinks(nodeID);
 
-        if(!depthFirstSearch(nodeID, colorMap, &_executeList))
+        for(; link != link_end; ++link)
         {
-            _executeList.clear();
-            return;
+            NodeID nextID = _links[link].toNode;
+            // 'from' is reachable from 'to' - there would be a cycle
+            if(nextID == fromNode)
+                return false;
+
+            if(_visitMarks[nextID] != visit
+                && _topologicalPositions[nextID] < upperBound)
+            {
+                _visitMarks[nextID] = visit;
+                stack.push_back(nextID);
+            }
+        }
+    }
+
+    // Nodes 'from' is reachable from that are placed no earlier than 'to'
+    std::vector<NodeID> backward;
+    stack.assign(1, fromNode);
+    visit = beginVisit();
+    _visitMarks[fromNode] = visit;
+
+    while(!stack.empty())
+    {
+        NodeID nodeID = stack.back();
+        stack.pop_back();
+        backward.push_back(nodeID);
+
+        size_t link, link_end;
+        std::tie(link, link_end) = inLinks(nodeID);
+
+        for(; link != link_end; ++link)
+        {
+            NodeID prevID = _links[_inLinks[link]].fromNode;
+            if(_visitMarks[prevID] != visit
+                && _topologicalPositions[prevID] > lowerBound)
+            {
+                _visitMarks[prevID] = visit;
+                stack.push_back(prevID);
+            }
         }
     }
 
-    // Topological sort gives result in inverse order
-    std::reverse(std::begin(_executeList), std::end(_executeList));
+    // Move 'backward' set before 'forward' one reusing their positions
+    auto byPosition = [&](NodeID lhs, NodeID rhs) {
+        return _topologicalPositions[lhs] < _topologicalPositions[rhs];
+    };
+    std::sort(std::begin(forward), std::end(forward), byPosition);
+    std::sort(std::begin(backward), std::end(backward), byPosition);
+
+    std::vector<size_t> positions;
+    positions.reserve(forward.size() + backward.size());
+    for(NodeID nodeID : backward)
+        positions.push_back(_topologicalPositions[nodeID]);
+    for(NodeID nodeID : forward)
+        positions.push_back(_topologicalPositions[nodeID]);
+    std::sort(std::begin(positions), std::end(positions));
+
+    size_t index = 0;
+    for(NodeID nodeID : backward)
+    {
+        _topologicalPositions[nodeID] = positions[index++];
+        _topologicalOrder[_topologicalPositions[nodeID]] = nodeID;
+    }
+    for(NodeID nodeID : forward)
+    {
+        _topologicalPositions[nodeID] = positions[index++];
+        _topologicalOrder[_topologicalPositions[nodeID]] = nodeID;
+    }
+
+    return true;
 }
 
 bool NodeTree::depthFirstSearch(NodeID nodeID, 
@@ -981,10 +2184,11 @@ class NodeTree::NodeExecutorImpl : public NodeExecutor
 public:
      NodeExecutorImpl(NodeTree* nodeTree, bool withInit)
         : _nodeTree{nodeTree}
-        , _writer{_tracer}
+        , _writer{_tracer, nodeTree->_bufferPool.get()}
         , _reader{_nodeTree, _tracer}
         , _withInit{withInit}
     {
+        _nodeTree->_bytesCopied = 0;
     }
 
     ~NodeExecutorImpl() override
@@ -1007,6 +2211,16 @@ public:
         if (!hasWork()) return;
         NodeID nodeID = currentNode();
         Node& node = _nodeTree->_nodes[nodeID];
+        // Node is going to be executed - untag it
+        node.unsetFlag(ENodeFlags::Tagged);
+        _nodeTree->_outputFrames[nodeID] = _nodeTree->_frameCount;
+
+        const bool memoization = _nodeTree->isMemoizationActive();
+        if(memoization && _nodeTree->reuseMemoizedOutputs(nodeID))
+        {
+            ++_pos;
+            return;
+        }
 
         _tracer.setNode(nodeID);
         _reader.setNode(nodeID, node.numInputSockets());
@@ -1023,7 +2237,13 @@ public:
                 }
             }
 
+            CopyCounterScope copyCounter(_nodeTree->_bytesCopied);
+            HighResolutionClock::time_point start = HighResolutionClock::now();
             ExecutionStatus ret = node.execute(_reader, _writer);
+            if(_nodeTree->_profiler)
+                _nodeTree->profileNode(nodeID, start, std::this_thread::get_id());
+            if(memoization)
+                _nodeTree->updateMemo(nodeID, ret);
 
             switch (ret.status)
             {
@@ -1048,6 +2268,8 @@ public:
         }
         catch (...)
         {
+            // Node was untagged before - make sure it runs again next time
+            tagNode(nodeID);
             _nodeTree->handleException(nodeID, _tracer);
         }
     }
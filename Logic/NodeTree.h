@@ -26,6 +26,11 @@
 #include "Prerequisites.h"
 #include "Node.h"
 #include "NodeLink.h"
+#include "Kommon/HighResolutionClock.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 enum class ELinkNodesResult
 {
@@ -51,6 +56,8 @@ public:
 class LOGIC_EXPORT NodeTree
 {
     K_DISABLE_COPY(NodeTree)
+
+    friend class NodeSocketReader;
 public:
     NodeTree(NodeSystem* nodeSystem);
     ~NodeTree();
@@ -68,6 +75,48 @@ public:
     std::vector<NodeID> prepareList();
     void execute(bool withInit = false);
     void notifyFinish();
+
+    // When enabled, each node is started on a worker thread as soon as
+    // all nodes it depends on are done (nodes belonging to a module are
+    // run on the calling thread)
+    void setParallelExecution(bool enable);
+    bool parallelExecution() const;
+
+    // When enabled, tree is split into two stages and each execute() call
+    // processes them concurrently: upstream stage takes next frame while
+    // downstream stage works on the previous one. Each stage is executed
+    // sequentially so nodes always see frames in order. Because of that
+    // downstream nodes hold outputs of the previous frame - see outputFrame().
+    void setPipelinedExecution(bool enable);
+    bool pipelinedExecution() const;
+    // Runs downstream stage for the frame still held in the pipeline (if any)
+    void flushPipeline();
+    // Frame (counted by execute() calls, starting from 1) that produced
+    // current outputs of given node, 0 if node hasn't been executed yet
+    std::uint64_t outputFrame(NodeID nodeID) const;
+
+    // When enabled, statistics of every node execution are collected
+    void setProfilingEnabled(bool enable);
+    bool isProfilingEnabled() const;
+    // Returns nullptr if profiling is disabled
+    NodeProfiler* profiler();
+    const NodeProfiler* profiler() const;
+
+    // Number of bytes of flow data deep-copied (copy-on-write) by nodes
+    // of this tree during last execute() (or flushPipeline())
+    std::uint64_t bytesCopied() const;
+
+    // Pool of image buffers shared by all nodes of the tree
+    ImageBufferPool& bufferPool();
+    const ImageBufferPool& bufferPool() const;
+
+    // When enabled, stateless nodes whose properties and input data didn't
+    // change since their last execution are skipped and keep their outputs
+    // (their time elapsed is reported as zero). Outputs of every executed
+    // node are hashed (64-bit hash, plus type and size) to detect identical
+    // data so nodes downstream of it are skipped too. Not used in pipelined mode.
+    void setMemoizationEnabled(bool enable);
+    bool isMemoizationEnabled() const;
     
     // Returns sorted list of node in order of their execution
     // Returned list is valid between prepareList() calls.
@@ -114,6 +163,7 @@ public:
     NodeProperty nodeProperty(NodeID nodeID, PropertyID propID);
     const std::string& nodeExecuteInformation(NodeID nodeID) const;
     double nodeTimeElapsed(NodeID nodeID) const;
+    double nodeDeviceTimeElapsed(NodeID nodeID) const;
 
     std::unique_ptr<NodeIterator> createNodeIterator() const;
     std::unique_ptr<NodeLinkIterator> createNodeLinkIterator() const;
@@ -124,9 +174,23 @@ private:
     void deallocateNodeID(NodeID id);
 
     size_t firstOutputLink(NodeID fromNode, SocketID fromSocket, size_t start = 0) const;
+    // Range of indices to _links
     std::tuple<size_t, size_t> outLinks(NodeID fromNode) const;
-    bool checkCycle(NodeID startNode);
+    // Range of indices to _inLinks
+    std::tuple<size_t, size_t> inLinks(NodeID toNode) const;
+    // Index to _links of link going to given input socket (_links.size() if none)
+    size_t inputLink(NodeID toNode, SocketID toSocket) const;
+    void insertLink(const NodeLink& nodeLink);
+    void invalidateLinkIndex();
+    void rebuildLinkIndex() const;
     void prepareListImpl();
+    void updateBlockedNodes();
+
+    // Topological order of nodes is maintained incrementally as links are added
+    void appendToTopologicalOrder(NodeID nodeID);
+    void removeFromTopologicalOrder(NodeID nodeID);
+    bool updateTopologicalOrder(NodeID fromNode, NodeID toNode);
+    std::uint32_t beginVisit();
 
     enum class ENodeColor : int;
     bool depthFirstSearch(NodeID startNodeID,
@@ -136,16 +200,114 @@ private:
     bool validateLink(SocketAddress& from, SocketAddress& to);
     bool validateNode(NodeID nodeID) const;
 
+    struct NodeTask;
+    void runNodeTask(NodeTask& task, bool withInit);
+    void finishNodeTask(const NodeTask& task);
+    void executeParallel(bool withInit);
+    void executePipelined(bool withInit);
+    void preparePipeline();
+    bool isPipelineValid() const;
+    void runStage(std::vector<std::unique_ptr<NodeTask>>& tasks, bool withInit);
+    const NodeFlowData& readOutputSocket(NodeID nodeID, SocketAddress outputAddr) const;
     void handleException(NodeID nodeID, const NodeSocketTracer& tracer);
+    bool isMemoizationActive() const;
+    void resetMemos();
+    bool reuseMemoizedOutputs(NodeID nodeID);
+    void updateMemo(NodeID nodeID, const ExecutionStatus& status);
+    void profileNode(NodeID nodeID, HighResolutionClock::time_point start,
+                     std::thread::id thread);
 
 private:
     std::vector<Node> _nodes;
     std::vector<NodeID> _recycledIDs;
+    // Sorted thus out links of node N are [_outLinkOffsets[N], _outLinkOffsets[N+1])
     std::vector<NodeLink> _links;
+    // Link index below is rebuilt on first use after _links changed
+    // so a batch of edits (e.g. loading a tree) pays for it only once
+    mutable std::vector<size_t> _outLinkOffsets;
+    // Indices to _links grouped by target node in the same manner
+    mutable std::vector<size_t> _inLinks;
+    mutable std::vector<size_t> _inLinkOffsets;
+    // Index to _links for each input socket, sockets of node N 
+    // are [_inputLinkOffsets[N], _inputLinkOffsets[N+1])
+    mutable std::vector<size_t> _inputLinks;
+    mutable std::vector<size_t> _inputLinkOffsets;
+    mutable bool _linkIndexDirty;
+
+    // Topological order of all nodes (InvalidNodeID marks removed node)
+    std::vector<NodeID> _topologicalOrder;
+    std::vector<size_t> _topologicalPositions;
+    size_t _topologicalHoles;
+    // Non-executable nodes and their descendants
+    std::vector<std::uint8_t> _blockedNodes;
+    bool _blockedNodesDirty;
+    // Nodes tagged since last prepareList() (some might have been untagged since)
+    std::vector<NodeID> _taggedNodes;
+    // Visit marks for graph traversals - node is visited if mark equals generation
+    std::vector<std::uint32_t> _visitMarks;
+    std::uint32_t _visitGeneration;
+    // Reused by prepareListImpl()
+    std::vector<NodeID> _taggedScratch;
+    std::vector<NodeID> _stackScratch;
+
     std::vector<NodeID> _executeList;
+    // Position of each node in _executeList (or max of size_t if absent)
+    std::vector<size_t> _executePositions;
     std::unordered_map<std::string, NodeID> _nodeNameToNodeID;
     NodeSystem* _nodeSystem;
     bool _executeListDirty;
+    bool _parallelExecution;
+    // Threads used by parallel execution (created on first use)
+    class WorkerPool;
+    std::unique_ptr<WorkerPool> _workerPool;
+
+    // Pipelined execution: stage (0 - upstream, 1 - downstream) of each node
+    std::vector<std::uint8_t> _pipelineStages;
+    // Nodes that swapped their output sockets during current step
+    std::vector<std::uint8_t> _pipelineSwapped;
+    // Downstream nodes that still need to process frame from previous step
+    std::vector<NodeID> _pipelinePending;
+    bool _pipelinedExecution;
+    // Thread running downstream stage (created on first use)
+    std::unique_ptr<WorkerPool> _stageWorker;
+    // Held while a module (e.g. OpenCL) node runs in either stage as
+    // such nodes share module resources (command queue, kernels)
+    std::mutex _moduleMutex;
+
+    // Number of execute() calls so far and frame each node's outputs belong to
+    std::uint64_t _frameCount;
+    std::vector<std::uint64_t> _outputFrames;
+    // Frame that _pipelinePending nodes still need to process
+    std::uint64_t _pipelinePendingFrame;
+
+    std::unique_ptr<NodeProfiler> _profiler;
+    std::unique_ptr<ImageBufferPool> _bufferPool;
+    // Nodes of both pipeline stages might copy at the same time
+    std::atomic<std::uint64_t> _bytesCopied;
+
+    // Memoization state of each node
+    struct NodeMemo
+    {
+        NodeMemo() : version(0), valid(false) {}
+
+        // Changed whenever content of node outputs changes
+        std::uint64_t version;
+        // Properties and input versions from the last execution
+        std::vector<char> key;
+        // Type, size and content hash of each output
+        struct Digest
+        {
+            ENodeFlowDataType type;
+            size_t bytes;
+            std::uint64_t hash;
+        };
+        std::vector<Digest> outputs;
+        // Outputs can be reused if key matches
+        bool valid;
+    };
+    std::vector<NodeMemo> _memos;
+    std::atomic<std::uint64_t> _memoVersion;
+    bool _memoization;
 
 private:
     // Interfaces implementations
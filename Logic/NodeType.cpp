@@ -25,6 +25,7 @@
 #include "NodeTree.h"
 #include "NodeLink.h"
 #include "NodeException.h"
+#include "ImageBufferPool.h"
 
 void NodeSocketReader::setNode(NodeID nodeID, SocketID numInputSockets)
 {
@@ -47,7 +48,7 @@ const NodeFlowData& NodeSocketReader::readSocket(SocketID socketID) const
 
         if(outputAddr.isValid())
         {
-            return _nodeTree->outputSocket(outputAddr.node, outputAddr.socket);
+            return _nodeTree->readOutputSocket(_nodeID, outputAddr);
         }
         // Socket is not connected
         else
@@ -80,6 +81,37 @@ NodeFlowData& NodeSocketWriter::acquireSocket(SocketID socketID)
     return _outputs->at(socketID);
 }
 
+NodeFlowData& NodeSocketWriter::acquireSocket(SocketID socketID, cv::Size size, int type)
+{
+    NodeFlowData& socket = acquireSocket(socketID);
+    cv::Mat* image = nullptr;
+
+    switch(socket.type())
+    {
+    case ENodeFlowDataType::Image: image = &socket.getImage(); break;
+    case ENodeFlowDataType::ImageMono: image = &socket.getImageMono(); break;
+    case ENodeFlowDataType::ImageRgb: image = &socket.getImageRgb(); break;
+    default: return socket;
+    }
+
+    // Current image is reused (in place) only if it already fits
+    if(image->size() != size || image->type() != type)
+        *image = acquireBuffer(size, type);
+    return socket;
+}
+
+cv::Mat NodeSocketWriter::acquireBuffer(int rows, int cols, int type)
+{
+    if(!_bufferPool)
+        return rows > 0 && cols > 0 ? cv::Mat(rows, cols, type) : cv::Mat();
+    return _bufferPool->acquire(rows, cols, type);
+}
+
+cv::Mat NodeSocketWriter::acquireBuffer(cv::Size size, int type)
+{
+    return acquireBuffer(size.height, size.width, type);
+}
+
 bool PropertyConfig::setPropertyValue(const NodeProperty& newPropertyValue)
 {
     if(_validator)
@@ -94,9 +94,11 @@ class LOGIC_EXPORT NodeSocketWriter
 
     friend class Node;
 public:
-    explicit NodeSocketWriter(NodeSocketTracer& tracer)
+    explicit NodeSocketWriter(NodeSocketTracer& tracer,
+                              ImageBufferPool* bufferPool = nullptr)
         : _tracer(tracer)
         , _outputs(nullptr)
+        , _bufferPool(bufferPool)
     {
     }
 
@@ -108,6 +110,16 @@ public:
 
     // Returns a reference to underlying socket data
     NodeFlowData& acquireSocket(SocketID socketID);
+    // Same as above but for image sockets that are about to be written
+    // with an image of given size and type. If current image can't be
+    // reused it is replaced with a buffer from the tree pool.
+    NodeFlowData& acquireSocket(SocketID socketID, cv::Size size, int type);
+
+    // Returns image buffer (with undefined content) for temporary data or
+    // output socket that needs a new image. Buffer comes from the tree pool
+    // and goes back there when released.
+    cv::Mat acquireBuffer(int rows, int cols, int type);
+    cv::Mat acquireBuffer(cv::Size size, int type);
 
 private:
     void setOutputSockets(std::vector<NodeFlowData>& outputs);
@@ -115,6 +127,7 @@ private:
 private:
     NodeSocketTracer& _tracer;
     std::vector<NodeFlowData>* _outputs;
+    ImageBufferPool* _bufferPool;
 };
 
 // Interface for property value validator
@@ -519,6 +532,9 @@ public:
     virtual bool restart();
     virtual void finish();
     virtual bool init(const std::shared_ptr<NodeModule>& module);
+    // Time (in milliseconds) spent by a device on commands issued during last
+    // execute() call - for node types offloading their work (e.g. to the GPU)
+    virtual double deviceTimeElapsed();
 
     NodeConfig& config() { return *this; }
     const NodeConfig& config() const { return *this; }
@@ -530,6 +546,8 @@ inline void NodeType::finish()
 { return; }
 inline bool NodeType::init(const std::shared_ptr<NodeModule>&)
 { return false; }
+inline double NodeType::deviceTimeElapsed()
+{ return 0.0; }
 
 class NodeTypeIterator
 {
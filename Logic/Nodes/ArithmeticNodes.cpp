@@ -51,8 +51,6 @@ public:
         // Read input sockets
         const cv::Mat& src1 = reader.readSocket(0).getImage();
         const cv::Mat& src2 = reader.readSocket(1).getImage();
-        // Acquire output sockets
-        cv::Mat& dst = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(src1.empty() || src2.empty())
@@ -60,6 +58,9 @@ public:
         if(src1.size() != src2.size())
             return ExecutionStatus(EStatus::Error, "Inputs with different sizes");
 
+        // Acquire output sockets
+        cv::Mat& dst = writer.acquireSocket(0, src1.size(), src1.type()).getImage();
+
         // Do stuff
         cv::addWeighted(src1, _alpha, src2, _beta, 0, dst);
 
@@ -115,8 +116,6 @@ public:
         // Read input sockets
         const cv::Mat& src1 = reader.readSocket(0).getImage();
         const cv::Mat& src2 = reader.readSocket(1).getImage();
-        // Acquire output sockets
-        cv::Mat& dst = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(src1.empty() || src2.empty())
@@ -124,6 +123,9 @@ public:
         if(src1.size() != src2.size())
             return ExecutionStatus(EStatus::Error, "Inputs with different sizes");
 
+        // Acquire output sockets
+        cv::Mat& dst = writer.acquireSocket(0, src1.size(), src1.type()).getImage();
+
         // Do stuff
         cv::subtract(src1, src2, dst);
 
@@ -147,8 +149,6 @@ public:
         // Read input sockets
         const cv::Mat& src1 = reader.readSocket(0).getImage();
         const cv::Mat& src2 = reader.readSocket(1).getImage();
-        // Acquire output sockets
-        cv::Mat& dst = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(src1.empty() || src2.empty())
@@ -156,6 +156,9 @@ public:
         if(src1.size() != src2.size())
             return ExecutionStatus(EStatus::Error, "Inputs with different sizes");
 
+        // Acquire output sockets
+        cv::Mat& dst = writer.acquireSocket(0, src1.size(), src1.type()).getImage();
+
         // Do stuff
         cv::absdiff(src1, src2, dst);
 
@@ -0,0 +1,401 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "BruteForceMatcher.h"
+#include "CV.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+#if defined(__POPCNT__)
+#  include <nmmintrin.h>
+#endif
+
+namespace cvu {
+
+namespace {
+
+// Query rows processed by one task (and reused against each train block)
+const int QueryBlockRows = 64;
+// Train block meant to stay in L1 cache while query block is matched against it
+const int TrainBlockBytes = 16 * 1024;
+
+// Two best candidates
+template <typename T>
+struct Top2
+{
+    Top2()
+        : distance1(std::numeric_limits<T>::max())
+        , distance2(std::numeric_limits<T>::max())
+        , index1(-1)
+    {
+    }
+
+    // Candidates need to come in ascending index order - ties keep smaller index
+    void update(T dist, int index)
+    {
+        if(dist < distance1)
+        {
+            distance2 = distance1;
+            distance1 = dist;
+            index1 = index;
+        }
+        else if(dist < distance2)
+        {
+            distance2 = dist;
+        }
+    }
+
+    // Merges candidates found over disjoint index ranges
+    void merge(const Top2& other)
+    {
+        if(other.distance1 < distance1 
+        || (other.distance1 == distance1 && other.index1 >= 0 && other.index1 < index1))
+        {
+            distance2 = std::min(distance1, other.distance2);
+            distance1 = other.distance1;
+            index1 = other.index1;
+        }
+        else
+        {
+            distance2 = std::min(distance2, other.distance1);
+        }
+    }
+
+    T distance1;
+    T distance2;
+    int index1;
+};
+
+#if defined(__AVX2__)
+inline float horizontalSum(__m256 v)
+{
+    __m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+inline __m256 squaredDifference(__m256 acc, __m256 a, const float* b)
+{
+    __m256 d = _mm256_sub_ps(a, _mm256_loadu_ps(b));
+#  if defined(__FMA__)
+    return _mm256_fmadd_ps(d, d, acc);
+#  else
+    return _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+#  endif
+}
+#elif defined(__SSE2__) || defined(_M_X64)
+inline float horizontalSum(__m128 v)
+{
+    __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+inline __m128 squaredDifference(__m128 acc, __m128 a, const float* b)
+{
+    __m128 d = _mm_sub_ps(a, _mm_loadu_ps(b));
+    return _mm_add_ps(acc, _mm_mul_ps(d, d));
+}
+#endif
+
+// Squared L2 distance (ordering is the same, square root is taken at the end)
+struct L2Squared
+{
+    typedef float ValueType;
+    typedef float DistanceType;
+
+    // Distances of one query row to four train rows at once
+    static void distance4(const float* q, const float* const t[4], int n, float* dist)
+    {
+        int i = 0;
+#if defined(__AVX2__)
+        __m256 s0 = _mm256_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+        for(; i + 8 <= n; i += 8)
+        {
+            __m256 qv = _mm256_loadu_ps(q + i);
+            s0 = squaredDifference(s0, qv, t[0] + i);
+            s1 = squaredDifference(s1, qv, t[1] + i);
+            s2 = squaredDifference(s2, qv, t[2] + i);
+            s3 = squaredDifference(s3, qv, t[3] + i);
+        }
+        dist[0] = horizontalSum(s0);
+        dist[1] = horizontalSum(s1);
+        dist[2] = horizontalSum(s2);
+        dist[3] = horizontalSum(s3);
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 s0 = _mm_setzero_ps(), s1 = s0, s2 = s0, s3 = s0;
+        for(; i + 4 <= n; i += 4)
+        {
+            __m128 qv = _mm_loadu_ps(q + i);
+            s0 = squaredDifference(s0, qv, t[0] + i);
+            s1 = squaredDifference(s1, qv, t[1] + i);
+            s2 = squaredDifference(s2, qv, t[2] + i);
+            s3 = squaredDifference(s3, qv, t[3] + i);
+        }
+        dist[0] = horizontalSum(s0);
+        dist[1] = horizontalSum(s1);
+        dist[2] = horizontalSum(s2);
+        dist[3] = horizontalSum(s3);
+#else
+        dist[0] = dist[1] = dist[2] = dist[3] = 0.0f;
+#endif
+
+        for(; i < n; ++i)
+        {
+            for(int k = 0; k < 4; ++k)
+            {
+                float d = q[i] - t[k][i];
+                dist[k] += d * d;
+            }
+        }
+    }
+
+    static float distance(const float* q, const float* t, int n)
+    {
+        const float* const t4[4] = { t, t, t, t };
+        float dist[4];
+        distance4(q, t4, n, dist);
+        return dist[0];
+    }
+
+    static float finish(float dist) { return std::sqrt(dist); }
+};
+
+inline int popcount64(std::uint64_t x)
+{
+#if defined(__POPCNT__) && (defined(__x86_64__) || defined(_M_X64))
+    return (int) _mm_popcnt_u64(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int) ((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+struct Hamming
+{
+    typedef uchar ValueType;
+    typedef int DistanceType;
+
+    // Popcount of bytes from i to n
+    static int distanceTail(const uchar* q, const uchar* t, int i, int n)
+    {
+        int dist = 0;
+        for(; i + 8 <= n; i += 8)
+        {
+            std::uint64_t a, b;
+            std::memcpy(&a, q + i, sizeof(a));
+            std::memcpy(&b, t + i, sizeof(b));
+            dist += popcount64(a ^ b);
+        }
+        for(; i < n; ++i)
+            dist += popcount64(q[i] ^ t[i]);
+        return dist;
+    }
+
+    static int distance(const uchar* q, const uchar* t, int n)
+    {
+        return distanceTail(q, t, 0, n);
+    }
+
+#if defined(__AVX2__)
+    // Bit counts of nibbles looked up with byte shuffle and summed up with SAD
+    static __m256i bitCount(__m256i q, const uchar* t)
+    {
+        const __m256i lookup = _mm256_setr_epi8(
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        const __m256i lowNibble = _mm256_set1_epi8(0x0F);
+
+        __m256i x = _mm256_xor_si256(q, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t)));
+        __m256i cnt = _mm256_add_epi8(
+            _mm256_shuffle_epi8(lookup, _mm256_and_si256(x, lowNibble)),
+            _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(x, 4), lowNibble)));
+        return _mm256_sad_epu8(cnt, _mm256_setzero_si256());
+    }
+#endif
+
+    static void distance4(const uchar* q, const uchar* const t[4], int n, int* dist)
+    {
+        int i = 0;
+#if defined(__AVX2__)
+        __m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+        for(; i + 32 <= n; i += 32)
+        {
+            __m256i qv = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(q + i));
+            s0 = _mm256_add_epi64(s0, bitCount(qv, t[0] + i));
+            s1 = _mm256_add_epi64(s1, bitCount(qv, t[1] + i));
+            s2 = _mm256_add_epi64(s2, bitCount(qv, t[2] + i));
+            s3 = _mm256_add_epi64(s3, bitCount(qv, t[3] + i));
+        }
+        // Counts fit in 32 bits - interleave rows and reduce them together
+        __m256i s01 = _mm256_or_si256(s0, _mm256_slli_epi64(s1, 32));
+        __m256i s23 = _mm256_or_si256(s2, _mm256_slli_epi64(s3, 32));
+        __m256i s0123 = _mm256_add_epi32(_mm256_unpacklo_epi64(s01, s23), 
+            _mm256_unpackhi_epi64(s01, s23));
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(s0123), 
+            _mm256_extracti128_si256(s0123, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dist), sum);
+#else
+        dist[0] = dist[1] = dist[2] = dist[3] = 0;
+#endif
+        for(int k = 0; k < 4; ++k)
+            dist[k] += distanceTail(q, t[k], i, n);
+    }
+
+    static float finish(int dist) { return (float) dist; }
+};
+
+template <class Distance>
+void bruteForceMatch_impl(const cv::Mat& query, const cv::Mat& train, float distanceRatio,
+                          std::vector<cv::DMatch>& matches1to2,
+                          std::vector<cv::DMatch>* matches2to1)
+{
+    typedef typename Distance::ValueType ValueType;
+    typedef typename Distance::DistanceType DistanceType;
+    typedef Top2<DistanceType> Neighbours;
+
+    const int n = query.cols;
+    const int trainBlockRows = std::max(4, TrainBlockBytes / std::max(1, int(n * sizeof(ValueType))));
+    const int queryBlocks = (query.rows + QueryBlockRows - 1) / QueryBlockRows;
+
+    std::vector<Neighbours> queryNeighbours(query.rows);
+    std::vector<Neighbours> trainNeighbours(matches2to1 ? train.rows : 0);
+    std::mutex trainNeighboursMutex;
+
+    cvu::parallel_for(cv::Range(0, queryBlocks), [&](const cv::Range& range)
+    {
+        // Train neighbours among queries of this range only
+        std::vector<Neighbours> trainPartial(trainNeighbours.size());
+        const int queryEnd = std::min(range.end * QueryBlockRows, query.rows);
+
+        for(int queryBlock = range.start * QueryBlockRows; queryBlock < queryEnd; queryBlock += QueryBlockRows)
+        {
+            const int queryBlockEnd = std::min(queryBlock + QueryBlockRows, queryEnd);
+
+            for(int trainBlock = 0; trainBlock < train.rows; trainBlock += trainBlockRows)
+            {
+                const int trainBlockEnd = std::min(trainBlock + trainBlockRows, train.rows);
+
+                for(int queryIdx = queryBlock; queryIdx < queryBlockEnd; ++queryIdx)
+                {
+                    const ValueType* queryRow = query.ptr<ValueType>(queryIdx);
+                    Neighbours best = queryNeighbours[queryIdx];
+                    int trainIdx = trainBlock;
+
+                    for(; trainIdx + 4 <= trainBlockEnd; trainIdx += 4)
+                    {
+                        const ValueType* const trainRows[4] = {
+                            train.ptr<ValueType>(trainIdx), 
+                            train.ptr<ValueType>(trainIdx + 1),
+                            train.ptr<ValueType>(trainIdx + 2), 
+                            train.ptr<ValueType>(trainIdx + 3)
+                        };
+                        DistanceType dist[4];
+                        Distance::distance4(queryRow, trainRows, n, dist);
+
+                        for(int k = 0; k < 4; ++k)
+                            best.update(dist[k], trainIdx + k);
+                        if(!trainPartial.empty())
+                        {
+                            for(int k = 0; k < 4; ++k)
+                                trainPartial[trainIdx + k].update(dist[k], queryIdx);
+                        }
+                    }
+
+                    for(; trainIdx < trainBlockEnd; ++trainIdx)
+                    {
+                        DistanceType dist = Distance::distance(queryRow, 
+                            train.ptr<ValueType>(trainIdx), n);
+
+                        best.update(dist, trainIdx);
+                        if(!trainPartial.empty())
+                            trainPartial[trainIdx].update(dist, queryIdx);
+                    }
+
+                    queryNeighbours[queryIdx] = best;
+                }
+            }
+        }
+
+        if(!trainPartial.empty())
+        {
+            std::lock_guard<std::mutex> lock(trainNeighboursMutex);
+            for(size_t trainIdx = 0; trainIdx < trainPartial.size(); ++trainIdx)
+                trainNeighbours[trainIdx].merge(trainPartial[trainIdx]);
+        }
+    });
+
+    auto ratioTest = [=](const std::vector<Neighbours>& neighbours, 
+                         std::vector<cv::DMatch>& matches)
+    {
+        for(int idx = 0; idx < (int) neighbours.size(); ++idx)
+        {
+            const Neighbours& nn = neighbours[idx];
+            if(nn.index1 < 0)
+                continue;
+
+            const float distance1 = Distance::finish(nn.distance1);
+            // no second candidate passes the test
+            const float distance2 = nn.distance2 == std::numeric_limits<DistanceType>::max()
+                ? std::numeric_limits<float>::max()
+                : Distance::finish(nn.distance2);
+
+            if(distance1 <= distanceRatio * distance2)
+                matches.emplace_back(idx, nn.index1, distance1);
+        }
+    };
+
+    ratioTest(queryNeighbours, matches1to2);
+    if(matches2to1)
+        ratioTest(trainNeighbours, *matches2to1);
+}
+
+}
+
+void bruteForceMatch(const cv::Mat& query, const cv::Mat& train, float distanceRatio,
+                     std::vector<cv::DMatch>& matches1to2,
+                     std::vector<cv::DMatch>* matches2to1)
+{
+    CV_Assert(query.type() == train.type() && query.cols == train.cols);
+    CV_Assert(query.type() == CV_32F || query.type() == CV_8U);
+
+    if(query.type() == CV_32F)
+        bruteForceMatch_impl<L2Squared>(query, train, distanceRatio, matches1to2, matches2to1);
+    else
+        bruteForceMatch_impl<Hamming>(query, train, distanceRatio, matches1to2, matches2to1);
+}
+
+}
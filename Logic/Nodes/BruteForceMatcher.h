@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "../Prerequisites.h"
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/features2d/features2d.hpp>
+
+#include <vector>
+
+namespace cvu {
+
+// Brute-force nearest neighbour distance ratio matching of query against train
+// descriptors - L2 for float and Hamming for 8-bit ones. Works on blocks of
+// query x train rows that stay in cache, keeps two best candidates per query
+// and runs query blocks in parallel. Distances are computed with AVX2/FMA and
+// popcnt when built with them (SSE2 and scalar popcount otherwise).
+// If matches2to1 is given, train descriptors are also matched against query 
+// ones from the same distances. Matches are ordered by query index.
+void bruteForceMatch(const cv::Mat& query, const cv::Mat& train, float distanceRatio,
+                     std::vector<cv::DMatch>& matches1to2,
+                     std::vector<cv::DMatch>* matches2to1 = nullptr);
+
+}
@@ -122,12 +122,13 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImageMono();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImageMono();
 
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
         
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC1).getImageMono();
+
         // Do stuff
         cv::cvtColor(input, output, cvu::bayerCodeGray(_BayerCode.toEnum().cast<cvu::EBayerCode>()));
 
@@ -167,13 +168,14 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImageMono();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImageRgb();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
         
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC3).getImageRgb();
+
         // Do stuff
         cv::cvtColor(input, output, cvu::bayerCodeRgb(_BayerCode.toEnum().cast<cvu::EBayerCode>()));
 
@@ -46,13 +46,14 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC(input.channels())).getImage();
+
         // Do stuff
         cv::boxFilter(input, output, CV_8U, 
             cv::Size(_kernelSize, _kernelSize),
@@ -84,13 +85,14 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), input.type()).getImage();
+
         // Do stuff
         cv::bilateralFilter(input, output, _diameter,
             _sigmaColor, _sigmaSpace, cv::BORDER_REFLECT_101);
@@ -120,11 +122,12 @@ public:
     ExecutionStatus execute(NodeSocketReader& reader, NodeSocketWriter& writer) override
     {
         const cv::Mat& input = reader.readSocket(0).getImage();
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         if(!input.data)
             return ExecutionStatus(EStatus::Ok);
 
+        cv::Mat& output = writer.acquireSocket(0, input.size(), input.type()).getImage();
+
         // Do stuff
         // sigma = 0.3 * ((ksize-1)*0.5 - 1) + 0.8
         // int ksize = cvRound((20*_sigma - 7)/3);
@@ -160,13 +163,14 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), input.type()).getImage();
+
         // Do stuff
         cv::medianBlur(input, output, _apertureSize);
         return ExecutionStatus(EStatus::Ok);
@@ -198,13 +202,14 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC(input.channels())).getImage();
+
         // Do stuff
         cv::Laplacian(input, output, CV_8U, _apertureSize);
         return ExecutionStatus(EStatus::Ok);
@@ -240,21 +245,26 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC(input.channels())).getImage();
+
         // Do stuff
-        cv::Mat xgrad;
-        cv::Sobel(input, xgrad, CV_16S, _order, 0, _apertureSize);
-        cv::convertScaleAbs(xgrad, xgrad);
+        // Scratch buffers come from the pool - no allocations in steady state
+        const int channels = input.channels();
+        cv::Mat grad = writer.acquireBuffer(input.size(), CV_16SC(channels));
+        cv::Mat xgrad = writer.acquireBuffer(input.size(), CV_8UC(channels));
+        cv::Mat ygrad = writer.acquireBuffer(input.size(), CV_8UC(channels));
+
+        cv::Sobel(input, grad, CV_16S, _order, 0, _apertureSize);
+        cv::convertScaleAbs(grad, xgrad);
 
-        cv::Mat ygrad;
-        cv::Sobel(input, ygrad, CV_16S, 0, _order, _apertureSize);
-        cv::convertScaleAbs(ygrad, ygrad);
+        cv::Sobel(input, grad, CV_16S, 0, _order, _apertureSize);
+        cv::convertScaleAbs(grad, ygrad);
 
         cv::addWeighted(xgrad, 0.5, ygrad, 0.5, 0, output);
 
@@ -280,21 +290,25 @@ public:
     {
         // Read input sockets
         const cv::Mat& input = reader.readSocket(0).getImage();
-        // Acquire output sockets
-        cv::Mat& output = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(input.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& output = writer.acquireSocket(0, input.size(), CV_8UC(input.channels())).getImage();
+
         // Do stuff
-        cv::Mat xgrad;
-        cv::Scharr(input, xgrad, CV_16S, 1, 0);
-        cv::convertScaleAbs(xgrad, xgrad);
+        const int channels = input.channels();
+        cv::Mat grad = writer.acquireBuffer(input.size(), CV_16SC(channels));
+        cv::Mat xgrad = writer.acquireBuffer(input.size(), CV_8UC(channels));
+        cv::Mat ygrad = writer.acquireBuffer(input.size(), CV_8UC(channels));
+
+        cv::Scharr(input, grad, CV_16S, 1, 0);
+        cv::convertScaleAbs(grad, xgrad);
 
-        cv::Mat ygrad;
-        cv::Scharr(input, ygrad, CV_16S, 0, 1);
-        cv::convertScaleAbs(ygrad, ygrad);
+        cv::Scharr(input, grad, CV_16S, 0, 1);
+        cv::convertScaleAbs(grad, ygrad);
 
         cv::addWeighted(xgrad, 0.5, ygrad, 0.5, 0, output);
 
@@ -51,7 +51,6 @@ public:
         const Matches& mt = reader.readSocket(0).getMatches();
         // Acquire output sockets
         cv::Mat& H = writer.acquireSocket(0).getArray();
-        Matches& outMt = writer.acquireSocket(1).getMatches();
 
         // Validate inputs
         if(mt.queryPoints.empty() || mt.trainPoints.empty()
@@ -62,7 +61,9 @@ public:
             return ExecutionStatus(EStatus::Error, 
                 "Points from one images doesn't correspond to key points in another one");
 
-        // Do stuff
+        // Do stuff (mutable access to shared inliers resets them so it's
+        // done after early returns)
+        Matches& outMt = writer.acquireSocket(1).getMatches();
         outMt.queryImage = mt.queryImage;
         outMt.trainImage = mt.trainImage;
         outMt.queryPoints.clear();
@@ -75,48 +76,52 @@ public:
             return ExecutionStatus(EStatus::Ok, "Not enough matches for homography estimation");
         }
 
-        vector<uchar> inliersMask;
         cv::Mat homography = cv::findHomography(mt.queryPoints, mt.trainPoints, 
-            CV_RANSAC, _reprojThreshold, inliersMask);
-        int inliersCount = (int) std::count(begin(inliersMask), end(inliersMask), 1);
+            CV_RANSAC, _reprojThreshold, _inliersMask);
+        int inliersCount = (int) std::count(begin(_inliersMask), end(_inliersMask), 1);
         if(inliersCount < 4)
             return ExecutionStatus(EStatus::Ok);
 
-        vector<cv::Point2f> queryPoints(inliersCount), trainPoints(inliersCount);
+        // Gather inliers straight into output (reusing its storage)
+        outMt.queryPoints.resize(inliersCount);
+        outMt.trainPoints.resize(inliersCount);
 
-        // Create vector of inliers only
         for(size_t inlier = 0, idx = 0; inlier < kpSize; ++inlier)
         {
-            if(inliersMask[inlier] == 0)
+            if(_inliersMask[inlier] == 0)
                 continue;
 
-            queryPoints[idx] = mt.queryPoints[inlier];
-            trainPoints[idx] = mt.trainPoints[inlier];
+            outMt.queryPoints[idx] = mt.queryPoints[inlier];
+            outMt.trainPoints[idx] = mt.trainPoints[inlier];
             ++idx;
         }
 
         // Use only good points to find refined homography
-        H = cv::findHomography(queryPoints, trainPoints, 0);
+        H = cv::findHomography(outMt.queryPoints, outMt.trainPoints, 0);
 
-        // Reproject again
-        vector<cv::Point2f> srcReprojected;
-        cv::perspectiveTransform(trainPoints, srcReprojected, H.inv());
-        kpSize = queryPoints.size();
+        // Reproject again and keep only points that still fit
+        cv::perspectiveTransform(outMt.trainPoints, _srcReprojected, H.inv());
+        kpSize = outMt.queryPoints.size();
+        size_t good = 0;
 
         for (size_t i = 0; i < kpSize; i++)
         {
-            cv::Point2f actual = queryPoints[i];
-            cv::Point2f expect = srcReprojected[i];
+            cv::Point2f actual = outMt.queryPoints[i];
+            cv::Point2f expect = _srcReprojected[i];
             cv::Point2f v = actual - expect;
             float distanceSquared = v.dot(v);
 
             if (distanceSquared <= _reprojThreshold * _reprojThreshold)
             {
-                outMt.queryPoints.emplace_back(queryPoints[i]);
-                outMt.trainPoints.emplace_back(trainPoints[i]);
+                outMt.queryPoints[good] = outMt.queryPoints[i];
+                outMt.trainPoints[good] = outMt.trainPoints[i];
+                ++good;
             }
         }
 
+        outMt.queryPoints.resize(good);
+        outMt.trainPoints.resize(good);
+
         return ExecutionStatus(EStatus::Ok, 
             string_format("Inliers: %d\nOutliers: %d\nPercent of correct matches: %f%%",
                 (int) outMt.queryPoints.size(), 
@@ -127,6 +132,9 @@ public:
 
 private:
     TypedNodeProperty<double> _reprojThreshold;
+    // Scratch buffers kept between executions
+    vector<uchar> _inliersMask;
+    vector<cv::Point2f> _srcReprojected;
 };
 
 class KnownHomographyInliersNodeType : public NodeType
@@ -152,7 +160,6 @@ public:
         const Matches& mt = reader.readSocket(0).getMatches();
         // Acquire output sockets
         cv::Mat& H = writer.acquireSocket(0).getArray();
-        Matches& outMt = writer.acquireSocket(1).getMatches();
 
         // Validate inputs
         if(mt.queryPoints.empty() || mt.trainPoints.empty()
@@ -183,6 +190,7 @@ public:
             homography.at<float>(2,0) *= h22; homography.at<float>(2,1) *= h22; homography.at<float>(2,2) *= h22;
         }
 
+        Matches& outMt = writer.acquireSocket(1).getMatches();
         outMt.queryImage = mt.queryImage;
         outMt.trainImage = mt.trainImage;
         outMt.queryPoints.clear();
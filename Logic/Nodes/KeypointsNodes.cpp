@@ -43,13 +43,22 @@ public:
     {
         // Read input sockets
         const KeyPoints& src = reader.readSocket(0).getKeypoints();
-        // Acquire output sockets
-        KeyPoints& dst = writer.acquireSocket(0).getKeypoints();
 
         // Validate inputs
         if(src.kpoints.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Nothing to filter out - pass input through without copying
+        if(static_cast<int>(src.kpoints.size()) <= _n)
+        {
+            writer.acquireSocket(0).share(reader.readSocket(0));
+            return ExecutionStatus(EStatus::Ok, 
+                string_format("Keypoints retained: %d", (int) src.kpoints.size()));
+        }
+
+        // Acquire output sockets
+        KeyPoints& dst = writer.acquireSocket(0).getKeypoints();
+
         // Prepare output structure
         dst.image = src.image;
         dst.kpoints.clear();
@@ -28,6 +28,10 @@
 
 #include <opencv2/features2d/features2d.hpp>
 
+#include "BruteForceMatcher.h"
+
+#include <fstream>
+
 using std::vector;
 
 static vector<cv::DMatch> distanceRatioTest(const vector<vector<cv::DMatch>>& knMatches, 
@@ -54,24 +58,60 @@ static vector<cv::DMatch> distanceRatioTest(const vector<vector<cv::DMatch>>& kn
 static vector<cv::DMatch> symmetryTest(const vector<cv::DMatch>& matches1to2,
                                        const vector<cv::DMatch>& matches2to1)
 {
+    // Index reverse matches by their query index (ratio test gives at most one per query)
+    int maxQueryIdx2to1 = -1;
+    for(const auto& match2to1 : matches2to1)
+        maxQueryIdx2to1 = std::max(maxQueryIdx2to1, match2to1.queryIdx);
+
+    vector<int> trainIdx2to1(maxQueryIdx2to1 + 1, -1);
+    for(const auto& match2to1 : matches2to1)
+        trainIdx2to1[match2to1.queryIdx] = match2to1.trainIdx;
+
     vector<cv::DMatch> bothMatches;
 
     for(const auto& match1to2 : matches1to2)
     {
-        for(const auto& match2to1 : matches2to1)
+        if(match1to2.trainIdx >= 0
+        && match1to2.trainIdx <= maxQueryIdx2to1
+        && trainIdx2to1[match1to2.trainIdx] == match1to2.queryIdx)
         {
-            if(match1to2.queryIdx == match2to1.trainIdx
-            && match2to1.queryIdx == match1to2.trainIdx)
-            {
-                bothMatches.push_back(match1to2);
-                break;
-            }
+            bothMatches.push_back(match1to2);
         }
     }
 
     return bothMatches;
 }
 
+// Two nearest neighbours found so far
+template <class T>
+struct NearestNeighbours
+{
+    NearestNeighbours()
+        : distance1(std::numeric_limits<T>::max())
+        , distance2(std::numeric_limits<T>::max())
+        , index1(-1)
+    {
+    }
+
+    void update(T dist, int index)
+    {
+        if(dist < distance1)
+        {
+            distance2 = distance1;
+            distance1 = dist;
+            index1 = index;
+        }
+        else if(dist < distance2)
+        {
+            distance2 = dist;
+        }
+    }
+
+    T distance1;
+    T distance2;
+    int index1;
+};
+
 class MatcherNodeType : public NodeType
 {
 public:
@@ -100,6 +140,13 @@ protected:
 class BruteForceMatcherNodeType : public MatcherNodeType
 {
 public:
+    BruteForceMatcherNodeType()
+        : _engine(EMatcherEngine::Reference)
+    {
+        addProperty("Engine", _engine)
+            .setUiHints("item: Reference, item: Blocked SIMD");
+    }
+
     ExecutionStatus execute(NodeSocketReader& reader, NodeSocketWriter& writer) override
     {
         // Read input sockets
@@ -130,13 +177,14 @@ public:
 
         if(_symmetryTest)
         {
-            vector<cv::DMatch> matches1to2 = nndrMatch(query, train);
-            vector<cv::DMatch> matches2to1 = nndrMatch(train, query);
+            // Both directions come from the same distance matrix
+            vector<cv::DMatch> matches1to2, matches2to1;
+            nndrMatch(query, train, matches1to2, &matches2to1);
             matches = symmetryTest(matches1to2, matches2to1);
         }
         else
         {
-            matches = nndrMatch(query, train);
+            nndrMatch(query, train, matches, nullptr);
         }
 
         // Convert to 'Matches' data type
@@ -157,92 +205,90 @@ public:
     }
 
 private:
-    vector<cv::DMatch> nndrMatch(const cv::Mat& query, const cv::Mat& train)
+    void nndrMatch(const cv::Mat& query, const cv::Mat& train,
+                   vector<cv::DMatch>& matches1to2, vector<cv::DMatch>* matches2to1)
+    {
+        if(_engine.cast<Enum>().cast<EMatcherEngine>() == EMatcherEngine::BlockedSimd)
+            cvu::bruteForceMatch(query, train, _distanceRatio, matches1to2, matches2to1);
+        else if(query.type() == CV_32F)
+            nndrMatch<cv::L2<float>>(query, train, matches1to2, matches2to1);
+        else if(query.type() == CV_8U)
+            nndrMatch<cv::Hamming>(query, train, matches1to2, matches2to1);
+    }
+
+    // Nearest neighbour distance ratio matching of query against train descriptors.
+    // If matches2to1 is given, train descriptors are also matched against query ones
+    // in the same pass (distances are symmetric)
+    template <class Distance>
+    void nndrMatch(const cv::Mat& query, const cv::Mat& train,
+                   vector<cv::DMatch>& matches1to2, vector<cv::DMatch>* matches2to1)
     {
-        vector<cv::DMatch> nndrMatches;
+        typedef typename Distance::ValueType ValueType;
+        typedef typename Distance::ResultType ResultType;
+
+        Distance op;
+        vector<NearestNeighbours<ResultType>> trainNeighbours(matches2to1 ? train.rows : 0);
 
-        if(query.type() == CV_32F)
+        // for each descriptors in query array
+        for(int queryIdx = 0; queryIdx < query.rows; ++queryIdx)
         {
-            // for each descriptors in query array
-            for(int queryIdx = 0; queryIdx < query.rows; ++queryIdx)
-            {
-                const float* query_row = query.ptr<float>(queryIdx);
+            const ValueType* query_row = query.ptr<ValueType>(queryIdx);
+            NearestNeighbours<ResultType> queryNeighbours;
 
-                float bestDistance1 = std::numeric_limits<float>::max();
-                float bestDistance2 = std::numeric_limits<float>::max();
-                int bestTrainIdx1 = -1;
+            // for each descriptors in train array
+            for(int trainIdx = 0; trainIdx < train.rows; ++trainIdx)
+            {
+                const ValueType* train_row = train.ptr<ValueType>(trainIdx);
+                ResultType dist = op(train_row, query_row, train.cols);
 
-                // for each descriptors in train array
-                for(int trainIdx = 0; trainIdx < train.rows; ++trainIdx)
-                {
-                    const float* train_row = train.ptr<float>(trainIdx);
-
-                    cv::L2<float> op;
-                    cv::L2<float>::ResultType dist = op(train_row, query_row, train.cols);
-
-                    if(dist < bestDistance1)
-                    {
-                        bestDistance2 = bestDistance1;
-                        bestDistance1 = dist;
-                        bestTrainIdx1 = trainIdx;
-                    }
-                    else if(dist < bestDistance2)
-                    {
-                        bestDistance2 = dist;
-                    }
-                }
+                queryNeighbours.update(dist, trainIdx);
+                if(matches2to1)
+                    trainNeighbours[trainIdx].update(dist, queryIdx);
+            }
 
-                if(bestDistance1 <= _distanceRatio * bestDistance2)
-                {
-                    nndrMatches.push_back(cv::DMatch(queryIdx, bestTrainIdx1, bestDistance1));
-                }
+            if(queryNeighbours.distance1 <= _distanceRatio * queryNeighbours.distance2)
+            {
+                matches1to2.emplace_back(queryIdx, queryNeighbours.index1,
+                    (float) queryNeighbours.distance1);
             }
         }
-        else if(query.type() == CV_8U)
+
+        if(matches2to1)
         {
-            // for each descriptors in query array
-            for(int queryIdx = 0; queryIdx < query.rows; ++queryIdx)
+            for(int trainIdx = 0; trainIdx < train.rows; ++trainIdx)
             {
-                const uchar* query_row = query.ptr<uchar>(queryIdx);
-
-                int bestDistance1 = std::numeric_limits<int>::max();
-                int bestDistance2 = std::numeric_limits<int>::max();
-                int bestTrainIdx1 = -1;
-
-                // for each descriptors in train array
-                for(int trainIdx = 0; trainIdx < train.rows; ++trainIdx)
-                {
-                    const uchar* train_row = train.ptr<uchar>(trainIdx);
-
-                    cv::Hamming op;
-                    cv::Hamming::ResultType dist = op(train_row, query_row, train.cols);
-
-                    if(dist < bestDistance1)
-                    {
-                        bestDistance2 = bestDistance1;
-                        bestDistance1 = dist;
-                        bestTrainIdx1 = trainIdx;
-                    }
-                    else if(dist < bestDistance2)
-                    {
-                        bestDistance2 = dist;
-                    }
-                }
+                const auto& neighbours = trainNeighbours[trainIdx];
 
-                if(bestDistance1 <= _distanceRatio * bestDistance2)
+                if(neighbours.distance1 <= _distanceRatio * neighbours.distance2)
                 {
-                    nndrMatches.emplace_back(cv::DMatch(queryIdx, bestTrainIdx1, (float)bestDistance1));
+                    matches2to1->emplace_back(trainIdx, neighbours.index1,
+                        (float) neighbours.distance1);
                 }
             }
         }
-
-        return nndrMatches;
     }
+
+    enum class EMatcherEngine
+    {
+        // Straightforward loop over all pairs
+        Reference,
+        // Cache blocked, vectorized and multi-threaded
+        BlockedSimd
+    };
+
+    TypedNodeProperty<EMatcherEngine> _engine;
 };
 
 class AproximateNearestNeighborMatcherNodeType : public MatcherNodeType
 {
 public:
+    AproximateNearestNeighborMatcherNodeType()
+        : _indexFile(Filepath{})
+    {
+        addProperty("Index file", _indexFile)
+            .setUiHints("filter: FLANN index (*.flann), save: true");
+    }
+
     ExecutionStatus execute(NodeSocketReader& reader, NodeSocketWriter& writer) override
     {
         // Read input sockets
@@ -264,28 +310,30 @@ public:
         }
 
         // Do stuff
-        cv::Ptr<cv::flann::IndexParams> indexParams;
-        
-        if(trainDesc.depth() == CV_8U)
-        {
-            indexParams = new cv::flann::LshIndexParams(12, 20, 2);
-            // For now doesn't work for binary descriptors :(
-            //cv::flann::HierarchicalClusteringIndexParams();
-        }
-        else if(trainDesc.depth() == CV_32F 
-             || trainDesc.depth() == CV_64F)
-        {
-            indexParams = new cv::flann::HierarchicalClusteringIndexParams();
-        }
-        
-        cv::FlannBasedMatcher matcher(indexParams);
+        cv::Ptr<cv::flann::IndexParams> indexParams = createIndexParams(trainDesc.depth());
+        if(indexParams.empty())
+            return ExecutionStatus(EStatus::Error, "Unsupported descriptor data type");
+
+        // Train descriptors are often a static reference - reuse their index
+        // (unless their content can't be hashed - then it's always rebuilt)
+        std::uint64_t trainHash = 0;
+        std::string trainKey;
+        if(reader.readSocket(3).contentHash(trainHash))
+            trainKey = indexKey(trainHash, trainDesc);
+        const std::string indexPath = _indexFile.cast<Filepath>().data();
+
+        if(_trainIndex.empty() || trainKey.empty() 
+        || trainKey != _trainKey || indexPath != _trainIndexPath)
+            updateTrainIndex(trainDesc, trainKey, indexPath, *indexParams);
+
         vector<cv::DMatch> matches;
 
         if(_symmetryTest)
         {
             vector<vector<cv::DMatch>> knMatches1to2, knMatches2to1;
 
-            matcher.knnMatch(queryDesc, trainDesc, knMatches1to2, 2);
+            knnMatch(*_trainIndex, queryDesc, knMatches1to2);
+            cv::FlannBasedMatcher matcher(indexParams);
             matcher.knnMatch(trainDesc, queryDesc, knMatches2to1, 2);
 
             auto matches1to2 = distanceRatioTest(knMatches1to2, _distanceRatio);
@@ -295,7 +343,7 @@ public:
         else
         {
             vector<vector<cv::DMatch>> knMatches;
-            matcher.knnMatch(queryDesc, trainDesc, knMatches, 2);
+            knnMatch(*_trainIndex, queryDesc, knMatches);
 
             matches = distanceRatioTest(knMatches, _distanceRatio);
         }
@@ -316,6 +364,106 @@ public:
         return ExecutionStatus(EStatus::Ok, 
             string_format("Matches found: %d", (int) mt.queryPoints.size()));
     }
+
+private:
+    static cv::Ptr<cv::flann::IndexParams> createIndexParams(int depth)
+    {
+        if(depth == CV_8U)
+        {
+            // For now doesn't work for binary descriptors :(
+            //cv::flann::HierarchicalClusteringIndexParams();
+            return new cv::flann::LshIndexParams(12, 20, 2);
+        }
+        else if(depth == CV_32F || depth == CV_64F)
+        {
+            return new cv::flann::HierarchicalClusteringIndexParams();
+        }
+
+        return cv::Ptr<cv::flann::IndexParams>();
+    }
+
+    // Two nearest neighbours for each query descriptor (as FlannBasedMatcher does)
+    static void knnMatch(cv::flann::Index& index, const cv::Mat& queryDesc,
+                         vector<vector<cv::DMatch>>& knMatches)
+    {
+        const int knn = 2;
+        cv::Mat indices, dists;
+        index.knnSearch(queryDesc, indices, dists, knn, cv::flann::SearchParams());
+
+        knMatches.resize(queryDesc.rows);
+        for(int queryIdx = 0; queryIdx < queryDesc.rows; ++queryIdx)
+        {
+            knMatches[queryIdx].clear();
+            for(int k = 0; k < knn; ++k)
+            {
+                const int trainIdx = indices.at<int>(queryIdx, k);
+                if(trainIdx < 0)
+                    continue;
+
+                // Hamming distances are integers, L2 ones are squared
+                const float dist = dists.type() == CV_32S
+                    ? static_cast<float>(dists.at<int>(queryIdx, k))
+                    : std::sqrt(dists.at<float>(queryIdx, k));
+                knMatches[queryIdx].push_back(cv::DMatch(queryIdx, trainIdx, dist));
+            }
+        }
+    }
+
+    // Identifies descriptors an index was built from, both in memory and
+    // in a key file accompanying the index file
+    static std::string indexKey(std::uint64_t trainHash, const cv::Mat& trainDesc)
+    {
+        return string_format("%016llx %d %d %d", (unsigned long long) trainHash,
+            trainDesc.rows, trainDesc.cols, trainDesc.type());
+    }
+
+    // Empty key means descriptors can't be identified - index file isn't used then
+    void updateTrainIndex(const cv::Mat& trainDesc, const std::string& key,
+                          const std::string& indexPath, const cv::flann::IndexParams& indexParams)
+    {
+        // Index refers to descriptors data so we need our own copy
+        cv::Mat desc = trainDesc.clone();
+        cv::Ptr<cv::flann::Index> index = new cv::flann::Index();
+
+        const std::string keyPath = indexPath + ".key";
+        bool loaded = false;
+
+        const bool useFile = !indexPath.empty() && !key.empty();
+
+        if(useFile)
+        {
+            std::ifstream keyFile(keyPath, std::ios::in);
+            std::string savedKey;
+
+            loaded = std::getline(keyFile, savedKey)
+                && savedKey == key
+                && index->load(desc, indexPath);
+        }
+
+        if(!loaded)
+        {
+            index->build(desc, indexParams);
+
+            if(useFile)
+            {
+                index->save(indexPath);
+                std::ofstream keyFile(keyPath, std::ios::out | std::ios::trunc);
+                keyFile << key << std::endl;
+            }
+        }
+
+        _trainIndex = index;
+        _trainDesc = desc;
+        _trainKey = key;
+        _trainIndexPath = indexPath;
+    }
+
+    TypedNodeProperty<Filepath> _indexFile;
+
+    cv::Ptr<cv::flann::Index> _trainIndex;
+    cv::Mat _trainDesc;
+    std::string _trainKey;
+    std::string _trainIndexPath;
 };
 
 /// Only BFMatcher as LSH (FLANN) for 1-bit descriptor isn't supported
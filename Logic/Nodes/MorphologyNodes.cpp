@@ -27,6 +27,7 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "CV.h"
+#include "Skeleton.h"
 
 class StructuringElementNodeType : public NodeType
 {
@@ -93,13 +94,14 @@ public:
         // Read input sockets
         const cv::Mat& src = reader.readSocket(0).getImage();
         const cv::Mat& se = reader.readSocket(1).getImageMono();
-        // Acquire output sockets
-        cv::Mat& dst = writer.acquireSocket(0).getImage();
 
         // Validate inputs
         if(se.empty() || src.empty())
             return ExecutionStatus(EStatus::Ok);
 
+        // Acquire output sockets
+        cv::Mat& dst = writer.acquireSocket(0, src.size(), src.type()).getImage();
+
         // Do stuff
         cv::morphologyEx(src, dst, _op.cast<Enum>().data(), se);
 
@@ -124,17 +126,6 @@ private:
 static const int OBJ = 255;
 static const int BCK = 0;
 
-static int skeletonZHLutTable[256]  = {
-    0,0,0,1,0,0,1,3,0,0,3,1,1,0,1,3,0,0,0,0,0,0,0,0,2,0,2,0,3,0,3,3,
-    0,0,0,0,0,0,0,0,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,3,0,2,2,
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-    2,0,0,0,0,0,0,0,2,0,0,0,2,0,0,0,3,0,0,0,0,0,0,0,3,0,0,0,3,0,2,0,
-    0,0,3,1,0,0,1,3,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,
-    3,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-    2,3,1,3,0,0,1,3,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-    2,3,0,1,0,0,0,1,0,0,0,0,0,0,0,0,3,3,0,1,0,0,0,0,2,2,0,0,2,0,0,0
-};
-
 class HitMissOperatorNodeType : public NodeType
 {
 public:
@@ -166,10 +157,10 @@ public:
             hitmissOutline(src, dst);
             break;
         case EHitMissOperation::Skeleton:
-            hitmissSkeleton(src, dst);
+            cvu::hitMissSkeleton(src, dst);
             break;
         case EHitMissOperation::SkeletonZhang:
-            hitmissSkeletonZhangSuen(src, dst);
+            cvu::zhangSuenThinning(src, dst);
             break;
         }
 
@@ -228,411 +219,6 @@ private:
         });
     }
 
-    inline int _skeleton_iter1(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny pierwszy
-        // 1|1|1
-        // X|1|X
-        // 0|0|0
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x-1) == OBJ &&
-                        src.at<uchar>(y-1, x  ) == OBJ &&
-                        src.at<uchar>(y-1, x+1) == OBJ &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y+1, x-1) == BCK &&
-                        src.at<uchar>(y+1, x  ) == BCK &&
-                        src.at<uchar>(y+1, x+1) == BCK)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter2(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny pierwszy - 90 w lewo
-        // 1|X|0
-        // 1|1|0
-        // 1|x|0
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x-1) == OBJ &&
-                        src.at<uchar>(y-1, x+1) == BCK &&
-                        src.at<uchar>(y  , x-1) == OBJ &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == BCK &&
-                        src.at<uchar>(y+1, x-1) == OBJ &&
-                        src.at<uchar>(y+1, x+1) == BCK)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter3(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny pierwszy - 180 w lewo
-        // 0|0|0
-        // X|1|X
-        // 1|1|1
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x-1) == BCK &&
-                        src.at<uchar>(y-1, x  ) == BCK &&
-                        src.at<uchar>(y-1, x+1) == BCK &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y+1, x-1) == OBJ &&
-                        src.at<uchar>(y+1, x  ) == OBJ &&
-                        src.at<uchar>(y+1, x+1) == OBJ)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-        return d;
-    }
-
-    inline int _skeleton_iter4(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny pierwszy - 270 w lewo
-        // 0|X|1
-        // 0|1|1
-        // 0|X|1
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x-1) == BCK &&
-                        src.at<uchar>(y-1, x+1) == OBJ &&
-                        src.at<uchar>(y  , x-1) == BCK &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == OBJ &&
-                        src.at<uchar>(y+1, x-1) == BCK &&
-                        src.at<uchar>(y+1, x+1) == OBJ)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter5(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny drugi
-        // X|1|X
-        // 0|1|1
-        // 0|0|X
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x  ) == OBJ &&
-                        src.at<uchar>(y  , x-1) == BCK &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == OBJ &&
-                        src.at<uchar>(y+1, x-1) == BCK &&
-                        src.at<uchar>(y+1, x  ) == BCK)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter6(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny drugi - 90 stopni w lewo
-        // X|1|X
-        // 1|1|0
-        // X|0|0
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x  ) == OBJ &&
-                        src.at<uchar>(y  , x-1) == OBJ &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == BCK &&
-                        src.at<uchar>(y+1, x  ) == BCK &&
-                        src.at<uchar>(y+1, x+1) == BCK)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter7(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny drugi - 180 stopni w lewo
-        // X|0|0
-        // 1|1|0
-        // X|1|X
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x  ) == BCK &&
-                        src.at<uchar>(y-1, x+1) == BCK &&
-                        src.at<uchar>(y  , x-1) == OBJ &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == BCK &&
-                        src.at<uchar>(y+1, x  ) == OBJ)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    inline int _skeleton_iter8(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Element strukturalny drugi - 270 stopni w lewo
-        // 0|0|X
-        // 0|1|1
-        // X|1|X
-        //
-
-        int d = 0;
-
-        cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 1; x < src.cols - 1; ++x)
-                {
-                    if (src.at<uchar>(y-1, x-1) == BCK &&
-                        src.at<uchar>(y-1, x  ) == BCK &&
-                        src.at<uchar>(y  , x-1) == BCK &&
-                        src.at<uchar>(y  , x  ) == OBJ &&
-                        src.at<uchar>(y  , x+1) == OBJ &&
-                        src.at<uchar>(y+1, x  ) == OBJ)
-                    {
-                        dst.at<uchar>(y, x) = BCK;
-                        d++;
-                    }
-                }
-            }
-        });
-
-        return d;
-    }
-
-    int hitmissSkeleton(const cv::Mat& _src, cv::Mat &dst)
-    {
-        int niters = 0;
-
-        cv::Mat src = _src.clone();
-        dst = src.clone();
-
-        while(true) 
-        {
-            // iteracja
-            ++niters;
-            int d = 0;
-
-            d += _skeleton_iter1(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter2(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter3(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter4(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter5(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter6(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter7(src, dst);
-            dst.copyTo(src);
-
-            d += _skeleton_iter8(src, dst);
-
-            //printf("Iteration: %3d, pixel changed: %5d\r", niters, d);
-
-            if(d == 0)
-                break;
-
-            dst.copyTo(src);
-        }
-        //printf("\n");
-
-        return niters;
-    }
-
-    int hitmissSkeletonZhangSuen_pass(cv::Mat& dst, int pass)
-    {
-        const int bgColor = 0;
-
-        cv::Mat tmp = dst.clone();
-        uchar* pixels2 = tmp.ptr<uchar>();
-        uchar* pixels = dst.ptr<uchar>();
-        int pixelsRemoved = 0;
-        int xMin = 1, yMin = 1, rowOffset = dst.cols;
-
-        cvu::parallel_for(cv::Range(yMin, dst.rows - 1), [&](const cv::Range& range)
-        {
-            for(int y = range.start; y < range.end; ++y)
-            {
-                int offset = xMin + y * rowOffset;
-                for(int x = xMin; x < dst.cols - 1; ++x)
-                {
-                    uchar p5 = pixels2[offset];
-                    uchar v = p5;
-                    if(v != bgColor)
-                    {
-                        uchar p1 = pixels2[offset-rowOffset-1];
-                        uchar p2 = pixels2[offset-rowOffset];
-                        uchar p3 = pixels2[offset-rowOffset+1];
-                        uchar p4 = pixels2[offset-1];
-                        uchar p6 = pixels2[offset+1];
-                        uchar p7 = pixels2[offset+rowOffset-1];
-                        uchar p8 = pixels2[offset+rowOffset];
-                        uchar p9 = pixels2[offset+rowOffset+1];
-
-                        // lut index
-                        int index = 
-                            ((p4&0x01) << 7) |
-                            ((p7&0x01) << 6) |
-                            ((p8&0x01) << 5) |
-                            ((p9&0x01) << 4) |
-                            ((p6&0x01) << 3) |
-                            ((p3&0x01) << 2) |
-                            ((p2&0x01) << 1) |
-                            (p1&0x01);
-                        int code = skeletonZHLutTable[index];
-
-                        //odd pass
-                        if((pass & 1) == 1)
-                        { 
-                            if(code == 2 || code == 3)
-                            {
-                                v = bgColor;
-                                pixelsRemoved++;
-                            }
-                        } 
-                        //even pass
-                        else
-                        {
-                            if (code == 1 || code == 3)
-                            {
-                                v = bgColor;
-                                pixelsRemoved++;
-                            }
-                        }
-                    }
-                    pixels[offset++] = v;
-                }
-            }
-        });
-
-        return pixelsRemoved;
-    }
-
-    int hitmissSkeletonZhangSuen(const cv::Mat& src, cv::Mat& dst)
-    {
-        // Based on ImageJ implementation of skeletonization which is
-        // based on an a thinning algorithm by by Zhang and Suen (CACM, March 1984, 236-239)
-        int pass = 0;
-        int pixelsRemoved = 0;
-        dst = src.clone();
-        int niters = 0;
-
-        do 
-        {
-            niters++;
-            pixelsRemoved  = hitmissSkeletonZhangSuen_pass(dst, pass++);
-            pixelsRemoved += hitmissSkeletonZhangSuen_pass(dst, pass++);
-            //printf("Iteration: %3d, pixel changed: %5d\r", niters, pixelsRemoved);
-        } while (pixelsRemoved > 0);
-        //printf("\n");
-
-        return niters;
-    }
-
 private:
     enum class EHitMissOperation
     {
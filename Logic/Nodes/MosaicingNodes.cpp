@@ -50,18 +50,19 @@ public:
         if(mt.queryImage.empty() || mt.trainImage.empty() || homography.empty())
             return ExecutionStatus(EStatus::Ok);
 
-        planarWarper_warp(mt, homography);
+        planarWarper_warp(mt, homography, writer);
         cv::Rect roi = simpleBlender_findRoi();
 
-        cv::Mat dst32, maskDest;
-        dst32.create(roi.size(), CV_32SC1);
+        cv::Mat dst32 = writer.acquireBuffer(roi.size(), CV_32SC1);
         dst32.setTo(cv::Scalar::all(0));
-        maskDest.create(roi.size(), CV_8U);
+        cv::Mat maskDest = writer.acquireBuffer(roi.size(), CV_8U);
         maskDest.setTo(cv::Scalar::all(0));
 
-        simpleBlender_feed(1, roi, dst32, maskDest);
-        simpleBlender_feed(0, roi, dst32, maskDest);
+        simpleBlender_feed(1, roi, dst32, maskDest, writer);
+        simpleBlender_feed(0, roi, dst32, maskDest, writer);
 
+        if(mosaic.size() != roi.size() || mosaic.type() != CV_8UC1)
+            mosaic = writer.acquireBuffer(roi.size(), CV_8UC1);
         dst32.convertTo(mosaic, CV_8UC1);
 
         imgWarped[0] = cv::Mat(); imgWarped[1] = cv::Mat();
@@ -106,19 +107,23 @@ private:
             0, 0, 1);
     }
 
-    void planarWarper_warp(const Matches &mt, const cv::Mat& homography) 
+    void planarWarper_warp(const Matches &mt, const cv::Mat& homography,
+                           NodeSocketWriter& writer) 
     {
         cv::Matx<double, 3, 3> _H = planarWarper_findCorners(mt, homography);
 
         // prepare masks
-        cv::Mat mask0(mt.trainImage.size(), CV_8U);
+        cv::Mat mask0 = writer.acquireBuffer(mt.trainImage.size(), CV_8U);
         mask0.setTo(cv::Scalar::all(255));
 
-        cv::Mat mask1(mt.trainImage.size(), CV_8U);
+        cv::Mat mask1 = writer.acquireBuffer(mt.trainImage.size(), CV_8U);
         mask1.setTo(cv::Scalar::all(255));
 
         imgWarped[0] = mt.trainImage;
         maskWarped[0] = mask0;
+        // Let warpPerspective write into pooled buffers
+        imgWarped[1] = writer.acquireBuffer(sizes[1], mt.queryImage.type());
+        maskWarped[1] = writer.acquireBuffer(sizes[1], CV_8U);
         cv::warpPerspective(mt.queryImage, imgWarped[1], cv::Mat(_H)*homography, sizes[1], cv::INTER_CUBIC);
         cv::warpPerspective(mask1, maskWarped[1], cv::Mat(_H)*homography, sizes[1], cv::INTER_CUBIC);
     }
@@ -140,11 +145,13 @@ private:
         return cv::Rect(topLeft, bottomRight);
     }
 
-    void simpleBlender_feed(int i, cv::Rect& roi, cv::Mat& dst, cv::Mat& maskDest)
+    void simpleBlender_feed(int i, cv::Rect& roi, cv::Mat& dst, cv::Mat& maskDest,
+                            NodeSocketWriter& writer)
     {
         int origin_x = corners[i].x - roi.x;
         int origin_y = corners[i].y - roi.y;
-        cv::Mat img32S;
+        cv::Mat img32S = writer.acquireBuffer(imgWarped[i].size(), 
+            CV_MAKETYPE(CV_32S, imgWarped[i].channels()));
         imgWarped[i].convertTo(img32S, CV_32S);
 
         for (int y = 0; y < img32S.rows; ++y)
@@ -0,0 +1,642 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "Skeleton.h"
+#include "CV.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSSE3__)
+#  include <tmmintrin.h>
+#endif
+
+namespace cvu {
+
+namespace {
+
+typedef std::uint64_t Word;
+const int WordBits = 64;
+
+// Neighbourhood positions of 3x3 hit-miss structuring element
+enum ENeighbour
+{
+    NW, N, NE,
+    W,  C, E,
+    SW, S, SE
+};
+
+#define K_NB(pos) (1 << (pos))
+
+// Structuring element as masks of positions that need to be object (Hit)
+// or background (Miss). The rest can be anything.
+template <int Hit, int Miss>
+struct HitMissElement
+{
+    enum { hit = Hit, miss = Miss };
+};
+
+// Same order as in the original per-pixel implementation
+// 1|1|1
+// X|1|X
+// 0|0|0
+typedef HitMissElement<K_NB(NW) | K_NB(N) | K_NB(NE) | K_NB(C), 
+    K_NB(SW) | K_NB(S) | K_NB(SE)> SkeletonElement1;
+// 1|X|0
+// 1|1|0
+// 1|X|0
+typedef HitMissElement<K_NB(NW) | K_NB(W) | K_NB(SW) | K_NB(C), 
+    K_NB(NE) | K_NB(E) | K_NB(SE)> SkeletonElement2;
+// 0|0|0
+// X|1|X
+// 1|1|1
+typedef HitMissElement<K_NB(SW) | K_NB(S) | K_NB(SE) | K_NB(C), 
+    K_NB(NW) | K_NB(N) | K_NB(NE)> SkeletonElement3;
+// 0|X|1
+// 0|1|1
+// 0|X|1
+typedef HitMissElement<K_NB(NE) | K_NB(E) | K_NB(SE) | K_NB(C), 
+    K_NB(NW) | K_NB(W) | K_NB(SW)> SkeletonElement4;
+// X|1|X
+// 0|1|1
+// 0|0|X
+typedef HitMissElement<K_NB(N) | K_NB(E) | K_NB(C), 
+    K_NB(W) | K_NB(SW) | K_NB(S)> SkeletonElement5;
+// X|1|X
+// 1|1|0
+// X|0|0
+typedef HitMissElement<K_NB(N) | K_NB(W) | K_NB(C), 
+    K_NB(E) | K_NB(S) | K_NB(SE)> SkeletonElement6;
+// X|0|0
+// 1|1|0
+// X|1|X
+typedef HitMissElement<K_NB(W) | K_NB(S) | K_NB(C), 
+    K_NB(N) | K_NB(NE) | K_NB(E)> SkeletonElement7;
+// 0|0|X
+// 0|1|1
+// X|1|X
+typedef HitMissElement<K_NB(E) | K_NB(S) | K_NB(C), 
+    K_NB(NW) | K_NB(N) | K_NB(W)> SkeletonElement8;
+
+#undef K_NB
+
+// Image stored as two bit planes (object and background pixels), 
+// bit i of word w in a row corresponds to pixel in column w*64+i.
+// Each row is padded with one empty word on both sides.
+struct PackedBinaryImage
+{
+    int rows;
+    int cols;
+    int wordsPerRow;
+    int stride;
+    std::vector<Word> object;
+    std::vector<Word> background;
+
+    Word* objectRow(int y) { return &object[y * stride + 1]; }
+    Word* backgroundRow(int y) { return &background[y * stride + 1]; }
+};
+
+void pack(const cv::Mat& src, PackedBinaryImage& packed)
+{
+    packed.rows = src.rows;
+    packed.cols = src.cols;
+    packed.wordsPerRow = (src.cols + WordBits - 1) / WordBits;
+    packed.stride = packed.wordsPerRow + 2;
+    packed.object.assign(packed.rows * packed.stride, 0);
+    packed.background.assign(packed.rows * packed.stride, 0);
+
+    cvu::parallel_for(cv::Range(0, src.rows), [&](const cv::Range& range)
+    {
+        for(int y = range.start; y < range.end; ++y)
+        {
+            const uchar* srcRow = src.ptr<uchar>(y);
+            Word* objRow = packed.objectRow(y);
+            Word* bckRow = packed.backgroundRow(y);
+
+            for(int x = 0; x < src.cols; ++x)
+            {
+                Word bit = Word(1) << (x % WordBits);
+                if(srcRow[x] == BinaryObject)
+                    objRow[x / WordBits] |= bit;
+                else if(srcRow[x] == BinaryBackground)
+                    bckRow[x / WordBits] |= bit;
+            }
+        }
+    });
+}
+
+void unpack(PackedBinaryImage& packed, const cv::Mat& src, cv::Mat& dst)
+{
+    dst.create(src.size(), CV_8UC1);
+
+    cvu::parallel_for(cv::Range(0, src.rows), [&](const cv::Range& range)
+    {
+        for(int y = range.start; y < range.end; ++y)
+        {
+            const uchar* srcRow = src.ptr<uchar>(y);
+            uchar* dstRow = dst.ptr<uchar>(y);
+            const Word* objRow = packed.objectRow(y);
+            const Word* bckRow = packed.backgroundRow(y);
+
+            for(int x = 0; x < src.cols; ++x)
+            {
+                Word bit = Word(1) << (x % WordBits);
+                if(objRow[x / WordBits] & bit)
+                    dstRow[x] = BinaryObject;
+                else if(bckRow[x / WordBits] & bit)
+                    dstRow[x] = BinaryBackground;
+                else
+                    dstRow[x] = srcRow[x];
+            }
+        }
+    });
+}
+
+// Given neighbour (column-wise) of 64 consecutive pixels
+template <int Column>
+inline Word neighbour(const Word* row, int w)
+{
+    return Column == 0 ? (row[w] << 1) | (row[w - 1] >> (WordBits - 1))
+         : Column == 1 ? row[w]
+         : (row[w] >> 1) | (row[w + 1] << (WordBits - 1));
+}
+
+// Evaluates hit-miss element for 64 pixels at once. Neighbours that
+// element doesn't care about are optimized away.
+template <class Element, int Pos = 0>
+struct MatchElement
+{
+    static Word eval(const Word* const (&obj)[3], const Word* const (&bck)[3], int w)
+    {
+        Word match = MatchElement<Element, Pos + 1>::eval(obj, bck, w);
+        if(Element::hit & (1 << Pos))
+            match &= neighbour<Pos % 3>(obj[Pos / 3], w);
+        else if(Element::miss & (1 << Pos))
+            match &= neighbour<Pos % 3>(bck[Pos / 3], w);
+        return match;
+    }
+};
+
+template <class Element>
+struct MatchElement<Element, 9>
+{
+    static Word eval(const Word* const (&)[3], const Word* const (&)[3], int)
+    {
+        return ~Word(0);
+    }
+};
+
+inline int popCount(Word v)
+{
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    v = (v + (v >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return static_cast<int>((v * 0x0101010101010101ULL) >> 56);
+}
+
+class SkeletonEngine
+{
+public:
+    SkeletonEngine(PackedBinaryImage& image)
+        : _image(image)
+        , _wordsPerRow(image.wordsPerRow)
+        , _removed(image.rows * image.wordsPerRow, 0)
+        // Everything needs to be evaluated in the first round
+        , _changes(image.rows * NumElements, Span{0, image.wordsPerRow - 1})
+        , _activeSpans(image.rows)
+        , _columnMask(image.wordsPerRow, ~Word(0))
+    {
+        // Border pixels are never changed
+        const Span empty = {_wordsPerRow, -1};
+        std::fill_n(_changes.begin(), NumElements, empty);
+        std::fill_n(_changes.end() - NumElements, NumElements, empty);
+
+        for(int w = 0; w < _wordsPerRow; ++w)
+        {
+            for(int i = 0; i < WordBits; ++i)
+            {
+                int x = w * WordBits + i;
+                if(x < 1 || x >= image.cols - 1)
+                    _columnMask[w] &= ~(Word(1) << i);
+            }
+        }
+    }
+
+    int run()
+    {
+        int rounds = 0;
+
+        while(true)
+        {
+            ++rounds;
+            int changed = 0;
+
+            changed += runPass<SkeletonElement1>(0);
+            changed += runPass<SkeletonElement2>(1);
+            changed += runPass<SkeletonElement3>(2);
+            changed += runPass<SkeletonElement4>(3);
+            changed += runPass<SkeletonElement5>(4);
+            changed += runPass<SkeletonElement6>(5);
+            changed += runPass<SkeletonElement7>(6);
+            changed += runPass<SkeletonElement8>(7);
+
+            if(changed == 0)
+                break;
+        }
+
+        return rounds;
+    }
+
+private:
+    enum { NumElements = 8 };
+
+    // Range of words that changed (empty if lo > hi)
+    struct Span
+    {
+        int lo;
+        int hi;
+    };
+
+    // Result of a pass can only differ from the last time the same element
+    // was used if some neighbour changed since then (during last 8 passes)
+    Span activeSpan(int y) const
+    {
+        Span active = {_wordsPerRow, -1};
+        for(int dy = -1; dy <= 1; ++dy)
+        {
+            const Span* changes = &_changes[(y + dy) * NumElements];
+            for(int i = 0; i < NumElements; ++i)
+            {
+                active.lo = std::min(active.lo, changes[i].lo);
+                active.hi = std::max(active.hi, changes[i].hi);
+            }
+        }
+
+        active.lo = std::max(0, active.lo - 1);
+        active.hi = std::min(_wordsPerRow - 1, active.hi + 1);
+        return active;
+    }
+
+    template <class Element>
+    int runPass(int element)
+    {
+        std::atomic<int> changed(0);
+
+        // Evaluate against the state before this pass ...
+        cvu::parallel_for(cv::Range(1, _image.rows - 1), [&](const cv::Range& range)
+        {
+            for(int y = range.start; y < range.end; ++y)
+            {
+                Span active = activeSpan(y);
+                _activeSpans[y] = active;
+
+                const Word* const obj[3] = {
+                    _image.objectRow(y - 1), _image.objectRow(y), _image.objectRow(y + 1)};
+                const Word* const bck[3] = {
+                    _image.backgroundRow(y - 1), _image.backgroundRow(y), _image.backgroundRow(y + 1)};
+                Word* removed = &_removed[y * _wordsPerRow];
+
+                for(int w = active.lo; w <= active.hi; ++w)
+                {
+                    // Only object pixels can be removed
+                    removed[w] = obj[1][w] != 0 
+                        ? MatchElement<Element>::eval(obj, bck, w) & _columnMask[w]
+                        : 0;
+                }
+            }
+        });
+
+        // ... and then apply the changes
+        cvu::parallel_for(cv::Range(1, _image.rows - 1), [&](const cv::Range& range)
+        {
+            // Each thread counts on its own
+            int localChanged = 0;
+
+            for(int y = range.start; y < range.end; ++y)
+            {
+                Span active = _activeSpans[y];
+                Span changes = {_wordsPerRow, -1};
+
+                Word* obj = _image.objectRow(y);
+                Word* bck = _image.backgroundRow(y);
+                const Word* removed = &_removed[y * _wordsPerRow];
+
+                for(int w = active.lo; w <= active.hi; ++w)
+                {
+                    if(removed[w] == 0)
+                        continue;
+
+                    obj[w] &= ~removed[w];
+                    bck[w] |= removed[w];
+                    changes.lo = std::min(changes.lo, w);
+                    changes.hi = w;
+                    localChanged += popCount(removed[w]);
+                }
+
+                _changes[y * NumElements + element] = changes;
+            }
+
+            changed += localChanged;
+        });
+
+        return changed;
+    }
+
+private:
+    PackedBinaryImage& _image;
+    int _wordsPerRow;
+    std::vector<Word> _removed;
+    // Words changed by each element during last round
+    std::vector<Span> _changes;
+    std::vector<Span> _activeSpans;
+    std::vector<Word> _columnMask;
+};
+
+}
+
+int hitMissSkeleton(const cv::Mat& src, cv::Mat& dst)
+{
+    CV_Assert(src.type() == CV_8UC1);
+
+    if(src.rows < 3 || src.cols < 3)
+    {
+        dst = src.clone();
+        return 1;
+    }
+
+    PackedBinaryImage packed;
+    pack(src, packed);
+
+    SkeletonEngine engine(packed);
+    int rounds = engine.run();
+
+    unpack(packed, src, dst);
+    return rounds;
+}
+
+// Zhang-Suen thinning
+
+namespace {
+
+int zhangSuenLutTable[256] = {
+    0,0,0,1,0,0,1,3,0,0,3,1,1,0,1,3,0,0,0,0,0,0,0,0,2,0,2,0,3,0,3,3,
+    0,0,0,0,0,0,0,0,3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,3,0,2,2,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    2,0,0,0,0,0,0,0,2,0,0,0,2,0,0,0,3,0,0,0,0,0,0,0,3,0,0,0,3,0,2,0,
+    0,0,3,1,0,0,1,3,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,
+    3,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,2,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    2,3,1,3,0,0,1,3,0,0,0,0,0,0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    2,3,0,1,0,0,0,1,0,0,0,0,0,0,0,0,3,3,0,1,0,0,0,0,2,2,0,0,2,0,0,0
+};
+
+// For each neighbourhood index tells if pixel is removed in a given pass,
+// packed as 256-bit bitset so it can be looked up with byte shuffles
+struct ZhangSuenRemoveTable
+{
+    alignas(16) uchar bits[32];
+
+    explicit ZhangSuenRemoveTable(bool oddPass)
+    {
+        std::fill_n(bits, 32, uchar(0));
+        for(int index = 0; index < 256; ++index)
+        {
+            int code = zhangSuenLutTable[index];
+            bool remove = oddPass ? (code == 2 || code == 3) : (code == 1 || code == 3);
+            if(remove)
+                bits[index >> 3] |= uchar(1 << (index & 7));
+        }
+    }
+
+    bool removes(int index) const
+    {
+        return (bits[index >> 3] & (1 << (index & 7))) != 0;
+    }
+};
+
+inline int neighbourhoodIndex(const uchar* up, const uchar* row, const uchar* down, int x)
+{
+    return ((row[x-1]  & 0x01) << 7) |
+           ((down[x-1] & 0x01) << 6) |
+           ((down[x]   & 0x01) << 5) |
+           ((down[x+1] & 0x01) << 4) |
+           ((row[x+1]  & 0x01) << 3) |
+           ((up[x+1]   & 0x01) << 2) |
+           ((up[x]     & 0x01) << 1) |
+            (up[x-1]   & 0x01);
+}
+
+#if defined(__AVX2__)
+
+// 32 pixels at once
+struct ZhangSuenSimd
+{
+    typedef __m256i Vec;
+    enum { Width = 32 };
+
+    static Vec load(const uchar* p) { return _mm256_loadu_si256((const Vec*) p); }
+    static void store(uchar* p, Vec v) { _mm256_storeu_si256((Vec*) p, v); }
+    static Vec broadcast(const uchar* table) 
+    { return _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i*) table)); }
+    static Vec set1(char v) { return _mm256_set1_epi8(v); }
+    static Vec zero() { return _mm256_setzero_si256(); }
+    static Vec and_(Vec a, Vec b) { return _mm256_and_si256(a, b); }
+    static Vec or_(Vec a, Vec b) { return _mm256_or_si256(a, b); }
+    static Vec andnot(Vec a, Vec b) { return _mm256_andnot_si256(a, b); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm256_cmpeq_epi8(a, b); }
+    static Vec shuffle(Vec table, Vec index) { return _mm256_shuffle_epi8(table, index); }
+    template <int N> static Vec shl(Vec v) { return _mm256_slli_epi16(v, N); }
+    template <int N> static Vec shr(Vec v) { return _mm256_srli_epi16(v, N); }
+    static int count(Vec mask) { return popCount(std::uint32_t(_mm256_movemask_epi8(mask))); }
+};
+
+#elif defined(__SSSE3__)
+
+// 16 pixels at once
+struct ZhangSuenSimd
+{
+    typedef __m128i Vec;
+    enum { Width = 16 };
+
+    static Vec load(const uchar* p) { return _mm_loadu_si128((const Vec*) p); }
+    static void store(uchar* p, Vec v) { _mm_storeu_si128((Vec*) p, v); }
+    static Vec broadcast(const uchar* table) { return _mm_load_si128((const Vec*) table); }
+    static Vec set1(char v) { return _mm_set1_epi8(v); }
+    static Vec zero() { return _mm_setzero_si128(); }
+    static Vec and_(Vec a, Vec b) { return _mm_and_si128(a, b); }
+    static Vec or_(Vec a, Vec b) { return _mm_or_si128(a, b); }
+    static Vec andnot(Vec a, Vec b) { return _mm_andnot_si128(a, b); }
+    static Vec cmpeq(Vec a, Vec b) { return _mm_cmpeq_epi8(a, b); }
+    static Vec shuffle(Vec table, Vec index) { return _mm_shuffle_epi8(table, index); }
+    template <int N> static Vec shl(Vec v) { return _mm_slli_epi16(v, N); }
+    template <int N> static Vec shr(Vec v) { return _mm_srli_epi16(v, N); }
+    static int count(Vec mask) { return popCount(std::uint32_t(_mm_movemask_epi8(mask))); }
+};
+
+#endif
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+
+// Processes as many pixels of a row as possible, returns number of removed pixels
+// and updates x to the first pixel that's left to process
+int zhangSuenRowSimd(const uchar* up, const uchar* row, const uchar* down, uchar* out,
+                     int& x, int end, const ZhangSuenRemoveTable& table)
+{
+    typedef ZhangSuenSimd S;
+    typedef S::Vec Vec;
+
+    const Vec one = S::set1(1);
+    const Vec lowNibble = S::set1(0x0F);
+    const Vec seven = S::set1(7);
+    const Vec highBit = S::set1(char(0x80));
+    // Bitset is split into two 16-byte halves for byte shuffles
+    const Vec tableLo = S::broadcast(table.bits);
+    const Vec tableHi = S::broadcast(table.bits + 16);
+    alignas(16) static const uchar bitMasks[16] = {
+        1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const Vec bitTable = S::broadcast(bitMasks);
+    int removed = 0;
+
+    // Lowest bit of each neighbour moved to its position in the index. 
+    // Bytes are 0 or 1 after masking so 16-bit shifts don't spill between them.
+    #define K_NBIT(ptr, n) S::shl<n>(S::and_(S::load(ptr), one))
+
+    for(; x + S::Width <= end; x += S::Width)
+    {
+        Vec index = S::or_(
+            S::or_(S::or_(K_NBIT(row + x - 1, 7), K_NBIT(down + x - 1, 6)),
+                   S::or_(K_NBIT(down + x, 5), K_NBIT(down + x + 1, 4))),
+            S::or_(S::or_(K_NBIT(row + x + 1, 3), K_NBIT(up + x + 1, 2)),
+                   S::or_(K_NBIT(up + x, 1), S::and_(S::load(up + x - 1), one))));
+
+        // Byte of bitset (index / 8) looked up in both halves, 
+        // half is chosen by the highest bit of index
+        Vec byteIndex = S::and_(S::shr<3>(index), lowNibble);
+        Vec isHigh = S::cmpeq(S::and_(index, highBit), highBit);
+        Vec bitsetByte = S::or_(
+            S::andnot(isHigh, S::shuffle(tableLo, byteIndex)),
+            S::and_(isHigh, S::shuffle(tableHi, byteIndex)));
+        Vec bitMask = S::shuffle(bitTable, S::and_(index, seven));
+        Vec remove = S::cmpeq(S::and_(bitsetByte, bitMask), bitMask);
+
+        // Only foreground pixels are removed
+        Vec center = S::load(row + x);
+        remove = S::andnot(S::cmpeq(center, S::zero()), remove);
+
+        S::store(out + x, S::andnot(remove, center));
+        removed += S::count(remove);
+    }
+
+    #undef K_NBIT
+
+    return removed;
+}
+
+#endif
+
+// Reads from src and writes to dst (both need to have the same border)
+int zhangSuenPass(const cv::Mat& src, cv::Mat& dst, const ZhangSuenRemoveTable& table)
+{
+    std::atomic<int> pixelsRemoved(0);
+
+    // Row tiles are processed in parallel. Since pass reads only from src
+    // neighbouring tiles can be read directly - no halo copies are needed.
+    cvu::parallel_for(cv::Range(1, src.rows - 1), [&](const cv::Range& range)
+    {
+        int localRemoved = 0;
+
+        for(int y = range.start; y < range.end; ++y)
+        {
+            const uchar* up = src.ptr<uchar>(y - 1);
+            const uchar* row = src.ptr<uchar>(y);
+            const uchar* down = src.ptr<uchar>(y + 1);
+            uchar* out = dst.ptr<uchar>(y);
+            int x = 1;
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+            localRemoved += zhangSuenRowSimd(up, row, down, out, x, src.cols - 1, table);
+#endif
+            for(; x < src.cols - 1; ++x)
+            {
+                uchar v = row[x];
+                if(v != 0 && table.removes(neighbourhoodIndex(up, row, down, x)))
+                {
+                    v = 0;
+                    ++localRemoved;
+                }
+                out[x] = v;
+            }
+        }
+
+        pixelsRemoved += localRemoved;
+    });
+
+    return pixelsRemoved;
+}
+
+}
+
+int zhangSuenThinning(const cv::Mat& src, cv::Mat& dst)
+{
+    CV_Assert(src.type() == CV_8UC1);
+
+    static const ZhangSuenRemoveTable oddPass(true);
+    static const ZhangSuenRemoveTable evenPass(false);
+
+    // Ping-pong between two buffers. Borders are never written 
+    // so they need to be initialized in both.
+    cv::Mat buffers[2];
+    src.copyTo(buffers[0]);
+    src.copyTo(buffers[1]);
+
+    if(src.rows < 3 || src.cols < 3)
+    {
+        dst = buffers[0];
+        return 1;
+    }
+
+    int current = 0;
+    int pass = 0;
+    int niters = 0;
+    int pixelsRemoved = 0;
+
+    do 
+    {
+        niters++;
+        pixelsRemoved = 0;
+        for(int i = 0; i < 2; ++i, ++pass)
+        {
+            pixelsRemoved += zhangSuenPass(buffers[current], buffers[1 - current], 
+                (pass & 1) ? oddPass : evenPass);
+            current = 1 - current;
+        }
+    } while(pixelsRemoved > 0);
+
+    dst = buffers[current];
+    return niters;
+}
+
+}
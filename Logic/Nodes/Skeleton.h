@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#pragma once
+
+#include "../Prerequisites.h"
+
+#include <opencv2/core/core.hpp>
+
+namespace cvu {
+
+// Value of object and background pixels in binary images
+enum EBinaryPixel
+{
+    BinaryObject = 255,
+    BinaryBackground = 0
+};
+
+// Skeletonization with eight-pass hit-miss thinning (until no pixel changes).
+// Works on 1-bit packed image and revisits only neighbourhoods that 
+// changed recently. Pixels other than object or background are left intact.
+// Returns number of rounds made.
+int hitMissSkeleton(const cv::Mat& src, cv::Mat& dst);
+
+// Thinning algorithm by Zhang and Suen (CACM, March 1984, 236-239) as in
+// ImageJ. Expects binary image - neighbours are tested by their lowest bit
+// so only odd (e.g. 255) pixels are foreground. Evaluates 16 or 32 pixels 
+// at once when built with SSSE3/AVX2. Returns number of iterations made.
+int zhangSuenThinning(const cv::Mat& src, cv::Mat& dst);
+
+}
@@ -27,11 +27,176 @@
 #include "Kommon/StringUtils.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <thread>
 
 #include <opencv2/imgproc/imgproc.hpp>
 #include <opencv2/highgui/highgui.hpp>
 
+enum class EFrameQueuePolicy
+{
+    // Full queue discards its oldest frame (camera keeps up with real time)
+    DropOldest,
+    // Capturing waits for space in the queue (no frame is lost)
+    Block
+};
+
+// Captures frames on a background thread into bounded ring buffer
+// so decoding/grabbing overlaps with processing of previous frames
+class FrameGrabber
+{
+public:
+    struct Frame
+    {
+        cv::Mat image;
+        int index;
+    };
+
+    // Should fill the frame and return false on end of stream
+    typedef std::function<bool(Frame&)> GrabFunc;
+
+    FrameGrabber()
+        : _head(0)
+        , _count(0)
+        , _policy(EFrameQueuePolicy::Block)
+        , _droppedFrames(0)
+        , _finished(true)
+        , _stopping(false)
+    {
+    }
+
+    ~FrameGrabber()
+    {
+        stop();
+    }
+
+    void start(GrabFunc grab, int capacity, EFrameQueuePolicy policy)
+    {
+        stop();
+
+        _frames.assign(std::max(capacity, 1), Frame());
+        _head = 0;
+        _count = 0;
+        _policy = policy;
+        _droppedFrames = 0;
+        _finished = false;
+        _stopping = false;
+        _thread = std::thread(&FrameGrabber::run, this, std::move(grab));
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _notFull.notify_all();
+        _notEmpty.notify_all();
+
+        if(_thread.joinable())
+            _thread.join();
+
+        _frames.clear();
+        _count = 0;
+        _finished = true;
+    }
+
+    // Waits for the next frame. Returns false if there's no more of them
+    bool pop(Frame& frame)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this] { return _count > 0 || _finished; });
+        if(_count == 0)
+            return false;
+
+        frame = std::move(_frames[_head]);
+        _head = (_head + 1) % _frames.size();
+        --_count;
+        lock.unlock();
+
+        _notFull.notify_one();
+        return true;
+    }
+
+    int depth() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return static_cast<int>(_count);
+    }
+
+    int capacity() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return static_cast<int>(_frames.size());
+    }
+
+    int droppedFrames() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _droppedFrames;
+    }
+
+    std::string information() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return string_format("\nQueue depth: %d/%d\nDropped frames: %d",
+            static_cast<int>(_count), static_cast<int>(_frames.size()), _droppedFrames);
+    }
+
+private:
+    void run(GrabFunc grab)
+    {
+        for(;;)
+        {
+            // Grab without holding the lock - that's the slow part
+            Frame frame;
+            bool ok = grab(frame);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            if(!ok || _stopping)
+                break;
+
+            if(_policy == EFrameQueuePolicy::Block)
+            {
+                _notFull.wait(lock, [this] { return _count < _frames.size() || _stopping; });
+                if(_stopping)
+                    break;
+            }
+            else if(_count == _frames.size())
+            {
+                _head = (_head + 1) % _frames.size();
+                --_count;
+                ++_droppedFrames;
+            }
+
+            _frames[(_head + _count) % _frames.size()] = std::move(frame);
+            ++_count;
+            lock.unlock();
+
+            _notEmpty.notify_one();
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _finished = true;
+        _notEmpty.notify_all();
+    }
+
+private:
+    std::vector<Frame> _frames;
+    size_t _head;
+    size_t _count;
+    EFrameQueuePolicy _policy;
+    int _droppedFrames;
+    bool _finished;
+    bool _stopping;
+    mutable std::mutex _mutex;
+    std::condition_variable _notEmpty;
+    std::condition_variable _notFull;
+    std::thread _thread;
+};
+
 class VideoFromFileNodeType : public NodeType
 {
 public:
@@ -46,6 +211,8 @@ public:
         , _frameInterval(0U)
         , _ignoreFps(false)
         , _forceGrayscale(false)
+        , _queueSize(4)
+        , _queuePolicy(EFrameQueuePolicy::Block)
     {
         addOutput("Output", ENodeFlowDataType::Image);
         addProperty("Video path", _videoPath)
@@ -58,12 +225,21 @@ public:
             .setUiHints("min:0");
         addProperty("Ignore FPS", _ignoreFps);
         addProperty("Force grayscale", _forceGrayscale);
+        addProperty("Queue size", _queueSize)
+            .setValidator(make_validator<InclRangePropertyValidator<int>>(1, 64))
+            .setUiHints("min:1, max:64")
+            .setDescription("Number of frames decoded ahead on a background thread");
+        addProperty("Queue policy", _queuePolicy)
+            .setUiHints("item: Drop oldest, item: Block")
+            .setDescription("What decoding thread does when the queue is full");
         setDescription("Provides video frames from specified stream.");
         setFlags(ENodeConfig::HasState | ENodeConfig::AutoTag | ENodeConfig::OverridesTimeComputation);
     }
 
     bool restart() override
     {
+        _grabber.stop();
+
         // This isn't really necessary as subsequent open()
         // should call it automatically
         if(_capture.isOpened())
@@ -85,6 +261,30 @@ public:
         _maxFrames = static_cast<int>(_capture.get(CV_CAP_PROP_FRAME_COUNT));
         _currentFrame = _startFrame > 0 ? _startFrame : 0;
 
+        // Decoding thread works on its own copy of settings
+        int frameIndex = _currentFrame;
+        int endFrame = _endFrame;
+        bool forceGrayscale = _forceGrayscale;
+
+        _grabber.start([=](FrameGrabber::Frame& frame) mutable {
+            ++frameIndex;
+            // No more data (for us)
+            if(endFrame > 0 && frameIndex >= endFrame)
+                return false;
+
+            cv::Mat buffer;
+            if(!_capture.read(buffer) || buffer.empty())
+                return false;
+
+            if(forceGrayscale && buffer.channels() > 1)
+                cv::cvtColor(buffer, frame.image, CV_BGR2GRAY);
+            else
+                // Capture reuses its internal buffer for the next frame
+                buffer.copyTo(frame.image);
+            frame.index = frameIndex;
+            return true;
+        }, _queueSize, _queuePolicy.toEnum().cast<EFrameQueuePolicy>());
+
         return true;
     }
 
@@ -97,29 +297,15 @@ public:
 
         cv::Mat& output = writer.acquireSocket(0).getImage();
 
-        ++_currentFrame;
-
-        if(_endFrame > 0 && _currentFrame >= _endFrame)
-        {
-            // No more data (for us)
-            return ExecutionStatus(EStatus::Ok,
-                string_format("Frame image width: %d\nFrame image height: %d\nFrame channels count: %d\nFrame size in kbytes: %d\nFrame: %d/%d",
-                    output.cols, 
-                    output.rows,
-                    output.channels(),
-                    output.cols * output.rows * sizeof(uchar) * output.channels() / 1024, 
-                    _currentFrame - 1,
-                    _maxFrames));
-        }
-
         // We need this so we won't replace previous good frame with current bad (for instance - end of video)
-        cv::Mat buffer; 
-
-        if(_frameInterval == 0)
+        FrameGrabber::Frame frame;
+        if(!_grabber.pop(frame))
         {
-            _capture.read(buffer);
+            // No more data 
+            return ExecutionStatus(EStatus::Ok);
         }
-        else
+
+        if(_frameInterval != 0)
         {
             using namespace std::chrono;
 
@@ -134,34 +320,26 @@ public:
                 start = HighResolutionClock::now();
             }
 
-            _capture.read(buffer);
-
             _timeStamp = HighResolutionClock::now();
         }
 
-        if(!buffer.empty())
-        {
-            _forceGrayscale.cast_value<bool>();
-            if(_forceGrayscale && buffer.channels() > 1)
-                cv::cvtColor(buffer, output, CV_BGR2GRAY);
-            else
-                output = buffer;
-
-            HighResolutionClock::time_point stop = HighResolutionClock::now();
-            return ExecutionStatus(EStatus::Tag, convertToMilliseconds(stop - start),
-                string_format("Frame image width: %d\nFrame image height: %d\nFrame channels count: %d\nFrame size in kbytes: %d\nFrame: %d/%d",
-                    output.cols,
-                    output.rows,
-                    output.channels(),
-                    output.cols * output.rows * sizeof(uchar) * output.channels() / 1024,
-                    _currentFrame,
-                    _maxFrames));
-        }
-        else
-        {
-            // No more data 
-            return ExecutionStatus(EStatus::Ok);
-        }
+        output = frame.image;
+        _currentFrame = frame.index;
+
+        HighResolutionClock::time_point stop = HighResolutionClock::now();
+        return ExecutionStatus(EStatus::Tag, convertToMilliseconds(stop - start),
+            string_format("Frame image width: %d\nFrame image height: %d\nFrame channels count: %d\nFrame size in kbytes: %d\nFrame: %d/%d",
+                output.cols,
+                output.rows,
+                output.channels(),
+                output.cols * output.rows * sizeof(uchar) * output.channels() / 1024,
+                _currentFrame,
+                _maxFrames) + _grabber.information());
+    }
+
+    void finish() override
+    {
+        _grabber.stop();
     }
 
 private:
@@ -175,6 +353,10 @@ private:
     HighResolutionClock::time_point _timeStamp;
     TypedNodeProperty<bool> _ignoreFps;
     TypedNodeProperty<bool> _forceGrayscale;
+    TypedNodeProperty<int> _queueSize;
+    TypedNodeProperty<EFrameQueuePolicy> _queuePolicy;
+    // Needs to be destroyed before capture it reads from
+    FrameGrabber _grabber;
 };
 
 class ImageFromFileNodeType : public NodeType
@@ -268,20 +450,50 @@ public:
     CameraCaptureNodeType()
         : _deviceId(0)
         , _forceGrayscale(false)
+        , _queueSize(2)
+        , _queuePolicy(EFrameQueuePolicy::DropOldest)
     {
         addOutput("Output", ENodeFlowDataType::Image);
         addProperty("Device Id", _deviceId)
             .setUiHints("min:0")
             .setValidator(make_validator<MinPropertyValidator<int>>(0));
+        addProperty("Queue size", _queueSize)
+            .setValidator(make_validator<InclRangePropertyValidator<int>>(1, 64))
+            .setUiHints("min:1, max:64")
+            .setDescription("Number of frames captured ahead on a background thread");
+        addProperty("Queue policy", _queuePolicy)
+            .setUiHints("item: Drop oldest, item: Block")
+            .setDescription("What capturing thread does when the queue is full");
         setDescription("Provides video frames from specified camera device.");
         setFlags(ENodeConfig::HasState | ENodeConfig::AutoTag);
     }
 
     bool restart() override
     {
+        _grabber.stop();
+
         _capture.open(_deviceId);
         if(!_capture.isOpened())
             return false;
+
+        bool forceGrayscale = _forceGrayscale;
+        int frameIndex = 0;
+
+        _grabber.start([=](FrameGrabber::Frame& frame) mutable {
+            cv::Mat tmp;
+            _capture >> tmp;
+            if(tmp.empty())
+                return false;
+
+            if(forceGrayscale && tmp.channels() > 1)
+                cv::cvtColor(tmp, frame.image, CV_BGR2GRAY);
+            else
+                // Capture reuses its internal buffer for the next frame
+                tmp.copyTo(frame.image);
+            frame.index = ++frameIndex;
+            return true;
+        }, _queueSize, _queuePolicy.toEnum().cast<EFrameQueuePolicy>());
+
         return true;
     }
 
@@ -289,28 +501,25 @@ public:
     {
         cv::Mat& output = writer.acquireSocket(0).getImage();
 
-        /// TODO: Could be moved to background thread (just like JAI)
-        cv::Mat tmp;
-        _capture >> tmp;
-
-        if(tmp.empty())
+        FrameGrabber::Frame frame;
+        if(!_grabber.pop(frame))
             return ExecutionStatus(EStatus::Ok);
 
-        if(_forceGrayscale && tmp.channels() > 1)
-            cv::cvtColor(tmp, output, CV_BGR2GRAY);
-        else
-            output = tmp;
+        output = frame.image;
 
         return ExecutionStatus(EStatus::Tag, 
             string_format("Frame image width: %d\nFrame image height: %d\nFrame channels count: %d\nFrame size in kbytes: %d",
                 output.cols,
                 output.rows, 
                 output.channels(),
-                output.cols * output.rows * sizeof(uchar) * output.channels() / 1024));
+                output.cols * output.rows * sizeof(uchar) * output.channels() / 1024)
+            + _grabber.information());
     }
 
     void finish() override
     {
+        _grabber.stop();
+
         if(_capture.isOpened())
             _capture.release();
     }
@@ -318,7 +527,11 @@ public:
 private:
     TypedNodeProperty<int> _deviceId;
     TypedNodeProperty<bool> _forceGrayscale;
+    TypedNodeProperty<int> _queueSize;
+    TypedNodeProperty<EFrameQueuePolicy> _queuePolicy;
     cv::VideoCapture _capture;
+    // Needs to be destroyed before capture it reads from
+    FrameGrabber _grabber;
 };
 
 class SolidImageNodeType : public NodeType
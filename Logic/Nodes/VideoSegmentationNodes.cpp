@@ -278,8 +278,11 @@ public:
             });
         }
 
+        // Previous I_{n-2} buffer goes back to the pool
+        cv::Mat frameCopy = writer.acquireBuffer(frame.size(), frame.type());
+        frame.copyTo(frameCopy);
         _frameN2 = _frameN1;
-        _frameN1 = frame.clone();
+        _frameN1 = frameCopy;
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -117,7 +117,7 @@ public:
         kernelApproxGaussianBlurHoriz.setArg(5, fracHalfBoxWidth);
         kernelApproxGaussianBlurHoriz.setArg(6, invFracHalfBoxWidth);
         kernelApproxGaussianBlurHoriz.setArg(7, rcpBoxWidth);
-        _gpuComputeModule->queue().asyncRunKernel(kernelApproxGaussianBlurHoriz);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelApproxGaussianBlurHoriz));
 
         kernelApproxGaussianBlurVert.setLocalWorkSize(threadsPerGroup, 1);
         kernelApproxGaussianBlurVert.setGlobalWorkSize(threadsPerGroup, imageWidth);
@@ -129,7 +129,8 @@ public:
         kernelApproxGaussianBlurVert.setArg(5, fracHalfBoxWidth);
         kernelApproxGaussianBlurVert.setArg(6, invFracHalfBoxWidth);
         kernelApproxGaussianBlurVert.setArg(7, rcpBoxWidth);
-        _gpuComputeModule->queue().runKernel(kernelApproxGaussianBlurVert);
+        clw::Event evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelApproxGaussianBlurVert));
+        writer.acquireSocket(0).setDeviceEvent(evt);
 
         return ExecutionStatus(EStatus::Ok);
     }
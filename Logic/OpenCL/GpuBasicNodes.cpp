@@ -88,15 +88,16 @@ public:
             if(!_usePinnedMemory)
             {
                 // Simple copy will suffice
-                bool result = _gpuComputeModule->queue().writeImage2D(deviceImage, hostImage.data, 
-                    clw::Rect(0, 0, hostImage.cols, hostImage.rows), static_cast<int>(hostImage.step));
+                bool result = writeImage2D(deviceImage, hostImage.data, static_cast<int>(hostImage.step));
                 return ExecutionStatus(result ? EStatus::Ok : EStatus::Error);
             }
             else
             {
                 if(!copyToPinnedBufferAsync(hostImage))
                     return ExecutionStatus(EStatus::Error, "Couldn't mapped pinned memory for device image transfer");
-                _gpuComputeModule->queue().asyncCopyBufferToImage(_pinnedBuffer, deviceImage);
+                // Host image is already copied, transfer can run in the background
+                clw::Event evt = profile(_gpuComputeModule->queue().asyncCopyBufferToImage(_pinnedBuffer, deviceImage));
+                writer.acquireSocket(0).setDeviceEvent(evt);
                 return ExecutionStatus(EStatus::Ok);
             }
         }
@@ -113,15 +114,16 @@ public:
                     clw::EMemoryLocation::Device, intermediateBufferSize);
             }
 
+            clw::Event writeEvt;
             if(!_usePinnedMemory)
             {
-                _gpuComputeModule->queue().asyncWriteBuffer(_intermediateBuffer, hostImage.data);
+                writeEvt = profile(_gpuComputeModule->queue().asyncWriteBuffer(_intermediateBuffer, hostImage.data));
             }
             else
             {
                 if(!copyToPinnedBufferAsync(hostImage))
                     return ExecutionStatus(EStatus::Error, "Couldn't mapped pinned memory for device image transfer");
-                _gpuComputeModule->queue().asyncCopyBuffer(_pinnedBuffer, _intermediateBuffer);				
+                profile(_gpuComputeModule->queue().asyncCopyBuffer(_pinnedBuffer, _intermediateBuffer));				
             }			
 
             kernelConvertBufferRgbToImageRgba.setLocalWorkSize(16, 16);
@@ -130,9 +132,13 @@ public:
             kernelConvertBufferRgbToImageRgba.setArg(1, intermediateBufferPitch);
             kernelConvertBufferRgbToImageRgba.setArg(2, deviceImage);
 
-            _gpuComputeModule->queue().asyncRunKernel(kernelConvertBufferRgbToImageRgba);
-            // FIXME: this causes stall and makes pinned memory pretty useless
-            _gpuComputeModule->queue().finish();
+            clw::Event evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelConvertBufferRgbToImageRgba));
+            writer.acquireSocket(0).setDeviceEvent(evt);
+
+            // Host image needs to stay intact only until it's transferred,
+            // conversion can run in the background
+            if(!writeEvt.isNull())
+                writeEvt.waitForFinished();
 
             return ExecutionStatus(EStatus::Ok);
         }
@@ -141,7 +147,7 @@ public:
 private:
     bool copyToPinnedBufferAsync(const cv::Mat& hostImage)
     {
-        void* ptr = _gpuComputeModule->queue().mapBuffer(_pinnedBuffer, clw::EMapAccess::Write);
+        void* ptr = mapBuffer(_pinnedBuffer, clw::EMapAccess::Write);
         if(!ptr) return false;
 
         if((int) hostImage.step != hostImage.cols)
@@ -154,7 +160,7 @@ private:
             memcpy(ptr, hostImage.data, hostImage.step * hostImage.rows);
         }
 
-        _gpuComputeModule->queue().asyncUnmap(_pinnedBuffer, ptr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedBuffer, ptr));
         return true;
     }
 
@@ -219,13 +225,12 @@ public:
             if(!_usePinnedMemory)
             {
                 // Simple copy will suffice
-                bool res = _gpuComputeModule->queue().readImage2D(deviceImage, hostImage.data, 
-                    clw::Rect(0, 0, hostImage.cols, hostImage.rows), static_cast<int>(hostImage.step));
+                bool res = readImage2D(deviceImage, hostImage.data, static_cast<int>(hostImage.step));
                 return ExecutionStatus(res ? EStatus::Ok : EStatus::Error);
             }
             else
             {
-                _gpuComputeModule->queue().asyncCopyImageToBuffer(deviceImage, _pinnedBuffer);
+                profile(_gpuComputeModule->queue().asyncCopyImageToBuffer(deviceImage, _pinnedBuffer));
                 if(!copyFromPinnedBufferAsync(hostImage))
                     return ExecutionStatus(EStatus::Error, "Couldn't mapped pinned memory for device image transfer");
                 return ExecutionStatus(EStatus::Ok);
@@ -250,22 +255,21 @@ public:
             kernelConvertImageRgbaToBufferRgb.setArg(1, _intermediateBuffer);
             kernelConvertImageRgbaToBufferRgb.setArg(2, intermediateBufferPitch);
 
-            _gpuComputeModule->queue().asyncRunKernel(kernelConvertImageRgbaToBufferRgb);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelConvertImageRgbaToBufferRgb));
 
             if(!_usePinnedMemory)
             {
-                _gpuComputeModule->queue().asyncReadBuffer(_intermediateBuffer, hostImage.data);
+                // Wait only for our own read, not for everything else enqueued in the meantime
+                clw::Event evt = profile(_gpuComputeModule->queue().asyncReadBuffer(_intermediateBuffer, hostImage.data));
+                evt.waitForFinished();
             }
             else
             {
-                _gpuComputeModule->queue().asyncCopyBuffer(_intermediateBuffer, _pinnedBuffer);
+                profile(_gpuComputeModule->queue().asyncCopyBuffer(_intermediateBuffer, _pinnedBuffer));
                 if(!copyFromPinnedBufferAsync(hostImage))
                     return ExecutionStatus(EStatus::Error, "Couldn't mapped pinned memory for device image transfer");
             }		
 
-            // FIXME: this causes stall and makes pinned memory pretty useless
-            _gpuComputeModule->queue().finish();
-
             return ExecutionStatus(EStatus::Ok);
         }
     }
@@ -273,7 +277,7 @@ public:
 private:
     bool copyFromPinnedBufferAsync(cv::Mat& hostImage)
     {
-        void* ptr = _gpuComputeModule->queue().mapBuffer(_pinnedBuffer, clw::EMapAccess::Read);
+        void* ptr = mapBuffer(_pinnedBuffer, clw::EMapAccess::Read);
         if(!ptr) return false;
             
         if((int) hostImage.step != hostImage.cols)
@@ -286,7 +290,7 @@ private:
             memcpy(hostImage.data, ptr, hostImage.step * hostImage.rows);
         }
         // Unmapping device memory when reading is practically 'no-cost'
-        _gpuComputeModule->queue().asyncUnmap(_pinnedBuffer, ptr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedBuffer, ptr));
         return true;
     }
 
@@ -320,7 +324,7 @@ public:
         deviceArray = DeviceArray::create(_gpuComputeModule->context(), clw::EAccess::ReadWrite,
             clw::EMemoryLocation::Device, hostArray.cols, hostArray.rows,
             DeviceArray::matToDeviceType(hostArray.type()));
-        clw::Event evt = deviceArray.upload(_gpuComputeModule->queue(), hostArray.data);
+        clw::Event evt = profile(deviceArray.upload(_gpuComputeModule->queue(), hostArray.data));
         evt.waitForFinished();
 
         return ExecutionStatus(EStatus::Ok);
@@ -346,7 +350,7 @@ public:
         if(deviceArray.isNull() || deviceArray.size() == 0)
             return ExecutionStatus(EStatus::Ok);
 
-        clw::Event evt = deviceArray.download(_gpuComputeModule->queue(), hostArray);
+        clw::Event evt = profile(deviceArray.download(_gpuComputeModule->queue(), hostArray));
         evt.waitForFinished();
 
         return ExecutionStatus(EStatus::Ok);
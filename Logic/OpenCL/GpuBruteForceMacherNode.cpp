@@ -223,8 +223,10 @@ private:
                 clw::EAccess::ReadWrite, clw::EMemoryLocation::AllocHostMemory, sizeof(int));
         }
 
-        int matchesCount = 0;
-        _gpuComputeModule->queue().writeBuffer(_matchesCount_cl, &matchesCount);
+        // Source of non-blocking write needs to outlive this call
+        // (in case anything below throws before the queue is finished)
+        static const int zero = 0;
+        profile(_gpuComputeModule->queue().asyncWriteBuffer(_matchesCount_cl, &zero));
 
         const size_t smemSize = (BLOCK_SIZE*(std::max)(DESCRIPTOR_LEN,BLOCK_SIZE) + BLOCK_SIZE*BLOCK_SIZE) * sizeof(int);
         clw::Kernel kernelNndrMatch = _gpuComputeModule->acquireKernel(kidBruteForceMatch);
@@ -238,26 +240,19 @@ private:
         kernelNndrMatch.setArg(5, query_dev.height());
         kernelNndrMatch.setArg(6, train_dev.height());
         kernelNndrMatch.setArg(7, (float) _distanceRatio);
-        _gpuComputeModule->queue().asyncRunKernel(kernelNndrMatch);
-
-        // Read matches count
-        _gpuComputeModule->queue().readBuffer(_matchesCount_cl, &matchesCount);
-
-        if(matchesCount > 0)
-        {
-            // and allocate required size
-            vector<DMatch> matches(matchesCount);
-
-            // Read matches
-            _gpuComputeModule->queue().readBuffer(_matches_cl, matches.data(), 
-                0, matchesCount * sizeof(DMatch));
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelNndrMatch));
 
-            return matches;
-        }
-        else
-        {
-            return vector<DMatch>();
-        }
+        // Read matches count along with all possible matches so the host 
+        // waits for the device only once (instead of after every command)
+        int matchesCount = 0;
+        vector<DMatch> matches(query_dev.height());
+        profile(_gpuComputeModule->queue().asyncReadBuffer(_matchesCount_cl, &matchesCount));
+        clw::Event evt = profile(_gpuComputeModule->queue().asyncReadBuffer(_matches_cl, matches.data(), 
+            0, matches.size() * sizeof(DMatch)));
+        evt.waitForFinished();
+
+        matches.resize((std::max)(0, (std::min)(matchesCount, int(matches.size()))));
+        return matches;
     }
 
 private:
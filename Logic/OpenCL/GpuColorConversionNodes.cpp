@@ -129,8 +129,8 @@ public:
         kernelConvertBayer2Gray.setArg(4, sharedWidth);
         kernelConvertBayer2Gray.setArg(5, sharedHeight);
 
-        _gpuComputeModule->queue().asyncRunKernel(kernelConvertBayer2Gray);
-        _gpuComputeModule->queue().finish();
+        clw::Event evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelConvertBayer2Gray));
+        writer.acquireSocket(0).setDeviceEvent(evt);
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -248,8 +248,8 @@ public:
         kernelConvertBayer2Rgb.setArg(4, sharedWidth);
         kernelConvertBayer2Rgb.setArg(5, sharedHeight);
 
-        _gpuComputeModule->queue().asyncRunKernel(kernelConvertBayer2Rgb);
-        _gpuComputeModule->queue().finish();
+        clw::Event evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelConvertBayer2Rgb));
+        writer.acquireSocket(0).setDeviceEvent(evt);
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -88,8 +88,8 @@ public:
 
         // Zero global counters
         cl_uint zero = 0;
-        _gpuComputeModule->queue().asyncWriteBuffer(_deviceCounterPoints, &zero);
-        _gpuComputeModule->queue().asyncWriteBuffer(_deviceCounterLines, &zero);
+        profile(_gpuComputeModule->queue().asyncWriteBuffer(_deviceCounterPoints, &zero));
+        profile(_gpuComputeModule->queue().asyncWriteBuffer(_deviceCounterLines, &zero));
 
         buildPointList(deviceImage, srcWidth, srcHeight);
 
@@ -114,8 +114,9 @@ public:
 
         int linesCount = extractLines(deviceLines, maxLines, numRho, numAngle);
 
+        // Lines are ready (their count had to be read back) but Hough space might not be
         if(_showHoughSpace)
-            extractHoughSpace(deviceAccumImage, numAngle, numRho);
+            writer.acquireSocket(1).setDeviceEvent(extractHoughSpace(deviceAccumImage, numAngle, numRho));
         else if(!deviceAccumImage.isNull())
             deviceAccumImage = clw::Image2D();
 
@@ -136,7 +137,7 @@ private:
         kernelBuildPointsList.setArg(0, deviceImage);
         kernelBuildPointsList.setArg(1, _devicePointsList);
         kernelBuildPointsList.setArg(2, _deviceCounterPoints);
-        return _gpuComputeModule->queue().asyncRunKernel(kernelBuildPointsList);
+        return profile(_gpuComputeModule->queue().asyncRunKernel(kernelBuildPointsList));
     }
 
     void constructHoughSpace(int numRho, int numAngle) 
@@ -157,7 +158,7 @@ private:
             kernelFillAccumSpace.setArg(0, _deviceAccum);
             kernelFillAccumSpace.setArg(1, 0);
             kernelFillAccumSpace.setArg(2, numAngle * numRho);
-            _gpuComputeModule->queue().asyncRunKernel(kernelFillAccumSpace);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelFillAccumSpace));
 
             kernelAccumLines.setLocalWorkSize(clw::Grid(256));
             kernelAccumLines.setRoundedGlobalWorkSize(clw::Grid(256 * numAngle));
@@ -167,7 +168,7 @@ private:
             kernelAccumLines.setArg(3, numRho);
             kernelAccumLines.setArg(4, invRho);
             kernelAccumLines.setArg(5, theta);
-            _gpuComputeModule->queue().asyncRunKernel(kernelAccumLines);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelAccumLines));
         }
         else
         {
@@ -182,7 +183,7 @@ private:
             kernelAccumLines.setArg(4, numRho);
             kernelAccumLines.setArg(5, invRho);
             kernelAccumLines.setArg(6, theta);
-            _gpuComputeModule->queue().asyncRunKernel(kernelAccumLines);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelAccumLines));
         }
     }
 
@@ -210,20 +211,20 @@ private:
         kernelGetLines.setArg(6, numAngle);
         kernelGetLines.setArg(7, (float) _rhoResolution);
         kernelGetLines.setArg(8, theta);
-        _gpuComputeModule->queue().asyncRunKernel(kernelGetLines);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelGetLines));
 
         // Read results
         cl_uint linesCount;
-        cl_uint* linesCountPtr = (cl_uint*) _gpuComputeModule->queue().mapBuffer(_deviceCounterLines, clw::EMapAccess::Read);
+        cl_uint* linesCountPtr = (cl_uint*) mapBuffer(_deviceCounterLines, clw::EMapAccess::Read);
         linesCount = *linesCountPtr;
-        _gpuComputeModule->queue().asyncUnmap(_deviceCounterLines, linesCountPtr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_deviceCounterLines, linesCountPtr));
 
         deviceLines.truncate(linesCount);
 
         return linesCount;
     }
 
-    void extractHoughSpace(clw::Image2D& deviceAccumImage, int numAngle, int numRho) 
+    clw::Event extractHoughSpace(clw::Image2D& deviceAccumImage, int numAngle, int numRho) 
     {
         ensureSizeIsEnough(deviceAccumImage, numAngle, numRho);
 
@@ -234,7 +235,7 @@ private:
         kernelAccumToImage.setArg(1, numRho);
         kernelAccumToImage.setArg(2, _houghSpaceScale.cast_value<float>());
         kernelAccumToImage.setArg(3, deviceAccumImage);
-        _gpuComputeModule->queue().runKernel(kernelAccumToImage);
+        return profile(_gpuComputeModule->queue().asyncRunKernel(kernelAccumToImage));
     }
 
     void ensureSizeIsEnough(clw::Buffer& buffer, size_t size)
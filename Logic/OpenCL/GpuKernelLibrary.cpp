@@ -27,8 +27,58 @@
 #include "GpuKernelLibrary.h"
 #include "GpuException.h"
 
+#include "Kommon/Hash.h"
+#include "Kommon/StringUtils.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Bump whenever layout of cache file changes
+static const char* BinaryCacheMagic = "mouve-clbin-1";
+
+bool readTextFile(const string& path, string& contents)
+{
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if(!file)
+        return false;
+    std::ostringstream strm;
+    strm << file.rdbuf();
+    contents = strm.str();
+    return true;
+}
+
+string deviceInfoString(cl_device_id deviceId, cl_device_info info)
+{
+    size_t size = 0;
+    if(clGetDeviceInfo(deviceId, info, 0, nullptr, &size) != CL_SUCCESS || size == 0)
+        return string();
+    vector<char> buffer(size);
+    if(clGetDeviceInfo(deviceId, info, size, buffer.data(), nullptr) != CL_SUCCESS)
+        return string();
+    return string(buffer.data());
+}
+
+template <typename T>
+bool readValue(std::istream& strm, T& value)
+{
+    return !!strm.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void writeValue(std::ostream& strm, const T& value)
+{
+    strm.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+}
 
 KernelLibrary::KernelLibrary()
 {
@@ -63,6 +113,11 @@ void KernelLibrary::create(const clw::Context& context,
     _kernels.emplace_back();
 }
 
+void KernelLibrary::setBinaryCacheDirectory(const string& binaryCacheDirectory)
+{
+    _binaryCacheDirectory = binaryCacheDirectory;
+}
+
 KernelID KernelLibrary::registerKernel(const string& kernelName, 
     const string& programName, const string& buildOptions)
 {
@@ -199,6 +254,86 @@ void KernelLibrary::rebuildProgram(const string& programName)
     }
 }
 
+vector<GpuProgramBuildInfo> KernelLibrary::buildRegisteredPrograms(bool parallel,
+    const std::function<void(const GpuProgramBuildInfo&, size_t, size_t)>& onProgramBuilt)
+{
+    // Gather programs that would be otherwise built on first kernel acquire
+    vector<std::pair<const string*, ProgramEntry*>> pending;
+    for(auto& programEntry : _programs)
+    {
+        if(!programEntry.second.program.isBuilt())
+            pending.emplace_back(&programEntry.first, &programEntry.second);
+    }
+
+    vector<GpuProgramBuildInfo> buildInfos(pending.size());
+    vector<clw::Program> programs(pending.size());
+    std::atomic<size_t> nextProgram(0);
+    std::mutex callbackMutex;
+    size_t builtCount = 0;
+
+    auto worker = [&] {
+        for(size_t i; (i = nextProgram++) < pending.size(); )
+        {
+            const string& programName = *pending[i].first;
+            const string& buildOptions = pending[i].second->buildOptions;
+            string error;
+
+            using namespace std::chrono;
+            auto start = high_resolution_clock::now();
+            try
+            {
+                programs[i] = buildProgram(programName, buildOptions);
+            }
+            catch(std::exception& ex)
+            {
+                error = ex.what();
+            }
+            auto stop = high_resolution_clock::now();
+
+            GpuProgramBuildInfo& buildInfo = buildInfos[i];
+            buildInfo.programName = programName;
+            buildInfo.options = buildOptions;
+            buildInfo.built = programs[i].isBuilt();
+            buildInfo.elapsed = duration_cast<duration<double, std::milli>>(stop - start).count();
+            if(!error.empty())
+                buildInfo.log = error;
+            else if(programs[i].isNull())
+                buildInfo.log = "Failed to load " + programName;
+            else if(!buildInfo.built)
+                buildInfo.log = programs[i].log();
+
+            if(onProgramBuilt)
+            {
+                std::lock_guard<std::mutex> lock(callbackMutex);
+                onProgramBuilt(buildInfo, ++builtCount, pending.size());
+            }
+        }
+    };
+
+    size_t numThreads = 1;
+    if(parallel)
+    {
+        numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        numThreads = std::min(numThreads, pending.size());
+    }
+
+    vector<std::thread> threads;
+    for(size_t t = 1; t < numThreads; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for(auto& thread : threads)
+        thread.join();
+
+    // Failed ones stay unbuilt - acquireKernel will report the error
+    for(size_t i = 0; i < pending.size(); ++i)
+    {
+        if(programs[i].isBuilt())
+            pending[i].second->program = programs[i];
+    }
+
+    return buildInfos;
+}
+
 vector<GpuRegisteredProgram> KernelLibrary::populateListOfRegisteredPrograms() const
 {
     vector<GpuRegisteredProgram> list;
@@ -271,13 +406,173 @@ clw::Program KernelLibrary::buildProgram(const string& programName,
 {
     // Program hasn't been built, need to it right now
     string programPath = _programsDirectory + programName;
+
+    // Try binary built by one of previous runs first
+    string cachePath, cacheKey;
+    string source;
+    if(!_binaryCacheDirectory.empty() && readTextFile(programPath, source))
+    {
+        cacheKey = binaryCacheKey(source, buildOptions);
+        cachePath = _binaryCacheDirectory + programName + string_format(".%08x.bin", 
+            SuperFastHash(cacheKey.data(), int(cacheKey.size())));
+
+        clw::Program program = loadProgramBinary(cachePath, cacheKey, buildOptions);
+        if(program.isBuilt())
+            return program;
+    }
+
     clw::Program program = _context.createProgramFromSourceFile(programPath);
     if(program.isNull())
         return clw::Program();
     program.build(buildOptions);
+
+    if(program.isBuilt() && !cachePath.empty())
+        saveProgramBinary(program, cachePath, cacheKey);
     return program;
 }
 
+string KernelLibrary::binaryCacheKey(const string& source, 
+                                     const string& buildOptions) const
+{
+    // Binary is only valid for the very same devices, drivers, sources and options
+    string key = BinaryCacheMagic;
+    for(const auto& device : _context.devices())
+    {
+        key += "|" + deviceInfoString(device.deviceId(), CL_DEVICE_NAME);
+        key += "|" + deviceInfoString(device.deviceId(), CL_DRIVER_VERSION);
+    }
+    key += string_format("|%08x|", SuperFastHash(source.data(), int(source.size())));
+    key += buildOptions;
+    return key;
+}
+
+clw::Program KernelLibrary::loadProgramBinary(const string& cachePath,
+                                              const string& cacheKey,
+                                              const string& buildOptions)
+{
+    std::ifstream file(cachePath, std::ios::in | std::ios::binary);
+    if(!file)
+        return clw::Program();
+
+    // Cache file: key length, key, number of binaries, {size, binary}...
+    uint32_t keySize = 0;
+    if(!readValue(file, keySize) || keySize != cacheKey.size())
+        return clw::Program();
+    string key(keySize, '\0');
+    if(!file.read(&key[0], keySize) || key != cacheKey)
+        return clw::Program();
+
+    vector<clw::Device> devices = _context.devices();
+    uint32_t numBinaries = 0;
+    if(!readValue(file, numBinaries) || numBinaries != devices.size())
+        return clw::Program();
+
+    vector<vector<unsigned char>> binaries(numBinaries);
+    vector<const unsigned char*> binaryPtrs(numBinaries);
+    vector<size_t> binarySizes(numBinaries);
+    vector<cl_device_id> deviceIds(numBinaries);
+    for(uint32_t i = 0; i < numBinaries; ++i)
+    {
+        uint64_t size = 0;
+        if(!readValue(file, size) || size == 0)
+            return clw::Program();
+        binaries[i].resize(size_t(size));
+        if(!file.read(reinterpret_cast<char*>(binaries[i].data()), size))
+            return clw::Program();
+
+        binaryPtrs[i] = binaries[i].data();
+        binarySizes[i] = size_t(size);
+        deviceIds[i] = devices[i].deviceId();
+    }
+
+    vector<cl_int> binaryStatus(numBinaries);
+    cl_int error;
+    cl_program programId = clCreateProgramWithBinary(_context.contextId(),
+        numBinaries, deviceIds.data(), binarySizes.data(), binaryPtrs.data(),
+        binaryStatus.data(), &error);
+    if(error != CL_SUCCESS)
+        return clw::Program();
+
+    // Binaries still need to be built. Driver may reject them 
+    // (e.g stale cache) - just fall back to building from sources then
+    clw::Program program(&_context, programId);
+    try
+    {
+        program.build(buildOptions);
+    }
+    catch(GpuNodeException&)
+    {
+        return clw::Program();
+    }
+    return program;
+}
+
+void KernelLibrary::saveProgramBinary(const clw::Program& program,
+                                      const string& cachePath,
+                                      const string& cacheKey)
+{
+    cl_program programId = program.programId();
+    cl_uint numDevices = 0;
+    if(clGetProgramInfo(programId, CL_PROGRAM_NUM_DEVICES, 
+            sizeof(numDevices), &numDevices, nullptr) != CL_SUCCESS
+        || numDevices != _context.devices().size())
+    {
+        return;
+    }
+
+    vector<size_t> binarySizes(numDevices);
+    if(clGetProgramInfo(programId, CL_PROGRAM_BINARY_SIZES, 
+            sizeof(size_t) * numDevices, binarySizes.data(), nullptr) != CL_SUCCESS)
+    {
+        return;
+    }
+
+    vector<vector<unsigned char>> binaries(numDevices);
+    vector<unsigned char*> binaryPtrs(numDevices);
+    for(cl_uint i = 0; i < numDevices; ++i)
+    {
+        // Some platforms don't provide binaries at all
+        if(binarySizes[i] == 0)
+            return;
+        binaries[i].resize(binarySizes[i]);
+        binaryPtrs[i] = binaries[i].data();
+    }
+
+    if(clGetProgramInfo(programId, CL_PROGRAM_BINARIES, 
+            sizeof(unsigned char*) * numDevices, binaryPtrs.data(), nullptr) != CL_SUCCESS)
+    {
+        return;
+    }
+
+    // Write to temporary file first so no one else sees half-written cache
+    string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file)
+            return;
+
+        writeValue(file, uint32_t(cacheKey.size()));
+        file.write(cacheKey.data(), cacheKey.size());
+        writeValue(file, uint32_t(numDevices));
+        for(const auto& binary : binaries)
+        {
+            writeValue(file, uint64_t(binary.size()));
+            file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+        }
+
+        if(!file)
+        {
+            file.close();
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+
+    std::remove(cachePath.c_str());
+    if(std::rename(tempPath.c_str(), cachePath.c_str()) != 0)
+        std::remove(tempPath.c_str());
+}
+
 KernelLibrary::ProgramEntry* KernelLibrary::findProgramEntry(const string& programName, 
                                                              const string& buildOptions)
 {
@@ -36,6 +36,7 @@ using std::unordered_multimap;
 typedef uint32_t KernelID;
 static const KernelID InvalidKernelID = KernelID(0);
 struct GpuRegisteredProgram;
+struct GpuProgramBuildInfo;
 
 class KernelLibrary
 {
@@ -50,6 +51,10 @@ public:
         const string& programsDirectory = "");
     bool isCreated() const { return _context.isCreated(); }
 
+    /// Directory where built program binaries are cached between runs
+    /// (empty string disables the cache)
+    void setBinaryCacheDirectory(const string& binaryCacheDirectory);
+
     /// TODO: 
     ///void purgeLibrary();
     /// TODO: Przejedz po wszystkich programach
@@ -62,6 +67,10 @@ public:
 
     KernelID updateKernel(KernelID kernelId, const string& buildOptions);
     void rebuildProgram(const string& programName);
+    /// Builds all registered programs that haven't been built yet, 
+    /// optionally on many threads (one program per thread at a time)
+    vector<GpuProgramBuildInfo> buildRegisteredPrograms(bool parallel,
+        const std::function<void(const GpuProgramBuildInfo&, size_t, size_t)>& onProgramBuilt);
 
     vector<GpuRegisteredProgram> populateListOfRegisteredPrograms() const;
 
@@ -97,11 +106,17 @@ private:
     vector<KernelEntry> _kernels;
     unordered_multimap<string, ProgramEntry> _programs;
     string _programsDirectory;
+    string _binaryCacheDirectory;
 
 private:
     clw::Program findProgram(const string& programName, const string& buildOptions);
     bool isProgramRegistered(const string& programName, const string& buildOptions);
     clw::Program buildProgram(const string& programName, const string& buildOptions);
+    string binaryCacheKey(const string& source, const string& buildOptions) const;
+    clw::Program loadProgramBinary(const string& cachePath, const string& cacheKey,
+        const string& buildOptions);
+    void saveProgramBinary(const clw::Program& program, const string& cachePath,
+        const string& cacheKey);
     ProgramEntry* findProgramEntry(const string& programName, const string& buildOptions);
     void updateKernelEntry(const clw::Program& program, KernelEntry& entry,
         const string& buildOptions);
@@ -101,9 +101,9 @@ public:
         if(!_mixtureDataBuffer.isNull())
         {
             // Wyzerowanie
-            void* ptr = _gpuComputeModule->queue().mapBuffer(_mixtureDataBuffer, clw::EMapAccess::Write);
+            void* ptr = mapBuffer(_mixtureDataBuffer, clw::EMapAccess::Write);
             memset(ptr, 0, _mixtureDataBuffer.size());
-            _gpuComputeModule->queue().asyncUnmap(_mixtureDataBuffer, ptr);
+            profile(_gpuComputeModule->queue().asyncUnmap(_mixtureDataBuffer, ptr));
         }
 
         // Parametry stale dla kernela
@@ -123,14 +123,14 @@ public:
                 clw::EAccess::ReadOnly, clw::EMemoryLocation::Device, sizeof(MogParams));
         }
 
-        MogParams* ptr = (MogParams*) _gpuComputeModule->queue().mapBuffer(
+        MogParams* ptr = (MogParams*) mapBuffer(
             _mixtureParamsBuffer, clw::EMapAccess::Write);
         ptr->varThreshold = _varianceThreshold;
         ptr->backgroundRatio = _backgroundRatio;
         ptr->w0 = _initialWeight;
         ptr->var0 = _initialVariance;
         ptr->minVar = _minVariance;
-        _gpuComputeModule->queue().asyncUnmap(_mixtureParamsBuffer, ptr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_mixtureParamsBuffer, ptr));
 
         return true;
     }
@@ -177,7 +177,8 @@ public:
         kernelGaussMix.setArg(2, _mixtureDataBuffer);
         kernelGaussMix.setArg(3, _mixtureParamsBuffer);
         kernelGaussMix.setArg(4, alpha);
-        _gpuComputeModule->queue().asyncRunKernel(kernelGaussMix);
+        clw::Event evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelGaussMix));
+        writer.acquireSocket(0).setDeviceEvent(evt);
 
         if(_showBackground)
         {
@@ -200,10 +201,10 @@ public:
             kernelBackground.setArg(0, deviceDestBackground);
             kernelBackground.setArg(1, _mixtureDataBuffer);
             kernelBackground.setArg(2, _mixtureParamsBuffer);
-            _gpuComputeModule->queue().asyncRunKernel(kernelBackground);
+            evt = profile(_gpuComputeModule->queue().asyncRunKernel(kernelBackground));
+            writer.acquireSocket(1).setDeviceEvent(evt);
         }
 
-        _gpuComputeModule->queue().finish();
         return ExecutionStatus(EStatus::Ok);
     }
 
@@ -220,9 +221,9 @@ private:
                 clw::EAccess::ReadWrite, clw::EMemoryLocation::Device, mixtureDataSize);
 
             // Wyzerowanie
-            void* ptr = _gpuComputeModule->queue().mapBuffer(_mixtureDataBuffer, clw::EMapAccess::Write);
+            void* ptr = mapBuffer(_mixtureDataBuffer, clw::EMapAccess::Write);
             memset(ptr, 0, mixtureDataSize);
-            _gpuComputeModule->queue().unmap(_mixtureDataBuffer, ptr);
+            profile(_gpuComputeModule->queue().asyncUnmap(_mixtureDataBuffer, ptr));
         }
     }
 
@@ -121,8 +121,7 @@ public:
             return ExecutionStatus(EStatus::Error, "Gradient, TopHat and BlackHat not yet implemented for GPU module");
         }
 
-        // Execute it 
-        _gpuComputeModule->queue().finish();
+        writer.acquireSocket(0).setDeviceEvent(evt);
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -195,11 +194,11 @@ private:
                 clw::EAccess::ReadWrite, clw::EMemoryLocation::AllocHostMemory, bmuSize);
         }
 
-        cl_int2* ptr = static_cast<cl_int2*>(_gpuComputeModule->queue().mapBuffer(
+        cl_int2* ptr = static_cast<cl_int2*>(mapBuffer(
             _pinnedStructuringElement, clw::EMapAccess::Write));
         memcpy(ptr, sElemCoords.data(), bmuSize);
-        _gpuComputeModule->queue().asyncUnmap(_pinnedStructuringElement, ptr);
-        _gpuComputeModule->queue().asyncCopyBuffer(_pinnedStructuringElement, _deviceStructuringElement);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedStructuringElement, ptr));
+        profile(_gpuComputeModule->queue().asyncCopyBuffer(_pinnedStructuringElement, _deviceStructuringElement));
     }
 
     void ensureSizeIsEnough(clw::Image2D& image, int width, int height)
@@ -236,7 +235,7 @@ private:
         kernel.setArg(8, sharedHeight);
 
         // Enqueue the kernel for execution
-        return _gpuComputeModule->queue().asyncRunKernel(kernel);
+        return profile(_gpuComputeModule->queue().asyncRunKernel(kernel));
     }
 
 private:
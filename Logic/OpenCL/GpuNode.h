@@ -45,8 +45,60 @@ public:
 
     virtual bool postInit() { return true; }
 
+    double deviceTimeElapsed() override
+    {
+        return _gpuComputeModule 
+            ? _gpuComputeModule->deviceTimeElapsed(_profiledEvents)
+            : 0.0;
+    }
+
+protected:
+    // Records issued command so its device time is accounted to this node
+    // (only if profiling is enabled)
+    clw::Event profile(const clw::Event& event)
+    {
+        if(_gpuComputeModule->isProfilingEnabled() && !event.isNull())
+            _profiledEvents.push_back(event);
+        return event;
+    }
+
+    // Blocking commands on the main queue - unlike clw::CommandQueue ones
+    // they are recorded by profile() as well
+    bool runKernel(const clw::Kernel& kernel)
+    {
+        return waitFor(profile(_gpuComputeModule->queue().asyncRunKernel(kernel)));
+    }
+
+    void* mapBuffer(const clw::Buffer& buffer, clw::EMapAccess access)
+    {
+        void* ptr = nullptr;
+        if(!waitFor(profile(_gpuComputeModule->queue().asyncMapBuffer(buffer, &ptr, access))))
+            return nullptr;
+        return ptr;
+    }
+
+    bool readImage2D(const clw::Image2D& image, void* data, int rowPitch)
+    {
+        return waitFor(profile(_gpuComputeModule->queue().asyncReadImage2D(image, data, rowPitch)));
+    }
+
+    bool writeImage2D(clw::Image2D& image, const void* data, int rowPitch)
+    {
+        return waitFor(profile(_gpuComputeModule->queue().asyncWriteImage2D(image, data, rowPitch)));
+    }
+
+private:
+    static bool waitFor(clw::Event event)
+    {
+        if(event.isNull())
+            return false;
+        event.waitForFinished();
+        return true;
+    }
+
 protected:
     std::shared_ptr<GpuNodeModule> _gpuComputeModule;
+    std::vector<clw::Event> _profiledEvents;
 };
 
 #endif
\ No newline at end of file
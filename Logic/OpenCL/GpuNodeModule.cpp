@@ -28,13 +28,18 @@
 
 #include "Kommon/ModulePath.h"
 
+#include <opencv2/imgproc/imgproc.hpp>
+
 #include <QFileInfo>
 #include <QDir>
+#include <QStandardPaths>
 
 #include <cassert>
+#include <cstdlib>
 
 namespace {
 static string kernelsDirectory();
+static string kernelsCacheDirectory();
 }
 
 GpuNodeModule::GpuNodeModule(bool interactiveInit)
@@ -42,11 +47,14 @@ GpuNodeModule::GpuNodeModule(bool interactiveInit)
     , _maxLocalMemory(0)
     , _logger()
     , _interactiveInit(interactiveInit)
+    , _profilingEnabled(false)
 {
 }
 
 GpuNodeModule::~GpuNodeModule()
 {
+    if(NodeFlowData::deviceImageTransfer() == this)
+        NodeFlowData::setDeviceImageTransfer(nullptr);
 }
 
 bool GpuNodeModule::initialize()
@@ -63,6 +71,8 @@ bool GpuNodeModule::initialize()
     {
         static string allKernelsDirectory = kernelsDirectory() + "/";
         _library.create(_context, allKernelsDirectory);
+        _library.setBinaryCacheDirectory(kernelsCacheDirectory());
+        NodeFlowData::setDeviceImageTransfer(this);
     }
 
     return res;
@@ -193,11 +203,76 @@ void GpuNodeModule::rebuildProgram(const string& programName)
     _library.rebuildProgram(programName);
 }
 
+vector<GpuProgramBuildInfo> GpuNodeModule::warmUp(bool parallel,
+                                                  const OnProgramBuilt& onProgramBuilt)
+{
+    if(!isInitialized())
+        return vector<GpuProgramBuildInfo>();
+    return _library.buildRegisteredPrograms(parallel, onProgramBuilt);
+}
+
+bool GpuNodeModule::uploadImage(const cv::Mat& hostImage, clw::Image2D& deviceImage)
+{
+    if(hostImage.depth() != CV_8U || (hostImage.channels() != 1 && hostImage.channels() != 3))
+        return false;
+
+    // Device doesn't do 3-channel images - convert on the host, 
+    // it's cheaper than a kernel launch with an intermediate buffer
+    cv::Mat source = hostImage;
+    if(hostImage.channels() == 3)
+        cv::cvtColor(hostImage, source, CV_BGR2RGBA);
+    clw::EChannelOrder channelOrder = source.channels() == 1 
+        ? clw::EChannelOrder::R 
+        : clw::EChannelOrder::RGBA;
+
+    // Reuse outdated copy if it fits
+    if(deviceImage.isNull()
+        || deviceImage.width() != source.cols
+        || deviceImage.height() != source.rows
+        || deviceImage.format().order != channelOrder)
+    {
+        deviceImage = _context.createImage2D(
+            clw::EAccess::ReadWrite, clw::EMemoryLocation::Device,
+            clw::ImageFormat(channelOrder, clw::EChannelType::Normalized_UInt8),
+            source.cols, source.rows);
+    }
+
+    // Blocking as source might be a temporary
+    return _queue.writeImage2D(deviceImage, source.data, 
+        clw::Rect(0, 0, source.cols, source.rows), static_cast<int>(source.step));
+}
+
+bool GpuNodeModule::downloadImage(const clw::Image2D& deviceImage, cv::Mat& hostImage)
+{
+    clw::ImageFormat imageFormat = deviceImage.format();
+    if(imageFormat.order != clw::EChannelOrder::R && imageFormat.order != clw::EChannelOrder::RGBA)
+        return false;
+
+    int width = deviceImage.width();
+    int height = deviceImage.height();
+
+    // Same queue as producing kernels so they are done before the read
+    if(imageFormat.order == clw::EChannelOrder::R)
+    {
+        hostImage.create(height, width, CV_8UC1);
+        return _queue.readImage2D(deviceImage, hostImage.data,
+            clw::Rect(0, 0, width, height), static_cast<int>(hostImage.step));
+    }
+    else
+    {
+        cv::Mat rgba(height, width, CV_8UC4);
+        if(!_queue.readImage2D(deviceImage, rgba.data,
+            clw::Rect(0, 0, width, height), static_cast<int>(rgba.step)))
+            return false;
+        cv::cvtColor(rgba, hostImage, CV_RGBA2BGR);
+        return true;
+    }
+}
+
 bool GpuNodeModule::createAfterContext()
 {
     _device = _context.devices()[0];
-    _queue = _context.createCommandQueue(_device);//clw::ECommandQueueProperty::ProfilingEnabled);
-    _dataQueue = _context.createCommandQueue(_device);//clw::ECommandQueueProperty::ProfilingEnabled);
+    createCommandQueues();
 
     clw::installErrorHandler([=](cl_int error_id, const std::string& message)
     {
@@ -214,6 +289,68 @@ bool GpuNodeModule::createAfterContext()
     return !_device.isNull() && !_queue.isNull();
 }
 
+void GpuNodeModule::createCommandQueues()
+{
+    // Profiling isn't free on some platforms - enable it only on demand
+    if(_profilingEnabled)
+    {
+        _queue = _context.createCommandQueue(_device, clw::ECommandQueueProperty::ProfilingEnabled);
+        _dataQueue = _context.createCommandQueue(_device, clw::ECommandQueueProperty::ProfilingEnabled);
+    }
+    else
+    {
+        _queue = _context.createCommandQueue(_device);
+        _dataQueue = _context.createCommandQueue(_device);
+    }
+}
+
+void GpuNodeModule::setProfilingEnabled(bool enable)
+{
+    if(_profilingEnabled == enable)
+        return;
+    _profilingEnabled = enable;
+
+    // Properties of existing queue can't be changed (clSetCommandQueueProperty is deprecated)
+    if(isInitialized())
+    {
+        _queue.finish();
+        _dataQueue.finish();
+        createCommandQueues();
+    }
+}
+
+double GpuNodeModule::deviceTimeElapsed(vector<clw::Event>& events) const
+{
+    if(events.empty())
+        return 0.0;
+
+    vector<cl_event> eventIds;
+    eventIds.reserve(events.size());
+    for(const auto& event : events)
+        eventIds.push_back(event.eventId());
+
+    cl_ulong total = 0;
+    if(clWaitForEvents(cl_uint(eventIds.size()), eventIds.data()) == CL_SUCCESS)
+    {
+        for(cl_event eventId : eventIds)
+        {
+            // Device counters are in nanoseconds
+            cl_ulong start = 0, end = 0;
+            if(clGetEventProfilingInfo(eventId, CL_PROFILING_COMMAND_START,
+                    sizeof(start), &start, nullptr) == CL_SUCCESS
+                && clGetEventProfilingInfo(eventId, CL_PROFILING_COMMAND_END,
+                    sizeof(end), &end, nullptr) == CL_SUCCESS
+                && end > start)
+            {
+                total += end - start;
+            }
+        }
+    }
+
+    events.clear();
+    return double(total) * 1e-6;
+}
+
 size_t GpuNodeModule::warpSize() const
 {
     if(device().deviceType() != clw::EDeviceType::Gpu)
@@ -255,6 +392,20 @@ static string kernelsDirectory()
         .toStdString();
 }
 
+static string kernelsCacheDirectory()
+{
+    // MOUVE_KERNELS_CACHE overrides default location, empty value disables the cache
+    QString cacheDir;
+    if(const char* env = std::getenv("MOUVE_KERNELS_CACHE"))
+        cacheDir = QString::fromLocal8Bit(env);
+    else if(!QStandardPaths::writableLocation(QStandardPaths::CacheLocation).isEmpty())
+        cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/kernels";
+
+    if(cacheDir.isEmpty() || !QDir().mkpath(cacheDir))
+        return string();
+    return QDir(cacheDir).absolutePath().toStdString() + "/";
+}
+
 }
 
 string GpuNodeModule::additionalBuildOptions(const std::string& programName) const
@@ -28,11 +28,12 @@
 #include "IGpuNodeModule.h"
 #include "GpuKernelLibrary.h"
 #include "GpuActivityLogger.h"
+#include "../NodeFlowData.h"
 
 using std::vector;
 using std::string;
 
-class LOGIC_EXPORT GpuNodeModule : public IGpuNodeModule
+class LOGIC_EXPORT GpuNodeModule : public IGpuNodeModule, public IDeviceImageTransfer
 {
 public:
     explicit GpuNodeModule(bool interactiveInit);
@@ -57,6 +58,18 @@ public:
 
     vector<GpuRegisteredProgram> populateListOfRegisteredPrograms() const override;
     void rebuildProgram(const string& programName) override;
+    void setProfilingEnabled(bool enable) override;
+    bool isProfilingEnabled() const override;
+    // Waits for given events and returns sum of their execution times [ms]
+    // Events list is cleared afterwards
+    double deviceTimeElapsed(vector<clw::Event>& events) const;
+
+    vector<GpuProgramBuildInfo> warmUp(bool parallel = true,
+        const OnProgramBuilt& onProgramBuilt = OnProgramBuilt()) override;
+
+    // Used by image flow data linked between host and device sockets
+    bool uploadImage(const cv::Mat& hostImage, clw::Image2D& deviceImage) override;
+    bool downloadImage(const clw::Image2D& deviceImage, cv::Mat& hostImage) override;
 
     bool isConstantMemorySufficient(uint64_t memSize) const;
     bool isLocalMemorySufficient(uint64_t memSize) const;
@@ -76,6 +89,7 @@ public:
 private:
     std::string additionalBuildOptions(const std::string& programName) const;
     bool createAfterContext();
+    void createCommandQueues();
 
 private:
     clw::Context _context;
@@ -90,12 +104,15 @@ private:
     GpuActivityLogger _logger;
 
     bool _interactiveInit;
+    bool _profilingEnabled;
 };
 
 inline void GpuNodeModule::setInteractiveInit(bool interactiveInit)
 { _interactiveInit = interactiveInit; }
 inline bool GpuNodeModule::isInteractiveInit() const
 { return _interactiveInit; }
+inline bool GpuNodeModule::isProfilingEnabled() const
+{ return _profilingEnabled; }
 inline bool GpuNodeModule::isConstantMemorySufficient(uint64_t memSize) const
 { return memSize <= _maxConstantMemory; }
 inline bool GpuNodeModule::isLocalMemorySufficient(uint64_t memSize) const
@@ -176,12 +176,12 @@ public:
 
 
         // On AMD these are the same solutions
-        int* intPtr = (int*) _gpuComputeModule->queue().mapBuffer(_pinnedKeypointsCount_cl, clw::EMapAccess::Write);
+        int* intPtr = (int*) mapBuffer(_pinnedKeypointsCount_cl, clw::EMapAccess::Write);
         if(!intPtr)
             return ExecutionStatus(EStatus::Error, "Couldn't mapped keypoints counter buffer to host address space");
         intPtr[0] = 0;
-        _gpuComputeModule->queue().asyncUnmap(_pinnedKeypointsCount_cl, intPtr);
-        _gpuComputeModule->queue().asyncCopyBuffer(_pinnedKeypointsCount_cl, _keypointsCount_cl);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedKeypointsCount_cl, intPtr));
+        profile(_gpuComputeModule->queue().asyncCopyBuffer(_pinnedKeypointsCount_cl, _keypointsCount_cl));
 
         convertImageToIntegral(deviceImage, imageWidth, imageHeight);
 
@@ -189,19 +189,21 @@ public:
         buildScaleSpace(imageWidth, imageHeight);
         findScaleSpaceMaxima();
 
+        // Input image is read on a different queue than the one it was produced on
+        reader.readSocket(0).waitForDeviceData();
         kp.image.create(imageHeight, imageWidth, CV_8UC1);
-        _gpuComputeModule->dataQueue().asyncReadImage2D(deviceImage, kp.image.data, (int) kp.image.step);
+        profile(_gpuComputeModule->dataQueue().asyncReadImage2D(deviceImage, kp.image.data, (int) kp.image.step));
         _gpuComputeModule->dataQueue().flush();
 
         _gpuComputeModule->activityLogger().beginPerfMarker("Read number of keypoints", "SURF");
 
         // Read keypoints counter (use pinned memory)
-        _gpuComputeModule->queue().asyncCopyBuffer(_keypointsCount_cl, _pinnedKeypointsCount_cl);
-        intPtr = (int*) _gpuComputeModule->queue().mapBuffer(_pinnedKeypointsCount_cl, clw::EMapAccess::Read);
+        profile(_gpuComputeModule->queue().asyncCopyBuffer(_keypointsCount_cl, _pinnedKeypointsCount_cl));
+        intPtr = (int*) mapBuffer(_pinnedKeypointsCount_cl, clw::EMapAccess::Read);
         if(!intPtr)
             return ExecutionStatus(EStatus::Error, "Couldn't mapped keypoints counter buffer to host address space");
         int keypointsCount = min(intPtr[0], kKeypointsMax);
-        _gpuComputeModule->queue().asyncUnmap(_pinnedKeypointsCount_cl, intPtr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedKeypointsCount_cl, intPtr));
 
         _gpuComputeModule->activityLogger().endPerfMarker();
 
@@ -217,7 +219,7 @@ public:
 
             // Start copying descriptors to pinned buffer
             if(_downloadDescriptors)
-                _gpuComputeModule->queue().asyncCopyBuffer(_descriptors_cl, _pinnedDescriptors_cl);
+                profile(_gpuComputeModule->queue().asyncCopyBuffer(_descriptors_cl, _pinnedDescriptors_cl));
 
             vector<KeyPoint> kps = downloadKeypoints(keypointsCount);
             kp.kpoints = transformKeyPoint(kps);
@@ -227,7 +229,7 @@ public:
             if(_downloadDescriptors)
             {
                 descriptors.create(keypointsCount, 64, CV_32F);
-                float* floatPtr = (float*) _gpuComputeModule->queue().mapBuffer(_pinnedDescriptors_cl, clw::EMapAccess::Read);
+                float* floatPtr = (float*) mapBuffer(_pinnedDescriptors_cl, clw::EMapAccess::Read);
                 if(!floatPtr)
                     return ExecutionStatus(EStatus::Error, "Couldn't mapped descriptors buffer to host address space");
                 if(descriptors.step == 64*sizeof(float))
@@ -242,7 +244,7 @@ public:
                         memcpy(descriptors.ptr<float>(row), floatPtr + 64*row, sizeof(float)*64);
                 }
 
-                _gpuComputeModule->queue().asyncUnmap(_pinnedDescriptors_cl, floatPtr);
+                profile(_gpuComputeModule->queue().asyncUnmap(_pinnedDescriptors_cl, floatPtr));
             }
 
             // Finish downloading input image
@@ -275,8 +277,8 @@ protected:
         _samplesCoords_cl = _gpuComputeModule->context().createBuffer(
             clw::EAccess::ReadOnly, clw::EMemoryLocation::Device, sizeof(cl_int2)*nOriSamples);
 
-        float* gaussianPtr = (float*) _gpuComputeModule->queue().mapBuffer(_gaussianWeights_cl, clw::EMapAccess::Write);
-        cl_int2* samplesPtr = (cl_int2*) _gpuComputeModule->queue().mapBuffer(_samplesCoords_cl, clw::EMapAccess::Write);
+        float* gaussianPtr = (float*) mapBuffer(_gaussianWeights_cl, clw::EMapAccess::Write);
+        cl_int2* samplesPtr = (cl_int2*) mapBuffer(_samplesCoords_cl, clw::EMapAccess::Write);
         if(!gaussianPtr || !samplesPtr)
             return;
         int index = 0;
@@ -299,8 +301,8 @@ protected:
 
         _constantsUploaded = true;
 
-        _gpuComputeModule->queue().asyncUnmap(_gaussianWeights_cl, gaussianPtr);
-        _gpuComputeModule->queue().asyncUnmap(_samplesCoords_cl, samplesPtr);
+        profile(_gpuComputeModule->queue().asyncUnmap(_gaussianWeights_cl, gaussianPtr));
+        profile(_gpuComputeModule->queue().asyncUnmap(_samplesCoords_cl, samplesPtr));
     }
 
     void ensureKeypointsBufferIsEnough()
@@ -347,7 +349,7 @@ protected:
             kernelFillImage.setRoundedGlobalWorkSize(imageWidth+1,imageHeight+1);
             kernelFillImage.setArg(0, _imageIntegral_cl);
             kernelFillImage.setArg(1, 0);
-            _gpuComputeModule->queue().asyncRunKernel(kernelFillImage);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelFillImage));
         }
 
         if(_gpuComputeModule->device().deviceType() != clw::EDeviceType::Cpu)
@@ -359,20 +361,20 @@ protected:
             kernelMultiScan_horiz.setRoundedGlobalWorkSize(256,imageHeight);
             kernelMultiScan_horiz.setArg(0, srcImage_cl);
             kernelMultiScan_horiz.setArg(1, _tempImage_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_horiz);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_horiz));
 
             kernelMultiScan_vert.setLocalWorkSize(256,1);
             kernelMultiScan_vert.setRoundedGlobalWorkSize(256,imageWidth);
             kernelMultiScan_vert.setArg(0, _tempImage_cl);
             kernelMultiScan_vert.setArg(1, _imageIntegral_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_vert);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_vert));
         }
         else
         {
             cv::Mat srcHost(imageHeight, imageWidth, CV_8UC1), integralHost;
-            _gpuComputeModule->queue().readImage2D(srcImage_cl, srcHost.data, static_cast<int>(srcHost.step));
+            readImage2D(srcImage_cl, srcHost.data, static_cast<int>(srcHost.step));
             cv::integral(srcHost, integralHost);
-            _gpuComputeModule->queue().writeImage2D(_imageIntegral_cl, integralHost.data, static_cast<int>(integralHost.step));
+            writeImage2D(_imageIntegral_cl, integralHost.data, static_cast<int>(integralHost.step));
         }
     }
 
@@ -489,7 +491,7 @@ protected:
                 kernelBuildScaleSpace.setArg(11, layer.sampleStep);
                 kernelBuildScaleSpace.setArg(12, stepOffset);
 
-                _gpuComputeModule->queue().asyncRunKernel(kernelBuildScaleSpace);
+                profile(_gpuComputeModule->queue().asyncRunKernel(kernelBuildScaleSpace));
             }
         }
     }
@@ -536,7 +538,7 @@ protected:
                 kernelFindScaleSpaceMaxima.setArg(11, _keypointsCount_cl);        // keypointsCount
                 kernelFindScaleSpaceMaxima.setArg(12, _keypoints_cl);             // keypoints
 
-                _gpuComputeModule->queue().asyncRunKernel(kernelFindScaleSpaceMaxima);
+                profile(_gpuComputeModule->queue().asyncRunKernel(kernelFindScaleSpaceMaxima));
             }
         }
     }
@@ -553,7 +555,7 @@ protected:
         kernelFindKeypointOrientation.setArg(1, _keypoints_cl);
         kernelFindKeypointOrientation.setArg(2, _samplesCoords_cl);
         kernelFindKeypointOrientation.setArg(3, _gaussianWeights_cl);
-        _gpuComputeModule->queue().asyncRunKernel(kernelFindKeypointOrientation);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelFindKeypointOrientation));
     }
 
     void uprightKeypointOrientation(int keypointsCount)
@@ -566,7 +568,7 @@ protected:
         kernelUprightKeypointOrientation.setRoundedGlobalWorkSize(keypointsCount);
         kernelUprightKeypointOrientation.setArg(0, _keypoints_cl);
         kernelUprightKeypointOrientation.setArg(1, keypointsCount);
-        _gpuComputeModule->queue().asyncRunKernel(kernelUprightKeypointOrientation);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelUprightKeypointOrientation));
     }
 
     void calculateDescriptors(int keypointsCount) 
@@ -591,7 +593,7 @@ protected:
             kernelCalculateDescriptorsMSurf.setArg(0, _imageIntegral_cl);
             kernelCalculateDescriptorsMSurf.setArg(1, _keypoints_cl);
             kernelCalculateDescriptorsMSurf.setArg(2, _descriptors_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelCalculateDescriptorsMSurf);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelCalculateDescriptorsMSurf));
         }
         else
         {
@@ -601,7 +603,7 @@ protected:
             kernelCalculateDescriptors.setArg(0, _imageIntegral_cl);
             kernelCalculateDescriptors.setArg(1, _keypoints_cl);
             kernelCalculateDescriptors.setArg(2, _descriptors_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelCalculateDescriptors);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelCalculateDescriptors));
         }
 
         clw::Kernel kernelNormalizeDescriptors = _gpuComputeModule->acquireKernel(_kidNormalizeDescriptors);
@@ -609,14 +611,14 @@ protected:
         kernelNormalizeDescriptors.setLocalWorkSize(64);
         kernelNormalizeDescriptors.setGlobalWorkSize(keypointsCount * 64);
         kernelNormalizeDescriptors.setArg(0, _descriptors_cl);
-        _gpuComputeModule->queue().asyncRunKernel(kernelNormalizeDescriptors);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelNormalizeDescriptors));
     }
 
     vector<KeyPoint> downloadKeypoints(int keypointsCount) 
     {
         vector<KeyPoint> kps(keypointsCount);
-        _gpuComputeModule->queue().asyncCopyBuffer(_keypoints_cl, _pinnedKeypoints_cl);
-        float* ptrBase = (float*) _gpuComputeModule->queue().mapBuffer(_pinnedKeypoints_cl, clw::EMapAccess::Read);
+        profile(_gpuComputeModule->queue().asyncCopyBuffer(_keypoints_cl, _pinnedKeypoints_cl));
+        float* ptrBase = (float*) mapBuffer(_pinnedKeypoints_cl, clw::EMapAccess::Read);
         if(!ptrBase)
             return kps;
 
@@ -644,7 +646,7 @@ protected:
         for(int i = 0; i < keypointsCount; ++i)
             kps[i].orientation = *ptr++;
 
-        _gpuComputeModule->queue().asyncUnmap(_pinnedKeypoints_cl, ptrBase);
+        profile(_gpuComputeModule->queue().asyncUnmap(_pinnedKeypoints_cl, ptrBase));
 
         return kps;
     }
@@ -739,7 +741,7 @@ protected:
             kernelFillImage.setRoundedGlobalWorkSize(imageWidth+1,imageHeight+1);
             kernelFillImage.setArg(0, _imageIntegral_cl);
             kernelFillImage.setArg(1, 0);
-            _gpuComputeModule->queue().asyncRunKernel(kernelFillImage);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelFillImage));
         }
 
         if(_gpuComputeModule->device().deviceType() != clw::EDeviceType::Cpu)
@@ -751,22 +753,22 @@ protected:
             kernelMultiScan_horiz.setRoundedGlobalWorkSize(256,imageHeight);
             kernelMultiScan_horiz.setArg(0, srcImage_cl);
             kernelMultiScan_horiz.setArg(1, _tempImage_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_horiz);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_horiz));
 
             kernelMultiScan_vert.setLocalWorkSize(256,1);
             kernelMultiScan_vert.setRoundedGlobalWorkSize(256,imageWidth);
             kernelMultiScan_vert.setArg(0, _tempImage_cl);
             kernelMultiScan_vert.setArg(1, _imageIntegral_cl);
-            _gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_vert);
-            _gpuComputeModule->queue().asyncCopyImageToBuffer(_imageIntegral_cl, _imageIntegralBuffer_cl);
+            profile(_gpuComputeModule->queue().asyncRunKernel(kernelMultiScan_vert));
+            profile(_gpuComputeModule->queue().asyncCopyImageToBuffer(_imageIntegral_cl, _imageIntegralBuffer_cl));
         }
         else
         {
             cv::Mat srcHost(imageHeight, imageWidth, CV_8UC1), integralHost;
-            _gpuComputeModule->queue().readImage2D(srcImage_cl, srcHost.data, static_cast<int>(srcHost.step));
+            readImage2D(srcImage_cl, srcHost.data, static_cast<int>(srcHost.step));
             cv::integral(srcHost, integralHost);
-            _gpuComputeModule->queue().writeImage2D(_imageIntegral_cl, integralHost.data, static_cast<int>(integralHost.step));
-            _gpuComputeModule->queue().asyncCopyImageToBuffer(_imageIntegral_cl, _imageIntegralBuffer_cl);
+            writeImage2D(_imageIntegral_cl, integralHost.data, static_cast<int>(integralHost.step));
+            profile(_gpuComputeModule->queue().asyncCopyImageToBuffer(_imageIntegral_cl, _imageIntegralBuffer_cl));
         }
     }
 
@@ -829,7 +831,7 @@ protected:
                 kernelBuildScaleSpace.setArg(12, layer.sampleStep);
                 kernelBuildScaleSpace.setArg(13, stepOffset);
 
-                _gpuComputeModule->queue().asyncRunKernel(kernelBuildScaleSpace);
+                profile(_gpuComputeModule->queue().asyncRunKernel(kernelBuildScaleSpace));
             }
         }
     }
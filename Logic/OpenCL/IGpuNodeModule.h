@@ -67,8 +67,19 @@ struct GpuRegisteredProgram
     std::vector<Build> builds;
 };
 
+struct GpuProgramBuildInfo
+{
+    std::string programName;
+    std::string options;
+    bool built;
+    double elapsed; // [ms]
+    std::string log;
+};
+
 using OnCreateInteractive = std::function<
     GpuInteractiveResult(const std::vector<GpuPlatform>& gpuPlatforms)>;
+using OnProgramBuilt = std::function<
+    void(const GpuProgramBuildInfo& buildInfo, size_t builtCount, size_t totalCount)>;
 
 class LOGIC_EXPORT IGpuNodeModule : public NodeModule
 {
@@ -84,6 +95,17 @@ public:
 
     virtual std::vector<GpuRegisteredProgram> populateListOfRegisteredPrograms() const = 0;
     virtual void rebuildProgram(const std::string& programName) = 0;
+
+    // Enables profiling of command queues so GPU nodes report time spent on 
+    // the device. Queues are recreated if the module is already initialized
+    virtual void setProfilingEnabled(bool enable) = 0;
+    virtual bool isProfilingEnabled() const = 0;
+
+    // Builds every registered program that hasn't been built yet so first
+    // execution of a loaded tree doesn't stall on kernels compilation.
+    // Failed builds are reported (and rethrown later on kernel acquire)
+    virtual std::vector<GpuProgramBuildInfo> warmUp(bool parallel = true,
+        const OnProgramBuilt& onProgramBuilt = OnProgramBuilt()) = 0;
 };
 
 LOGIC_EXPORT std::unique_ptr<IGpuNodeModule> createGpuModule();
\ No newline at end of file
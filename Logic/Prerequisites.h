@@ -86,6 +86,8 @@ class NodeModule;
 class NodePlugin;
 class NodeTreeSerializer;
 class NodeResolver;
+class NodeProfiler;
+class ImageBufferPool;
 
 struct NodeLink;
 struct SocketAddress;
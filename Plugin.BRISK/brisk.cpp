@@ -42,8 +42,12 @@
 #include <fstream>
 #include <stdlib.h>
 #include <tmmintrin.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 #include "brisk.h"
+#include "Logic/Nodes/CV.h"
 #include "agast/oast9_16.h"
 #include "agast/agast7_12s.h"
 #include "agast/agast5_8.h"
@@ -156,6 +160,25 @@ void BriskDescriptorExtractor::generateKernel(std::vector<float> &radiusList,
 		}
 	}
 
+	// integer normalization of the box filter - depends on sigma only
+	boxScaling_=new int[scales_*points_];
+	boxScaling2_=new int[scales_*points_];
+	for(unsigned int scale = 0; scale <scales_; ++scale){
+		for(unsigned int point = 0; point<points_; ++point){
+			const float sigma_half=patternPoints_[scale*n_rot_*points_+point].sigma;
+			const float area=4.0*sigma_half*sigma_half;
+			int& scaling=boxScaling_[scale*points_+point];
+			int& scaling2=boxScaling2_[scale*points_+point];
+			if(sigma_half<0.5){
+				// interpolated, not needed
+				scaling=scaling2=0;
+				continue;
+			}
+			scaling = 4194304.0/area;
+			scaling2=float(scaling)*area/1024.0;
+		}
+	}
+
 	// now also generate pairings
 	shortPairs_ = new BriskShortPair[points_*(points_-1)/2];
 	longPairs_ = new BriskLongPair[points_*(points_-1)/2];
@@ -219,7 +242,6 @@ __inline__ int BriskDescriptorExtractor::smoothedIntensity(const cv::Mat& image,
 
 	// get the sigma:
 	const float sigma_half=briskPoint.sigma;
-	const float area=4.0*sigma_half*sigma_half;
 
 	// calculate output:
 	int ret_val;
@@ -244,8 +266,8 @@ __inline__ int BriskDescriptorExtractor::smoothedIntensity(const cv::Mat& image,
 	// this is the standard case (simple, not speed optimized yet):
 
 	// scaling:
-	const int scaling = 4194304.0/area;
-	const int scaling2=float(scaling)*area/1024.0;
+	const int scaling = boxScaling_[scale*points_ + point];
+	const int scaling2= boxScaling2_[scale*points_ + point];
 
 	// the integral image is larger:
 	const int integralcols=imagecols+1;
@@ -360,6 +382,240 @@ __inline__ int BriskDescriptorExtractor::smoothedIntensity(const cv::Mat& image,
 	return (ret_val+scaling2/2)/scaling2;
 }
 
+#ifdef __AVX2__
+// int(v+0.5) for non-negative v without the rounding of a float addition
+static inline __m256i roundHalfUp_avx2(const __m256 v){
+	const __m256i t=_mm256_cvttps_epi32(v);
+	const __m256 frac=_mm256_sub_ps(v,_mm256_cvtepi32_ps(t));
+	// comparison mask is -1 where the fraction rounds up
+	return _mm256_sub_epi32(t,_mm256_castps_si256(_mm256_cmp_ps(frac,_mm256_set1_ps(0.5f),_CMP_GE_OQ)));
+}
+
+// exact integer division through double precision (operands fit in 32 bits)
+static inline __m256i divide_avx2(const __m256i a, const __m256i b){
+	const __m128i lo=_mm256_cvttpd_epi32(_mm256_div_pd(
+			_mm256_cvtepi32_pd(_mm256_castsi256_si128(a)),_mm256_cvtepi32_pd(_mm256_castsi256_si128(b))));
+	const __m128i hi=_mm256_cvttpd_epi32(_mm256_div_pd(
+			_mm256_cvtepi32_pd(_mm256_extracti128_si256(a,1)),_mm256_cvtepi32_pd(_mm256_extracti128_si256(b,1))));
+	return _mm256_inserti128_si256(_mm256_castsi128_si256(lo),hi,1);
+}
+
+static inline int horizontalSum_avx2(const __m256i v){
+	__m128i s=_mm_add_epi32(_mm256_castsi256_si128(v),_mm256_extracti128_si256(v,1));
+	s=_mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(1,0,3,2)));
+	s=_mm_add_epi32(s,_mm_shuffle_epi32(s,_MM_SHUFFLE(2,3,0,1)));
+	return _mm_cvtsi128_si32(s);
+}
+#endif
+
+// all pattern points at once - the AVX2 version samples 8 points per step
+void BriskDescriptorExtractor::smoothedIntensities(const cv::Mat& image,
+		const cv::Mat& integral,const float key_x,
+			const float key_y, const unsigned int scale,
+			const unsigned int rot, int* values) const{
+#ifdef __AVX2__
+	// this is the box filter case of smoothedIntensity with the same
+	// arithmetic (so the same results); lanes needing interpolation or
+	// the small box loop are redone with the scalar version
+	const float* pattern=(const float*)(patternPoints_+scale*n_rot_*points_+rot*points_);
+	const int* scaling=boxScaling_+scale*points_;
+	const int* scaling2=boxScaling2_+scale*points_;
+	const int imagecols=image.cols;
+	const int integralcols=imagecols+1;
+	// gathers read 4 bytes ending at the wanted pixel (keypoints are away from the border)
+	const int* image_data=(const int*)(image.data-3);
+	const int* integral_data=(const int*)integral.data;
+
+	const __m256i lanes=_mm256_setr_epi32(0,1,2,3,4,5,6,7);
+	const __m256i last=_mm256_set1_epi32(points_-1);
+	const __m256i stride=_mm256_set1_epi32(sizeof(BriskPatternPoint)/sizeof(float));
+	const __m256i one=_mm256_set1_epi32(1);
+	const __m256i three=_mm256_set1_epi32(3);
+	const __m256i cols=_mm256_set1_epi32(imagecols);
+	const __m256i icols=_mm256_set1_epi32(integralcols);
+	const __m256 half=_mm256_set1_ps(0.5f);
+	const __m256 kx=_mm256_set1_ps(key_x);
+	const __m256 ky=_mm256_set1_ps(key_y);
+
+	for(unsigned int k=0; k<points_; k+=8){
+		// the tail repeats the last point
+		const __m256i point=_mm256_min_epi32(_mm256_add_epi32(_mm256_set1_epi32(k),lanes),last);
+		const __m256i offset=_mm256_mullo_epi32(point,stride);
+		const __m256 xf=_mm256_add_ps(_mm256_i32gather_ps(pattern,offset,4),kx);
+		const __m256 yf=_mm256_add_ps(_mm256_i32gather_ps(pattern+1,offset,4),ky);
+		const __m256 sigma_half=_mm256_i32gather_ps(pattern+2,offset,4);
+		const __m256i scaling_i=_mm256_i32gather_epi32(scaling,point,4);
+		const __m256i scaling2_i=_mm256_i32gather_epi32(scaling2,point,4);
+		const __m256 scaling_f=_mm256_cvtepi32_ps(scaling_i);
+
+		// calculate borders
+		const __m256 x_1=_mm256_sub_ps(xf,sigma_half);
+		const __m256 x1=_mm256_add_ps(xf,sigma_half);
+		const __m256 y_1=_mm256_sub_ps(yf,sigma_half);
+		const __m256 y1=_mm256_add_ps(yf,sigma_half);
+		const __m256i x_left=roundHalfUp_avx2(x_1);
+		const __m256i y_top=roundHalfUp_avx2(y_1);
+		const __m256i x_right=roundHalfUp_avx2(x1);
+		const __m256i y_bottom=roundHalfUp_avx2(y1);
+
+		// overlap area - multiplication factors:
+		const __m256 r_x_1=_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(x_left),x_1),half);
+		const __m256 r_y_1=_mm256_add_ps(_mm256_sub_ps(_mm256_cvtepi32_ps(y_top),y_1),half);
+		const __m256 r_x1=_mm256_add_ps(_mm256_sub_ps(x1,_mm256_cvtepi32_ps(x_right)),half);
+		const __m256 r_y1=_mm256_add_ps(_mm256_sub_ps(y1,_mm256_cvtepi32_ps(y_bottom)),half);
+		const __m256i dx=_mm256_sub_epi32(_mm256_sub_epi32(x_right,x_left),one);
+		const __m256i dy=_mm256_sub_epi32(_mm256_sub_epi32(y_bottom,y_top),one);
+		const __m256i A=_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(r_x_1,r_y_1),scaling_f));
+		const __m256i B=_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(r_x1,r_y_1),scaling_f));
+		const __m256i C=_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(r_x1,r_y1),scaling_f));
+		const __m256i D=_mm256_cvttps_epi32(_mm256_mul_ps(_mm256_mul_ps(r_x_1,r_y1),scaling_f));
+		const __m256i r_x_1_i=_mm256_cvttps_epi32(_mm256_mul_ps(r_x_1,scaling_f));
+		const __m256i r_y_1_i=_mm256_cvttps_epi32(_mm256_mul_ps(r_y_1,scaling_f));
+		const __m256i r_x1_i=_mm256_cvttps_epi32(_mm256_mul_ps(r_x1,scaling_f));
+		const __m256i r_y1_i=_mm256_cvttps_epi32(_mm256_mul_ps(r_y1,scaling_f));
+
+		// first the corners (same path as the scalar version):
+		const __m256i dx1=_mm256_add_epi32(dx,one);
+		const __m256i p0=_mm256_add_epi32(x_left,_mm256_mullo_epi32(y_top,cols));
+		const __m256i p1=_mm256_add_epi32(p0,dx1);
+		const __m256i p2=_mm256_add_epi32(p1,_mm256_add_epi32(_mm256_mullo_epi32(dy,cols),one));
+		const __m256i p3=_mm256_sub_epi32(p2,dx1);
+		__m256i ret_val=_mm256_mullo_epi32(A,_mm256_srli_epi32(_mm256_i32gather_epi32(image_data,p0,1),24));
+		ret_val=_mm256_add_epi32(ret_val,_mm256_mullo_epi32(B,_mm256_srli_epi32(_mm256_i32gather_epi32(image_data,p1,1),24)));
+		ret_val=_mm256_add_epi32(ret_val,_mm256_mullo_epi32(C,_mm256_srli_epi32(_mm256_i32gather_epi32(image_data,p2,1),24)));
+		ret_val=_mm256_add_epi32(ret_val,_mm256_mullo_epi32(D,_mm256_srli_epi32(_mm256_i32gather_epi32(image_data,p3,1),24)));
+
+		// next the edges:
+		const __m256i dyi=_mm256_mullo_epi32(dy,icols);
+		const __m256i i1=_mm256_add_epi32(_mm256_add_epi32(x_left,_mm256_mullo_epi32(y_top,icols)),one);
+		const __m256i i2=_mm256_add_epi32(i1,dx);
+		const __m256i i3=_mm256_add_epi32(i2,icols);
+		const __m256i i4=_mm256_add_epi32(i3,one);
+		const __m256i i5=_mm256_add_epi32(i4,dyi);
+		const __m256i i6=_mm256_sub_epi32(i5,one);
+		const __m256i i7=_mm256_add_epi32(i6,icols);
+		const __m256i i8=_mm256_sub_epi32(i7,dx);
+		const __m256i i9=_mm256_sub_epi32(i8,icols);
+		const __m256i i10=_mm256_sub_epi32(i9,one);
+		const __m256i i11=_mm256_sub_epi32(i10,dyi);
+		const __m256i i12=_mm256_add_epi32(i11,one);
+		const __m256i tmp1=_mm256_i32gather_epi32(integral_data,i1,4);
+		const __m256i tmp2=_mm256_i32gather_epi32(integral_data,i2,4);
+		const __m256i tmp3=_mm256_i32gather_epi32(integral_data,i3,4);
+		const __m256i tmp4=_mm256_i32gather_epi32(integral_data,i4,4);
+		const __m256i tmp5=_mm256_i32gather_epi32(integral_data,i5,4);
+		const __m256i tmp6=_mm256_i32gather_epi32(integral_data,i6,4);
+		const __m256i tmp7=_mm256_i32gather_epi32(integral_data,i7,4);
+		const __m256i tmp8=_mm256_i32gather_epi32(integral_data,i8,4);
+		const __m256i tmp9=_mm256_i32gather_epi32(integral_data,i9,4);
+		const __m256i tmp10=_mm256_i32gather_epi32(integral_data,i10,4);
+		const __m256i tmp11=_mm256_i32gather_epi32(integral_data,i11,4);
+		const __m256i tmp12=_mm256_i32gather_epi32(integral_data,i12,4);
+
+		// assign the weighted surface integrals:
+		const __m256i upper=_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp3,tmp2),tmp1),tmp12),r_y_1_i);
+		const __m256i middle=_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp6,tmp3),tmp12),tmp9),scaling_i);
+		const __m256i left=_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp9,tmp12),tmp11),tmp10),r_x_1_i);
+		const __m256i right=_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp5,tmp4),tmp3),tmp6),r_x1_i);
+		const __m256i bottom=_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp7,tmp6),tmp9),tmp8),r_y1_i);
+		ret_val=_mm256_add_epi32(ret_val,_mm256_add_epi32(upper,middle));
+		ret_val=_mm256_add_epi32(ret_val,_mm256_add_epi32(left,right));
+		ret_val=_mm256_add_epi32(ret_val,_mm256_add_epi32(bottom,_mm256_srli_epi32(scaling2_i,1)));
+		_mm256_storeu_si256((__m256i*)(values+k),divide_avx2(ret_val,scaling2_i));
+
+		// lanes not covered: sigma_half<0.5 or dx+dy<=2
+		const __m256i scalar=_mm256_or_si256(
+				_mm256_castps_si256(_mm256_cmp_ps(sigma_half,half,_CMP_LT_OQ)),
+				_mm256_cmpgt_epi32(three,_mm256_add_epi32(dx,dy)));
+		const int mask=_mm256_movemask_ps(_mm256_castsi256_ps(scalar));
+		if(mask){
+			for(unsigned int i = 0; i<8 && k+i<points_; i++){
+				if(mask&(1<<i))
+					values[k+i]=smoothedIntensity(image, integral, key_x, key_y, scale, rot, k+i);
+			}
+		}
+	}
+#else
+	for(unsigned int i = 0; i<points_; i++){
+		values[i]=smoothedIntensity(image, integral, key_x, key_y, scale, rot, i);
+	}
+#endif
+}
+
+void BriskDescriptorExtractor::longPairsDirection(const int* values,
+		int& direction0, int& direction1) const{
+	direction0=0;
+	direction1=0;
+	unsigned int k=0;
+#ifdef __AVX2__
+	// gather 8 pairings at once, delta*weight/1024 rounds towards zero as before
+	const __m256i stride=_mm256_setr_epi32(0,4,8,12,16,20,24,28);
+	const __m256i round=_mm256_set1_epi32(1023);
+	__m256i dir0=_mm256_setzero_si256();
+	__m256i dir1=_mm256_setzero_si256();
+	for(; k+8<=noLongPairs_; k+=8){
+		const int* pairs=(const int*)(longPairs_+k);
+		const __m256i i=_mm256_i32gather_epi32(pairs,stride,4);
+		const __m256i j=_mm256_i32gather_epi32(pairs+1,stride,4);
+		const __m256i delta_t=_mm256_sub_epi32(_mm256_i32gather_epi32(values,i,4),
+				_mm256_i32gather_epi32(values,j,4));
+		const __m256i t0=_mm256_mullo_epi32(delta_t,_mm256_i32gather_epi32(pairs+2,stride,4));
+		const __m256i t1=_mm256_mullo_epi32(delta_t,_mm256_i32gather_epi32(pairs+3,stride,4));
+		dir0=_mm256_add_epi32(dir0,_mm256_srai_epi32(_mm256_add_epi32(t0,
+				_mm256_and_si256(_mm256_srai_epi32(t0,31),round)),10));
+		dir1=_mm256_add_epi32(dir1,_mm256_srai_epi32(_mm256_add_epi32(t1,
+				_mm256_and_si256(_mm256_srai_epi32(t1,31),round)),10));
+	}
+	direction0=horizontalSum_avx2(dir0);
+	direction1=horizontalSum_avx2(dir1);
+#endif
+	const BriskLongPair* max=longPairs_+noLongPairs_;
+	for(const BriskLongPair* iter=longPairs_+k; iter<max; ++iter){
+		const int delta_t=(values[iter->i]-values[iter->j]);
+		// update the direction:
+		const int tmp0=delta_t*(iter->weighted_dx)/1024;
+		const int tmp1=delta_t*(iter->weighted_dy)/1024;
+		direction0+=tmp0;
+		direction1+=tmp1;
+	}
+}
+
+void BriskDescriptorExtractor::shortPairsBits(const int* values, uchar* descriptor) const{
+	UINT32_ALIAS* ptr2=(UINT32_ALIAS*)descriptor;
+	unsigned int k=0;
+#ifdef __AVX2__
+	// 32 comparisons per step, packed with movemask
+	const __m256i deinterleave=_mm256_setr_epi32(0,2,4,6,1,3,5,7);
+	for(; k+32<=noShortPairs_; k+=32){
+		unsigned int bits=0;
+		for(int b=0; b<4; b++){
+			const __m256i* pairs=(const __m256i*)(shortPairs_+k+8*b);
+			const __m256i lo=_mm256_permutevar8x32_epi32(_mm256_loadu_si256(pairs),deinterleave);
+			const __m256i hi=_mm256_permutevar8x32_epi32(_mm256_loadu_si256(pairs+1),deinterleave);
+			const __m256i i=_mm256_permute2x128_si256(lo,hi,0x20);
+			const __m256i j=_mm256_permute2x128_si256(lo,hi,0x31);
+			const __m256i gt=_mm256_cmpgt_epi32(_mm256_i32gather_epi32(values,i,4),
+					_mm256_i32gather_epi32(values,j,4));
+			bits|=(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(gt))<<(8*b);
+		}
+		*(ptr2++)=bits;
+	}
+#endif
+	int shifter=0;
+	const BriskShortPair* max=shortPairs_+noShortPairs_;
+	for(const BriskShortPair* iter=shortPairs_+k; iter<max;++iter){
+		if(values[iter->i]>values[iter->j]){
+			*ptr2|=((1)<<shifter);
+		} // else already initialized with zero
+		// take care of the iterators:
+		++shifter;
+		if(shifter==32){
+			shifter=0;
+			++ptr2;
+		}
+	}
+}
+
 bool RoiPredicate(const float minX, const float minY,
 		const float maxX, const float maxY, const KeyPoint& keyPt){
 	const Point2f& pt = keyPt.pt;
@@ -376,94 +632,69 @@ void BriskDescriptorExtractor::computeImpl(const Mat& image,
 	kscales.resize(ksize);
 	static const float log2 = 0.693147180559945;
 	static const float lb_scalerange = log(scalerange_)/(log2);
-	std::vector<cv::KeyPoint>::iterator beginning = keypoints.begin();
-	std::vector<int>::iterator beginningkscales = kscales.begin();
 	static const float basicSize06=basicSize_*0.6;
 	unsigned int basicscale=0;
 	if(!scaleInvariance)
 		basicscale=std::max((int)(scales_/lb_scalerange*(log(1.45*basicSize_/(basicSize06))/log2)+0.5),0);
+	// keep order of remaining keypoints (in-place compaction)
+	size_t kept=0;
 	for(size_t k=0; k<ksize; k++){
 		unsigned int scale;
 		if(scaleInvariance){
 			scale=std::max((int)(scales_/lb_scalerange*(log(keypoints[k].size/(basicSize06))/log2)+0.5),0);
 			// saturate
 			if(scale>=scales_) scale = scales_-1;
-			kscales[k]=scale;
 		}
 		else{
 			scale = basicscale;
-			kscales[k]=scale;
 		}
 		const int border = sizeList_[scale];
 		const int border_x=image.cols-border;
 		const int border_y=image.rows-border;
-		if(RoiPredicate(border, border,border_x,border_y,keypoints[k])){
-			keypoints.erase(beginning+k);
-			kscales.erase(beginningkscales+k);
-			if(k==0){
-				beginning=keypoints.begin();
-				beginningkscales = kscales.begin();
-			}
-			ksize--;
-			k--;
+		if(!RoiPredicate(border, border,border_x,border_y,keypoints[k])){
+			keypoints[kept]=keypoints[k];
+			kscales[kept]=scale;
+			kept++;
 		}
 	}
+	ksize=kept;
+	keypoints.resize(ksize);
+	kscales.resize(ksize);
 
 	// first, calculate the integral image over the whole image:
 	// current integral image
 	cv::Mat _integral; // the integral image
 	cv::integral(image, _integral);
 
-	int* _values=new int[points_]; // for temporary use
-
 	// resize the descriptors:
 	descriptors=cv::Mat::zeros(ksize,strings_, CV_8U);
 
-	// now do the extraction for all keypoints:
-
-	// temporary variables containing gray values at sample points:
-	int t1;
-	int t2;
-
-	// the feature orientation
-	int direction0;
-	int direction1;
-
-	uchar* ptr = descriptors.data;
-	for(size_t k=0; k<ksize; k++){
-		int theta;
-		cv::KeyPoint& kp=keypoints[k];
-		const int& scale=kscales[k];
-		int shifter=0;
-		int* pvalues =_values;
-		const float& x=kp.pt.x;
-		const float& y=kp.pt.y;
-		if(true/*kp.angle==-1*/){
+	// now do the extraction for all keypoints - each one is independent
+	// and writes only its own descriptor row
+	cvu::parallel_for(cv::Range(0, (int)ksize), [&](const cv::Range& range){
+		std::vector<int> values((points_+7)&~7u); // for temporary use
+
+		// the feature orientation
+		int direction0;
+		int direction1;
+
+		for(int k=range.start; k<range.end; k++){
+			int theta;
+			cv::KeyPoint& kp=keypoints[k];
+			const int& scale=kscales[k];
+			int* _values=&values[0];
+			const float& x=kp.pt.x;
+			const float& y=kp.pt.y;
 			if (!rotationInvariance){
 				// don't compute the gradient direction, just assign a rotation of 0°
 				theta=0;
 			}
 			else{
 				// get the gray values in the unrotated pattern
-				for(unsigned int i = 0; i<points_; i++){
-					*(pvalues++)=smoothedIntensity(image, _integral, x,
-							y, scale, 0, i);
-				}
+				smoothedIntensities(image, _integral, x, y, scale, 0, _values);
 
-				direction0=0;
-				direction1=0;
 				// now iterate through the long pairings
-				const BriskLongPair* max=longPairs_+noLongPairs_;
-				for(BriskLongPair* iter=longPairs_; iter<max; ++iter){
-					t1=*(_values+iter->i);
-					t2=*(_values+iter->j);
-					const int delta_t=(t1-t2);
-					// update the direction:
-					const int tmp0=delta_t*(iter->weighted_dx)/1024;
-					const int tmp1=delta_t*(iter->weighted_dy)/1024;
-					direction0+=tmp0;
-					direction1+=tmp1;
-				}
+				longPairsDirection(_values, direction0, direction1);
 				kp.angle=atan2((float)direction1,(float)direction0)/M_PI*180.0;
 				theta=int((n_rot_*kp.angle)/(360.0)+0.5);
 				if(theta<0)
@@ -471,58 +702,18 @@ void BriskDescriptorExtractor::computeImpl(const Mat& image,
 				if(theta>=int(n_rot_))
 					theta-=n_rot_;
 			}
-		}
-		else{
-			// figure out the direction:
-			//int theta=rotationInvariance*round((_n_rot*atan2(direction.at<int>(0,0),direction.at<int>(1,0)))/(2*M_PI));
-			if(!rotationInvariance){
-				theta=0;
-			}
-			else{
-				theta=(int)(n_rot_*(kp.angle/(360.0))+0.5);
-				if(theta<0)
-					theta+=n_rot_;
-				if(theta>=int(n_rot_))
-					theta-=n_rot_;
-			}
-		}
 
-		// now also extract the stuff for the actual direction:
-		// let us compute the smoothed values
-		shifter=0;
+			// now also extract the stuff for the actual direction:
+			// get the gray values in the rotated pattern
+			smoothedIntensities(image, _integral, x, y, scale, theta, _values);
 
-		//unsigned int mean=0;
-		pvalues =_values;
-		// get the gray values in the rotated pattern
-		for(unsigned int i = 0; i<points_; i++){
-			*(pvalues++)=smoothedIntensity(image, _integral, x,
-					y, scale, theta, i);
-		}
-
-		// now iterate through all the pairings
-		UINT32_ALIAS* ptr2=(UINT32_ALIAS*)ptr;
-		const BriskShortPair* max=shortPairs_+noShortPairs_;
-		for(BriskShortPair* iter=shortPairs_; iter<max;++iter){
-			t1=*(_values+iter->i);
-			t2=*(_values+iter->j);
-			if(t1>t2){
-				*ptr2|=((1)<<shifter);
-
-			} // else already initialized with zero
-			// take care of the iterators:
-			++shifter;
-			if(shifter==32){
-				shifter=0;
-				++ptr2;
-			}
+			// now iterate through all the pairings
+			shortPairsBits(_values, descriptors.ptr<uchar>(k));
 		}
-
-		ptr+=strings_;
-	}
+	});
 
 	// clean-up
 	_integral.release();
-	delete [] _values;
 }
 
 int BriskDescriptorExtractor::descriptorSize() const{
@@ -539,6 +730,8 @@ BriskDescriptorExtractor::~BriskDescriptorExtractor(){
 	delete [] longPairs_;
 	delete [] scaleList_;
 	delete [] sizeList_;
+	delete [] boxScaling_;
+	delete [] boxScaling2_;
 }
 
 BriskFeatureDetector::BriskFeatureDetector(int thresh, int octaves){
@@ -581,9 +774,19 @@ void BriskScaleSpace::constructPyramid(const cv::Mat& image){
 	}
 	const int octaves2=layers_;
 
-	for(uint8_t i=2; i<octaves2; i+=2){
-		pyramid_.push_back(BriskLayer(pyramid_[i-2],BriskLayer::CommonParams::HALFSAMPLE));
-		pyramid_.push_back(BriskLayer(pyramid_[i-1],BriskLayer::CommonParams::HALFSAMPLE));
+	// octaves and intra-octaves are halfsampled independently
+	std::vector<BriskLayer> chains[2];
+	cvu::parallel_for(cv::Range(0, 2), [&](const cv::Range& range){
+		for(int c=range.start; c<range.end; c++){
+			for(int i=2+c; i<octaves2; i+=2){
+				const BriskLayer& below=chains[c].empty() ? pyramid_[c] : chains[c].back();
+				chains[c].push_back(BriskLayer(below,BriskLayer::CommonParams::HALFSAMPLE));
+			}
+		}
+	});
+	for(size_t k=0; k<chains[0].size(); k++){
+		pyramid_.push_back(chains[0][k]);
+		pyramid_.push_back(chains[1][k]);
 	}
 }
 
@@ -598,12 +801,15 @@ void BriskScaleSpace::getKeypoints(const uint8_t _threshold, std::vector<cv::Key
 	std::vector<std::vector<CvPoint> > agastPoints;
 	agastPoints.resize(layers_);
 
-	// go through the octaves and intra layers and calculate fast corner scores:
-	for(uint8_t i = 0; i<layers_; i++){
-		// call OAST16_9 without nms
-		BriskLayer& l=pyramid_[i];
-		l.getAgastPoints(safeThreshold_,agastPoints[i]);
-	}
+	// go through the octaves and intra layers and calculate fast corner scores
+	// (every layer has its own detector and scores):
+	cvu::parallel_for(cv::Range(0, layers_), [&](const cv::Range& range){
+		for(int i = range.start; i<range.end; i++){
+			// call OAST16_9 without nms
+			BriskLayer& l=pyramid_[i];
+			l.getAgastPoints(safeThreshold_,agastPoints[i]);
+		}
+	});
 
 	if(layers_==1){
 		// just do a simple 2d subpixel refinement...
@@ -638,66 +844,75 @@ void BriskScaleSpace::getKeypoints(const uint8_t _threshold, std::vector<cv::Key
 		return;
 	}
 
+	// Non-max suppression of a layer reads and lazily computes scores of
+	// adjacent layers which in turn affect later decisions, so it runs in
+	// layer order to keep keypoints the same as the serial detector.
+	for(uint8_t i = 0; i<layers_; i++)
+		getLayerKeypoints(i, agastPoints[i], keypoints);
+}
+
+// non-max suppression and refinement of keypoints of a single layer:
+void BriskScaleSpace::getLayerKeypoints(const uint8_t i,
+		const std::vector<CvPoint>& agastPoints,
+		std::vector<cv::KeyPoint>& keypoints){
 	float x,y,scale,score;
-	for(uint8_t i = 0; i<layers_; i++){
-		cv::BriskLayer& l=pyramid_[i];
-		const int num=agastPoints[i].size();
-		if(i==layers_-1){
-			for(int n=0; n < num; n++){
-				const CvPoint& point=agastPoints.at(i)[n];
-				// consider only 2D maxima...
-				if (!isMax2D(i, point.x, point.y))
-					continue;
-
-				bool ismax;
-				float dx, dy;
-				getScoreMaxBelow(i, point.x, point.y,
-						l.getAgastScore(point.x,   point.y, safeThreshold_), ismax,
-						dx, dy);
-				if(!ismax)
-					continue;
-
-				// get the patch on this layer:
-				register int s_0_0 = l.getAgastScore(point.x-1, point.y-1, 1);
-				register int s_1_0 = l.getAgastScore(point.x,   point.y-1, 1);
-				register int s_2_0 = l.getAgastScore(point.x+1, point.y-1, 1);
-				register int s_2_1 = l.getAgastScore(point.x+1, point.y,   1);
-				register int s_1_1 = l.getAgastScore(point.x,   point.y,   1);
-				register int s_0_1 = l.getAgastScore(point.x-1, point.y,   1);
-				register int s_0_2 = l.getAgastScore(point.x-1, point.y+1, 1);
-				register int s_1_2 = l.getAgastScore(point.x,   point.y+1, 1);
-				register int s_2_2 = l.getAgastScore(point.x+1, point.y+1, 1);
-				float delta_x, delta_y;
-				float max = subpixel2D(s_0_0, s_0_1, s_0_2,
-							s_1_0, s_1_1, s_1_2,
-							s_2_0, s_2_1, s_2_2,
-							delta_x, delta_y);
+	cv::BriskLayer& l=pyramid_[i];
+	const int num=agastPoints.size();
+	if(i==layers_-1){
+		for(int n=0; n < num; n++){
+			const CvPoint& point=agastPoints[n];
+			// consider only 2D maxima...
+			if (!isMax2D(i, point.x, point.y))
+				continue;
 
-				// store:
-				keypoints.push_back(cv::KeyPoint((float(point.x)+delta_x)*l.scale()+l.offset(),
-						(float(point.y)+delta_y)*l.scale()+l.offset(), basicSize_*l.scale(), -1, max,i));
-			}
+			bool ismax;
+			float dx, dy;
+			getScoreMaxBelow(i, point.x, point.y,
+					l.getAgastScore(point.x,   point.y, safeThreshold_), ismax,
+					dx, dy);
+			if(!ismax)
+				continue;
+
+			// get the patch on this layer:
+			register int s_0_0 = l.getAgastScore(point.x-1, point.y-1, 1);
+			register int s_1_0 = l.getAgastScore(point.x,   point.y-1, 1);
+			register int s_2_0 = l.getAgastScore(point.x+1, point.y-1, 1);
+			register int s_2_1 = l.getAgastScore(point.x+1, point.y,   1);
+			register int s_1_1 = l.getAgastScore(point.x,   point.y,   1);
+			register int s_0_1 = l.getAgastScore(point.x-1, point.y,   1);
+			register int s_0_2 = l.getAgastScore(point.x-1, point.y+1, 1);
+			register int s_1_2 = l.getAgastScore(point.x,   point.y+1, 1);
+			register int s_2_2 = l.getAgastScore(point.x+1, point.y+1, 1);
+			float delta_x, delta_y;
+			float max = subpixel2D(s_0_0, s_0_1, s_0_2,
+						s_1_0, s_1_1, s_1_2,
+						s_2_0, s_2_1, s_2_2,
+						delta_x, delta_y);
+
+			// store:
+			keypoints.push_back(cv::KeyPoint((float(point.x)+delta_x)*l.scale()+l.offset(),
+					(float(point.y)+delta_y)*l.scale()+l.offset(), basicSize_*l.scale(), -1, max,i));
 		}
-		else{
-			// not the last layer:
-			for(int n=0; n < num; n++){
-				const CvPoint& point=agastPoints.at(i)[n];
-
-				// first check if it is a maximum:
-				if (!isMax2D(i, point.x, point.y))
-					continue;
-
-				// let's do the subpixel and float scale refinement:
-				bool ismax;
-				score=refine3D(i,point.x, point.y,x,y,scale,ismax);
-				if(!ismax){
-					continue;
-				}
+	}
+	else{
+		// not the last layer:
+		for(int n=0; n < num; n++){
+			const CvPoint& point=agastPoints[n];
 
-				// finally store the detected keypoint:
-				if(score>float(threshold_)){
-					keypoints.push_back(cv::KeyPoint(x, y, basicSize_*scale, -1, score,i));
-				}
+			// first check if it is a maximum:
+			if (!isMax2D(i, point.x, point.y))
+				continue;
+
+			// let's do the subpixel and float scale refinement:
+			bool ismax;
+			score=refine3D(i,point.x, point.y,x,y,scale,ismax);
+			if(!ismax){
+				continue;
+			}
+
+			// finally store the detected keypoint:
+			if(score>float(threshold_)){
+				keypoints.push_back(cv::KeyPoint(x, y, basicSize_*scale, -1, score,i));
 			}
 		}
 	}
@@ -125,11 +125,22 @@ struct BriskLongPair{
 				const cv::Mat& integral,const float key_x,
 					const float key_y, const unsigned int scale,
 					const unsigned int rot, const unsigned int point) const;
+		// smoothed intensities of all pattern points (values padded to a multiple of 8)
+		void smoothedIntensities(const cv::Mat& image,
+				const cv::Mat& integral,const float key_x,
+					const float key_y, const unsigned int scale,
+					const unsigned int rot, int* values) const;
+		// gradient direction from the long pairs
+		void longPairsDirection(const int* values, int& direction0, int& direction1) const;
+		// descriptor bits from the short pairs (descriptor zero-initialized)
+		void shortPairsBits(const int* values, uchar* descriptor) const;
 		// pattern properties
 		BriskPatternPoint* patternPoints_; 	//[i][rotation][scale]
 		unsigned int points_; 				// total number of collocation points
 		float* scaleList_; 					// lists the scaling per scale index [scale]
 		unsigned int* sizeList_; 			// lists the total pattern size per scale index [scale]
+		int* boxScaling_;					// box filter normalization per [scale][point]
+		int* boxScaling2_;					// box filter divisor per [scale][point]
 		static const unsigned int scales_;	// scales discretization
 		static const float scalerange_; 	// span of sizes 40->4 Octaves - else, this needs to be adjusted...
 		static const unsigned int n_rot_;	// discretization of the rotation look-up
@@ -210,6 +221,10 @@ struct BriskLongPair{
 		void getKeypoints(const uint8_t _threshold, std::vector<cv::KeyPoint>& keypoints);
 
 	protected:
+		// nonmax suppression and refinement of a single layer (not the only one)
+		void getLayerKeypoints(const uint8_t layer,
+				const std::vector<CvPoint>& agastPoints,
+				std::vector<cv::KeyPoint>& keypoints);
 		// nonmax suppression:
 		__inline__ bool isMax2D(const uint8_t layer,
 				const int x_layer, const int y_layer);
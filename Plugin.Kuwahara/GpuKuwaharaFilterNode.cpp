@@ -78,7 +78,7 @@ public:
         kernelKuwahara.setArg(0, deviceSrc);
         kernelKuwahara.setArg(1, deviceDest);
         kernelKuwahara.setArg(2, (int) _radius);
-        _gpuComputeModule->queue().runKernel(kernelKuwahara);
+        runKernel(kernelKuwahara);
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -177,7 +177,7 @@ public:
         kernelKuwahara.setArg(1, deviceDest);
         kernelKuwahara.setArg(2, (int) _radius);
         kernelKuwahara.setArg(3, _kernelImage);
-        _gpuComputeModule->queue().runKernel(kernelKuwahara);
+        runKernel(kernelKuwahara);
 
         return ExecutionStatus(EStatus::Ok);
     }
@@ -294,7 +294,7 @@ public:
         kernelCalcStructureTensor.setRoundedGlobalWorkSize(clw::Grid(width, height));
         kernelCalcStructureTensor.setArg(0, deviceSrc);
         kernelCalcStructureTensor.setArg(1, _secondMomentMatrix);
-        _gpuComputeModule->queue().asyncRunKernel(kernelCalcStructureTensor);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelCalcStructureTensor));
 
         // const float sigmaSst = 2.0f;
         // cv::Mat gaussianKernel = cv::getGaussianKernel(11, sigmaSst, CV_32F);
@@ -303,14 +303,14 @@ public:
         kernelConvolutionGaussian.setRoundedGlobalWorkSize(clw::Grid(width, height));
         kernelConvolutionGaussian.setArg(0, _secondMomentMatrix);
         kernelConvolutionGaussian.setArg(1, _secondMomentMatrix2);
-        _gpuComputeModule->queue().asyncRunKernel(kernelConvolutionGaussian);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelConvolutionGaussian));
 
         clw::Kernel kernelCalcOrientationAndAnisotropy = _gpuComputeModule->acquireKernel(_kidCalcOrientationAndAnisotropy);
         kernelCalcOrientationAndAnisotropy.setLocalWorkSize(clw::Grid(16, 16));
         kernelCalcOrientationAndAnisotropy.setRoundedGlobalWorkSize(clw::Grid(width, height));
         kernelCalcOrientationAndAnisotropy.setArg(0, _secondMomentMatrix2);
         kernelCalcOrientationAndAnisotropy.setArg(1, _oriAni);
-        _gpuComputeModule->queue().asyncRunKernel(kernelCalcOrientationAndAnisotropy);
+        profile(_gpuComputeModule->queue().asyncRunKernel(kernelCalcOrientationAndAnisotropy));
 
         clw::Kernel kernelKuwahara = _gpuComputeModule->acquireKernel(
             format.order == clw::EChannelOrder::R ? _kidAnisotropicKuwahara : _kidAnisotropicKuwaharaRgb);
@@ -321,7 +321,7 @@ public:
         kernelKuwahara.setArg(2, _oriAni);
         kernelKuwahara.setArg(3, deviceDest);
         kernelKuwahara.setArg(4, (int) _radius);
-        _gpuComputeModule->queue().runKernel(kernelKuwahara);
+        runKernel(kernelKuwahara);
 
         return ExecutionStatus(EStatus::Ok);
     }
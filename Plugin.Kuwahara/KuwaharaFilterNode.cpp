@@ -31,12 +31,15 @@ class KuwaharaFilterNodeType : public NodeType
 public:
     KuwaharaFilterNodeType()
         : _radius(2)
+        , _method(EKuwaharaMethod::Window)
     {
         addInput("Image", ENodeFlowDataType::Image);
         addOutput("Output", ENodeFlowDataType::Image);
         addProperty("Radius", _radius)
             .setValidator(make_validator<InclRangePropertyValidator<int>>(1, 15))
             .setUiHints("min:1, max:15");
+        addProperty("Method", _method)
+            .setUiHints("item: Window, item: Summed-area table");
         setDescription("Kuwahara filter");
     }
 
@@ -51,12 +54,30 @@ public:
         if(src.empty())
             return ExecutionStatus(EStatus::Ok);
 
-        cvu::KuwaharaFilter(src, dst, _radius);
+        switch(_method.cast<Enum>().cast<EKuwaharaMethod>())
+        {
+        case EKuwaharaMethod::Window:
+            cvu::KuwaharaFilter(src, dst, _radius);
+            break;
+        case EKuwaharaMethod::SummedAreaTable:
+            cvu::KuwaharaFilterIntegral(src, dst, _radius);
+            break;
+        }
+
         return ExecutionStatus(EStatus::Ok);
     }
 
 protected:
+    enum class EKuwaharaMethod
+    {
+        // Sums up every window - cost grows with radius squared
+        Window,
+        // Constant time per pixel regardless of radius
+        SummedAreaTable
+    };
+
     TypedNodeProperty<int> _radius;
+    TypedNodeProperty<EKuwaharaMethod> _method;
 };
 
 class GeneralizedKuwaharaFilterNodeType : public NodeType
@@ -29,10 +29,18 @@
 
 #include <cassert>
 #include <algorithm>
+#include <cstdint>
 #include <limits>
+#include <vector>
 
 #include <opencv2/imgproc/imgproc.hpp>
 
+#if defined(__AVX__)
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#  include <emmintrin.h>
+#endif
+
 namespace std
 {
 template <typename T>
@@ -303,6 +311,149 @@ void KuwaharaFilter(cv::InputArray src_, cv::OutputArray dst_, int radius)
         CV_Assert(false);
 }
 
+// Builds summed-area tables (sum and sum of squares) for rows [y0, y1) of
+// the output and computes Kuwahara filter for them. Tables have one extra
+// zero row and column at the beginning.
+template<int cn>
+void KuwaharaFilterIntegral_rows(const cv::Mat& padded, cv::Mat& dst, int radius,
+                                 int y0, int y1, std::vector<int>& sum,
+                                 std::vector<std::int64_t>& sqsum)
+{
+    const int tableRows = y1 - y0 + 2 * radius + 1;
+    const int tableStep = (padded.cols + 1) * cn;
+
+    sum.resize(tableRows * tableStep);
+    sqsum.resize(tableRows * tableStep);
+    std::fill_n(sum.begin(), tableStep, 0);
+    std::fill_n(sqsum.begin(), tableStep, 0);
+
+    for(int ty = 1; ty < tableRows; ++ty)
+    {
+        const uchar* srcRow = padded.ptr<uchar>(y0 + ty - 1);
+        int* sumRow = &sum[ty * tableStep];
+        std::int64_t* sqsumRow = &sqsum[ty * tableStep];
+        int rowSum[cn] = {0};
+        std::int64_t rowSqsum[cn] = {0};
+
+        for(int c = 0; c < cn; ++c)
+        {
+            sumRow[c] = 0;
+            sqsumRow[c] = 0;
+        }
+
+        for(int i = 0; i < padded.cols * cn; i += cn)
+        {
+            for(int c = 0; c < cn; ++c)
+            {
+                int pix = srcRow[i + c];
+                rowSum[c] += pix;
+                rowSqsum[c] += pix * pix;
+                sumRow[i + cn + c] = sumRow[i + cn + c - tableStep] + rowSum[c];
+                sqsumRow[i + cn + c] = sqsumRow[i + cn + c - tableStep] + rowSqsum[c];
+            }
+        }
+    }
+
+    const int side = radius + 1;
+    const int offsetCols = side * cn;
+    const int offsetRows = side * tableStep;
+    const float n = static_cast<float>(side * side);
+
+    for(int y = y0; y < y1; ++y)
+    {
+        uchar* dstRow = dst.ptr<uchar>(y);
+        const int ty = y - y0;
+
+        // Top-left corners of top-left, top-right, bottom-right 
+        // and bottom-left quadrants (in that order)
+        const int quadrants[4] = {
+            ty * tableStep,
+            ty * tableStep + radius * cn,
+            (ty + radius) * tableStep + radius * cn,
+            (ty + radius) * tableStep
+        };
+
+        for(int x = 0; x < dst.cols; ++x)
+        {
+            float min_sigma = std::numeric_limits<float>::max();
+            float best[cn] = {0};
+
+            for(int k = 0; k < 4; ++k)
+            {
+                const int i00 = quadrants[k] + x * cn;
+                const int i01 = i00 + offsetCols;
+                const int i10 = i00 + offsetRows;
+                const int i11 = i10 + offsetCols;
+                float mean[cn];
+                float sigma = 0;
+
+                for(int c = 0; c < cn; ++c)
+                {
+                    mean[c] = static_cast<float>(
+                        sum[i11 + c] - sum[i01 + c] - sum[i10 + c] + sum[i00 + c]) / n;
+                    float sqmean = static_cast<float>(
+                        sqsum[i11 + c] - sqsum[i01 + c] - sqsum[i10 + c] + sqsum[i00 + c]) / n;
+                    sigma += std::abs(sqmean - mean[c] * mean[c]);
+                }
+
+                if(sigma < min_sigma)
+                {
+                    min_sigma = sigma;
+                    std::copy(mean, mean + cn, best);
+                }
+            }
+
+            for(int c = 0; c < cn; ++c)
+                dstRow[x * cn + c] = cv::saturate_cast<uchar>(best[c]);
+        }
+    }
+}
+
+template<int cn>
+void KuwaharaFilterIntegral_impl(const cv::Mat& src, cv::Mat& dst, int radius)
+{
+    // Replicated border gives the same result as clamping to edge
+    cv::Mat padded;
+    cv::copyMakeBorder(src, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+
+    // Tables are built for bands of rows so they stay small 
+    // and the sums fit in 32-bit integers
+    const int bandRows = 64;
+    const int numBands = (src.rows + bandRows - 1) / bandRows;
+
+    cvu::parallel_for(cv::Range(0, numBands), [&](const cv::Range& range)
+    {
+        std::vector<int> sum;
+        std::vector<std::int64_t> sqsum;
+
+        for(int band = range.start; band < range.end; ++band)
+        {
+            const int y0 = band * bandRows;
+            const int y1 = std::min(y0 + bandRows, src.rows);
+            KuwaharaFilterIntegral_rows<cn>(padded, dst, radius, y0, y1, sum, sqsum);
+        }
+    });
+}
+
+void KuwaharaFilterIntegral(cv::InputArray src_, cv::OutputArray dst_, int radius)
+{
+    cv::Mat src  = src_.getMat();
+
+    CV_Assert(src.depth() == CV_8U);
+    CV_Assert(src.channels() == 3 || src.channels() == 1);
+    CV_Assert(radius >= 1);
+
+    cv::Mat& dst = dst_.getMatRef();
+    dst.create(src.size(), src.type());
+
+    if(src.type() == CV_8UC1)
+        KuwaharaFilterIntegral_impl<1>(src, dst, radius);
+    else if(src.type() == CV_8UC3)
+        KuwaharaFilterIntegral_impl<3>(src, dst, radius);
+    else
+        CV_Assert(false);
+}
+
 void getGeneralizedKuwaharaKernel(cv::OutputArray kernel_, int N, float smoothing)
 {
     // Create sector map
@@ -354,166 +505,273 @@ void getGeneralizedKuwaharaKernel(cv::OutputArray kernel_, int N, float smoothin
     kernel = kernel.mul(gaussKernel);
 }
 
-void generalizedKuwaharaFilter_gray(const cv::Mat& src, cv::Mat& dst,
-                                    int radius, int N, float q, 
-                                    const cv::Mat& kernel)
+// Maximum number of sectors, weights of all of them fit in one AVX register
+static const int maxSectors = 8;
+
+// Precomputed samples of a filtering window. For every sample there's an
+// offset (in bytes) from the center pixel and a row of maxSectors weights
+// so that all sectors can be accumulated at once.
+struct SectorWindow
 {
-    const int radiusSquared = radius * radius;
-    const float pi = 3.14159274101257f;
-    const float piN = 2.0f * pi / float(N);
-    const float cosPI = std::cos(piN);
-    const float sinPI = std::sin(piN);
+    std::vector<int> offsets;
+    std::vector<float> weights;
+    float weightSum[maxSectors];
 
-    cvu::parallel_for(cv::Range(0, src.rows), 
-        [&](const cv::Range& range)
+    SectorWindow()
+    {
+        std::fill_n(weightSum, maxSectors, 0.0f);
+    }
+
+    // Instead of using N sector maps we use one and rotate sample coordinates
+    void addSample(int offset, float v0, float v1, int numSectors,
+                   float cosPI, float sinPI, float rounding, const cv::Mat& kernel)
+    {
+        offsets.push_back(offset);
+
+        for(int k = 0; k < maxSectors; ++k)
         {
-            const int maxN = 8;
+            float w = 0.0f;
 
-            for(int y = range.start; y < range.end; ++y)
+            if(k < numSectors)
             {
-                for(int x = 0; x < src.cols; ++x)
-                {
-                    // mean, stddev and weight
-                    float mean[maxN] = {0}, sqMean[maxN] = {0}, weight[maxN] = {0};
+                // map coordinates from circle of radius=radius to kernel map of radius=kernelSize
+                int u = static_cast<int>((v0 + 0.5f) * (kernel.cols - 1) + rounding);
+                int v = static_cast<int>((v1 + 0.5f) * (kernel.rows - 1) + rounding);
+                w = kernel.at<float>(v, u);
+
+                float v0_ =  v0*cosPI + v1*sinPI;
+                float v1_ = -v0*sinPI + v1*cosPI;
+                v0 = v0_;
+                v1 = v1_;
+            }
 
-                    for(int j = -radius; j <= radius; ++j)
-                    {
-                        for(int i = -radius; i <= radius; ++i)
-                        {
-                            // outside the circle (but inside the square)
-                            if(i*i + j*j > radiusSquared)
-                                continue;
-
-                            // use half-identity circle coordinates
-                            float v0 = 0.5f * i / float(radius);
-                            float v1 = 0.5f * j / float(radius);
-
-                            float c = src.at<uchar>(
-                                std::clamp(y + j, 0, src.rows - 1),
-                                std::clamp(x + i, 0, src.cols - 1));
-                            float cc = c * c;
-
-                            for(int k = 0; k < N; ++k)
-                            {
-                                // map coordinates from circle of radius=radius to kernel map of radius=kernelSize
-                                int u = static_cast<int>((v0 + 0.5f) * (kernel.cols - 1) + 0.5f);
-                                int v = static_cast<int>((v1 + 0.5f) * (kernel.rows - 1) + 0.5f);
-
-                                float w = kernel.at<float>(v, u);
-
-                                weight[k] += w;
-                                mean[k]   += c * w;
-                                sqMean[k] += cc * w;
-
-                                // instead of using 8 sector maps we use one and rotate coordinates
-                                float v0_ =  v0*cosPI + v1*sinPI;
-                                float v1_ = -v0*sinPI + v1*cosPI;
-                                v0 = v0_;
-                                v1 = v1_;
-                            }
-                        }
-                    }
+            weights.push_back(w);
+            weightSum[k] += w;
+        }
+    }
+};
 
-                    float out = 0.0f;
-                    float sumWeight = 0.0f;
+// Weighted sum of pixel values and their squares for all sectors at once
+#if defined(__AVX__)
+struct SectorAccumulator
+{
+    __m256 mean, sqMean;
 
-                    for (int k = 0; k < N; ++k)
-                    {
-                        mean[k] /= weight[k];
-                        sqMean[k] = sqMean[k] / weight[k] - mean[k] * mean[k];
+    SectorAccumulator() : mean(_mm256_setzero_ps()), sqMean(_mm256_setzero_ps()) {}
 
-                        float w = 1.0f / (1.0f + std::pow(std::abs(sqMean[k]), 0.5f * q));
+    void add(const float* w, float c)
+    {
+        __m256 weight = _mm256_loadu_ps(w);
+        mean = _mm256_add_ps(mean, _mm256_mul_ps(_mm256_set1_ps(c), weight));
+        sqMean = _mm256_add_ps(sqMean, _mm256_mul_ps(_mm256_set1_ps(c * c), weight));
+    }
 
-                        sumWeight += w;
-                        out += mean[k] * w;
-                    }
+    void store(float* mean_, float* sqMean_) const
+    {
+        _mm256_storeu_ps(mean_, mean);
+        _mm256_storeu_ps(sqMean_, sqMean);
+    }
+};
+#elif defined(__SSE2__) || defined(_M_X64)
+struct SectorAccumulator
+{
+    __m128 mean[2], sqMean[2];
+
+    SectorAccumulator()
+    {
+        mean[0] = mean[1] = sqMean[0] = sqMean[1] = _mm_setzero_ps();
+    }
+
+    void add(const float* w, float c)
+    {
+        __m128 vc = _mm_set1_ps(c);
+        __m128 vcc = _mm_set1_ps(c * c);
+        for(int h = 0; h < 2; ++h)
+        {
+            __m128 weight = _mm_loadu_ps(w + 4 * h);
+            mean[h] = _mm_add_ps(mean[h], _mm_mul_ps(vc, weight));
+            sqMean[h] = _mm_add_ps(sqMean[h], _mm_mul_ps(vcc, weight));
+        }
+    }
+
+    void store(float* mean_, float* sqMean_) const
+    {
+        for(int h = 0; h < 2; ++h)
+        {
+            _mm_storeu_ps(mean_ + 4 * h, mean[h]);
+            _mm_storeu_ps(sqMean_ + 4 * h, sqMean[h]);
+        }
+    }
+};
+#else
+struct SectorAccumulator
+{
+    float mean[maxSectors], sqMean[maxSectors];
+
+    SectorAccumulator()
+    {
+        std::fill_n(mean, maxSectors, 0.0f);
+        std::fill_n(sqMean, maxSectors, 0.0f);
+    }
+
+    void add(const float* w, float c)
+    {
+        for(int k = 0; k < maxSectors; ++k)
+        {
+            mean[k] += c * w[k];
+            sqMean[k] += c * c * w[k];
+        }
+    }
+
+    void store(float* mean_, float* sqMean_) const
+    {
+        std::copy(mean, mean + maxSectors, mean_);
+        std::copy(sqMean, sqMean + maxSectors, sqMean_);
+    }
+};
+#endif
+
+inline float sectorWeight(float sigma, float q)
+{
+    // Spare pow() call for q = 8 which is the one always used
+    if(q == 8.0f)
+    {
+        float sigma2 = sigma * sigma;
+        return 1.0f / (1.0f + sigma2 * sigma2);
+    }
+    return 1.0f / (1.0f + std::pow(sigma, 0.5f * q));
+}
+
+template<int cn>
+void sectorFilterPixel(const uchar* center, const SectorWindow& window,
+                       int numSectors, float q, uchar* dst)
+{
+    SectorAccumulator acc[cn];
+    const int numSamples = static_cast<int>(window.offsets.size());
+    const int* offsets = window.offsets.data();
+    const float* weights = window.weights.data();
+
+    for(int n = 0; n < numSamples; ++n, weights += maxSectors)
+    {
+        const uchar* pix = center + offsets[n];
+        for(int c = 0; c < cn; ++c)
+            acc[c].add(weights, static_cast<float>(pix[c]));
+    }
+
+    float mean[cn][maxSectors], sqMean[cn][maxSectors];
+    for(int c = 0; c < cn; ++c)
+        acc[c].store(mean[c], sqMean[c]);
+
+    float out[cn] = {0};
+    float sumWeight = 0.0f;
+
+    for(int k = 0; k < numSectors; ++k)
+    {
+        float sigma = 0.0f;
+        for(int c = 0; c < cn; ++c)
+        {
+            mean[c][k] /= window.weightSum[k];
+            sigma += std::abs(sqMean[c][k] / window.weightSum[k] - mean[c][k] * mean[c][k]);
+        }
+
+        float w = sectorWeight(sigma, q);
+        sumWeight += w;
+        for(int c = 0; c < cn; ++c)
+            out[c] += mean[c][k] * w;
+    }
+
+    for(int c = 0; c < cn; ++c)
+        dst[c] = cv::saturate_cast<uchar>(out[c] / sumWeight);
+}
 
-                    dst.at<uchar>(y, x) = cv::saturate_cast<uchar>(out / sumWeight);
+// Runs sector filter over image padded by margin on each side. Image is
+// processed in small tiles so window samples of a tile stay in cache.
+template<int cn, class WindowSelector>
+void sectorFilter(const cv::Mat& padded, int margin, cv::Mat& dst,
+                  int numSectors, float q, const WindowSelector& selectWindow)
+{
+    const int tileRows = 16;
+    const int tileCols = 64;
+    const int numTilesX = (dst.cols + tileCols - 1) / tileCols;
+    const int numTilesY = (dst.rows + tileRows - 1) / tileRows;
+
+    cvu::parallel_for(cv::Range(0, numTilesX * numTilesY),
+        [&](const cv::Range& range)
+        {
+            for(int tile = range.start; tile < range.end; ++tile)
+            {
+                const int y0 = (tile / numTilesX) * tileRows;
+                const int x0 = (tile % numTilesX) * tileCols;
+                const int y1 = std::min(y0 + tileRows, dst.rows);
+                const int x1 = std::min(x0 + tileCols, dst.cols);
+
+                for(int y = y0; y < y1; ++y)
+                {
+                    const uchar* srcRow = padded.ptr<uchar>(y + margin) + margin * cn;
+                    uchar* dstRow = dst.ptr<uchar>(y);
+
+                    for(int x = x0; x < x1; ++x)
+                    {
+                        sectorFilterPixel<cn>(srcRow + x * cn, selectWindow(x, y),
+                                              numSectors, q, dstRow + x * cn);
+                    }
                 }
             }
         });
 }
 
-void generalizedKuwaharaFilter_bgr(const cv::Mat& src, cv::Mat& dst,
-                                   int radius, int N, float q, 
-                                   const cv::Mat& kernel)
+template<int cn>
+void generalizedKuwaharaFilter_impl(const cv::Mat& src, cv::Mat& dst,
+                                    int radius, int N, float q,
+                                    float rounding, const cv::Mat& kernel)
 {
+    // Replicated border gives the same result as clamping to edge
+    cv::Mat padded;
+    cv::copyMakeBorder(src, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+
     const int radiusSquared = radius * radius;
     const float pi = 3.14159274101257f;
     const float piN = 2.0f * pi / float(N);
     const float cosPI = std::cos(piN);
     const float sinPI = std::sin(piN);
 
-    cvu::parallel_for(cv::Range(0, src.rows), 
-        [&](const cv::Range& range)
-        {
-            const int maxN = 8;
-
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 0; x < src.cols; ++x)
-                {
-                    // mean, stddev and weight
-                    cv::Vec3f mean[maxN], sqMean[maxN];
-                    float weight[maxN] = {0};
+    // Window is the same for every pixel
+    SectorWindow window;
 
-                    for(int j = -radius; j <= radius; ++j)
-                    {
-                        for(int i = -radius; i <= radius; ++i)
-                        {
-                            // outside the circle (but inside the square)
-                            if(i*i + j*j > radiusSquared)
-                                continue;
-
-                            // use half-identity circle coordinates
-                            float v0 = 0.5f * i / float(radius);
-                            float v1 = 0.5f * j / float(radius);
-
-                            cv::Vec3f c = src.at<cv::Vec3b>(
-                                std::clamp(y + j, 0, src.rows - 1),
-                                std::clamp(x + i, 0, src.cols - 1));
-                            cv::Vec3f cc = c.mul(c);
-
-                            for(int k = 0; k < N; ++k)
-                            {
-                                // map coordinates from circle of radius=radius to kernel map of radius=kernelSize
-                                int u = static_cast<int>((v0 + 0.5f) * (kernel.cols - 1));
-                                int v = static_cast<int>((v1 + 0.5f) * (kernel.rows - 1));
-
-                                float w = kernel.at<float>(v, u);
-
-                                weight[k] += w;
-                                mean[k]   += c * w;
-                                sqMean[k] += cc * w;
-
-                                // instead of using 8 sector maps we use one and rotate coordinates
-                                float v0_ =  v0*cosPI + v1*sinPI;
-                                float v1_ = -v0*sinPI + v1*cosPI;
-                                v0 = v0_;
-                                v1 = v1_;
-                            }
-                        }
-                    }
+    for(int j = -radius; j <= radius; ++j)
+    {
+        for(int i = -radius; i <= radius; ++i)
+        {
+            // outside the circle (but inside the square)
+            if(i*i + j*j > radiusSquared)
+                continue;
 
-                    cv::Vec3f out;
-                    float sumWeight = 0.0f;
+            // use half-identity circle coordinates
+            float v0 = 0.5f * i / float(radius);
+            float v1 = 0.5f * j / float(radius);
 
-                    for (int k = 0; k < N; ++k)
-                    {
-                        mean[k] /= weight[k];
-                        sqMean[k] = sqMean[k] / weight[k] - mean[k].mul(mean[k]);
+            window.addSample(j * static_cast<int>(padded.step) + i * cn,
+                             v0, v1, N, cosPI, sinPI, rounding, kernel);
+        }
+    }
 
-                        float sigmaSum = std::abs(sqMean[k][0]) + std::abs(sqMean[k][1]) + std::abs(sqMean[k][2]);
-                        float w = 1.0f / (1.0f + std::pow(sigmaSum, 0.5f * q));
+    sectorFilter<cn>(padded, radius, dst, N, q, 
+        [&](int, int) -> const SectorWindow& { return window; });
+}
 
-                        sumWeight += w;
-                        out += mean[k] * w;
-                    }
+void generalizedKuwaharaFilter_gray(const cv::Mat& src, cv::Mat& dst,
+                                    int radius, int N, float q, 
+                                    const cv::Mat& kernel)
+{
+    // Gray version always rounded kernel coordinates
+    generalizedKuwaharaFilter_impl<1>(src, dst, radius, N, q, 0.5f, kernel);
+}
 
-                    dst.at<cv::Vec3b>(y, x) = out / sumWeight;
-                }
-            }
-        });
+void generalizedKuwaharaFilter_bgr(const cv::Mat& src, cv::Mat& dst,
+                                   int radius, int N, float q, 
+                                   const cv::Mat& kernel)
+{
+    generalizedKuwaharaFilter_impl<3>(src, dst, radius, N, q, 0.0f, kernel);
 }
 
 void generalizedKuwaharaFilter(cv::InputArray src_, cv::OutputArray dst_,
@@ -578,6 +836,84 @@ void calcOrientationAndAnisotropy(const cv::Mat& ssm, cv::Mat& oriAni)
         });
 }
 
+// Windows are precomputed for quantized orientation and anisotropy
+static const int orientationBins = 64;
+static const int anisotropyBins = 8;
+
+template<int cn>
+void anisotropicKuwaharaFilter_impl(const cv::Mat& src, const cv::Mat& oriAni, 
+                                    cv::Mat& dst, int radius, int N, float q, 
+                                    float alpha, const cv::Mat& kernel)
+{
+    // Ellipse axes are at most 2*radius long
+    const int margin = 2 * radius;
+    cv::Mat padded;
+    cv::copyMakeBorder(src, padded, margin, margin, margin, margin, cv::BORDER_REPLICATE);
+
+    const float pi = 3.14159274101257f;
+    const float piN = 2.0f * pi / float(N);
+    const float cosPI = std::cos(piN);
+    const float sinPI = std::sin(piN);
+
+    std::vector<SectorWindow> windows(orientationBins * anisotropyBins);
+
+    cvu::parallel_for(cv::Range(0, static_cast<int>(windows.size())),
+        [&](const cv::Range& range)
+        {
+            for(int bin = range.start; bin < range.end; ++bin)
+            {
+                float phi = (bin / anisotropyBins) * (2.0f * pi / orientationBins) - pi;
+                float A = (bin % anisotropyBins) / float(anisotropyBins - 1);
+
+                float a = radius * std::clamp((alpha + A) / alpha, 0.1f, 2.0f);
+                float b = radius * std::clamp(alpha / (alpha + A), 0.1f, 2.0f);
+
+                float cos_phi = std::cos(phi);
+                float sin_phi = std::sin(phi);
+
+                float sr0 =  0.5f/a * cos_phi;
+                float sr1 =  0.5f/a * sin_phi;
+                float sr2 = -0.5f/b * sin_phi;
+                float sr3 =  0.5f/b * cos_phi;
+
+                int max_x = int(std::sqrt(a*a * cos_phi*cos_phi +
+                                          b*b * sin_phi*sin_phi));
+                int max_y = int(std::sqrt(a*a * sin_phi*sin_phi +
+                                          b*b * cos_phi*cos_phi));
+
+                SectorWindow& window = windows[bin];
+
+                for (int j = -max_y; j <= max_y; ++j)
+                {
+                    for (int i = -max_x; i <= max_x; ++i)
+                    {
+                        float v0 = sr0*i + sr1*j;
+                        float v1 = sr2*i + sr3*j;
+
+                        // Sectors are always rotated 8 times
+                        if((v0*v0 + v1*v1) < 0.25f)
+                        {
+                            window.addSample(j * static_cast<int>(padded.step) + i * cn,
+                                             v0, v1, maxSectors, cosPI, sinPI, 0.0f, kernel);
+                        }
+                    }
+                }
+            }
+        });
+
+    sectorFilter<cn>(padded, margin, dst, maxSectors, q, 
+        [&](int x, int y) -> const SectorWindow&
+        {
+            cv::Vec2f t = oriAni.at<cv::Vec2f>(y, x);
+
+            int phiBin = static_cast<int>((t[0] + pi) * (orientationBins / (2.0f * pi)) + 0.5f);
+            int anisotropyBin = static_cast<int>(std::clamp(t[1], 0.0f, 1.0f) * (anisotropyBins - 1) + 0.5f);
+            phiBin = phiBin % orientationBins;
+
+            return windows[phiBin * anisotropyBins + anisotropyBin];
+        });
+}
+
 void anisotropicKuwaharaFilter_gray(const cv::Mat& src, cv::Mat& dst,
                                     int radius, int N, float q, 
                                     float alpha, float sigmaSst,
@@ -620,92 +956,7 @@ void anisotropicKuwaharaFilter_gray(const cv::Mat& src, cv::Mat& dst,
     cv::Mat oriAni(srcNorm.size(), CV_32FC2);
     calcOrientationAndAnisotropy(ssm, oriAni);
 
-    const float pi = 3.14159274101257f;
-    const float piN = 2.0f * pi / float(N);
-    const float cosPI = std::cos(piN);
-    const float sinPI = std::sin(piN);
-
-    cvu::parallel_for(cv::Range(0, dst.rows), 
-        [&](const cv::Range& range)
-        {
-            const int N = 8;
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 0; x < dst.cols; ++x)
-                {
-                    cv::Vec2f t = oriAni.at<cv::Vec2f>(y, x);
-
-                    float a = radius * std::clamp((alpha + t[1]) / alpha, 0.1f, 2.0f);
-                    float b = radius * std::clamp(alpha / (alpha + t[1]), 0.1f, 2.0f);
-
-                    float cos_phi = std::cos(t[0]);
-                    float sin_phi = std::sin(t[0]);
-
-                    float sr0 =  0.5f/a * cos_phi;
-                    float sr1 =  0.5f/a * sin_phi;
-                    float sr2 = -0.5f/b * sin_phi;
-                    float sr3 =  0.5f/b * cos_phi;
-
-                    int max_x = int(std::sqrt(a*a * cos_phi*cos_phi +
-                                              b*b * sin_phi*sin_phi));
-                    int max_y = int(std::sqrt(a*a * sin_phi*sin_phi +
-                                              b*b * cos_phi*cos_phi));
-
-
-                    float mean[N] = {0}, sqMean[N] = {0}, weight[N] = {0};
-
-                    for (int j = -max_y; j <= max_y; ++j)
-                    {
-                        for (int i = -max_x; i <= max_x; ++i)
-                        {
-                            float v0 = sr0*i + sr1*j;
-                            float v1 = sr2*i + sr3*j;
-
-                            if((v0*v0 + v1*v1) < 0.25f)
-                            {
-                                float c = src.at<uchar>(
-                                    std::clamp(y + j, 0, src.rows - 1),
-                                    std::clamp(x + i, 0, src.cols - 1));
-                                float cc = c * c;
-
-                                for (int k = 0; k < N; ++k)
-                                {
-                                    int u = static_cast<int>((v0 + 0.5f) * (kernel.cols - 1));
-                                    int v = static_cast<int>((v1 + 0.5f) * (kernel.rows - 1));
-
-                                    float w = kernel.at<float>(v, u);
-
-                                    weight[k] += w;
-                                    mean[k]   += c * w;
-                                    sqMean[k] += cc * w;
-
-                                    float v0_ =  v0*cosPI + v1*sinPI;
-                                    float v1_ = -v0*sinPI + v1*cosPI;
-                                    v0 = v0_;
-                                    v1 = v1_;
-                                }
-                            }
-                        }
-                    }
-
-                    float out = 0.0f;
-                    float sumWeight = 0.0f;
-
-                    for (int k = 0; k < N; ++k)
-                    {
-                        mean[k] /= weight[k];
-                        sqMean[k] = sqMean[k] / weight[k] - mean[k] * mean[k];
-
-                        float w = 1.0f / (1.0f + std::pow(std::abs(sqMean[k]), 0.5f * q));
-
-                        sumWeight += w;
-                        out += mean[k] * w;
-                    }
-
-                    dst.at<uchar>(y, x) = cv::saturate_cast<uchar>(out / sumWeight);
-                }
-            }
-        });
+    anisotropicKuwaharaFilter_impl<1>(src, oriAni, dst, radius, N, q, alpha, kernel);
 }
 
 void anisotropicKuwaharaFilter_bgr(const cv::Mat& src, cv::Mat& dst,
@@ -750,94 +1001,7 @@ void anisotropicKuwaharaFilter_bgr(const cv::Mat& src, cv::Mat& dst,
     cv::Mat oriAni(srcNorm.size(), CV_32FC2);
     calcOrientationAndAnisotropy(ssm, oriAni);
     
-    const float pi = 3.14159274101257f;
-    const float piN = 2.0f * pi / float(N);
-    const float cosPI = std::cos(piN);
-    const float sinPI = std::sin(piN);
-
-    cvu::parallel_for(cv::Range(0, dst.rows), 
-        [&](const cv::Range& range)
-        {
-            const int N = 8;
-            for(int y = range.start; y < range.end; ++y)
-            {
-                for(int x = 0; x < dst.cols; ++x)
-                {
-                    cv::Vec2f t = oriAni.at<cv::Vec2f>(y, x);
-
-                    float a = radius * std::clamp((alpha + t[1]) / alpha, 0.1f, 2.0f);
-                    float b = radius * std::clamp(alpha / (alpha + t[1]), 0.1f, 2.0f);
-
-                    float cos_phi = std::cos(t[0]);
-                    float sin_phi = std::sin(t[0]);
-
-                    float sr0 =  0.5f/a * cos_phi;
-                    float sr1 =  0.5f/a * sin_phi;
-                    float sr2 = -0.5f/b * sin_phi;
-                    float sr3 =  0.5f/b * cos_phi;
-
-                    int max_x = int(std::sqrt(a*a * cos_phi*cos_phi +
-                                              b*b * sin_phi*sin_phi));
-                    int max_y = int(std::sqrt(a*a * sin_phi*sin_phi +
-                                              b*b * cos_phi*cos_phi));
-
-
-                    cv::Vec3f mean[N], sqMean[N];
-                    float weight[N] = {0};
-
-                    for (int j = -max_y; j <= max_y; ++j)
-                    {
-                        for (int i = -max_x; i <= max_x; ++i)
-                        {
-                            float v0 = sr0*i + sr1*j;
-                            float v1 = sr2*i + sr3*j;
-
-                            if((v0*v0 + v1*v1) < 0.25f)
-                            {
-                                cv::Vec3f c = src.at<cv::Vec3b>(
-                                    std::clamp(y + j, 0, src.rows - 1),
-                                    std::clamp(x + i, 0, src.cols - 1));
-                                cv::Vec3f cc = c.mul(c);
-
-                                for (int k = 0; k < N; ++k)
-                                {
-                                    int u = static_cast<int>((v0 + 0.5f) * (kernel.cols - 1));
-                                    int v = static_cast<int>((v1 + 0.5f) * (kernel.rows - 1));
-
-                                    float w = kernel.at<float>(v, u);
-
-                                    weight[k] += w;
-                                    mean[k]   += c * w;
-                                    sqMean[k] += cc * w;
-
-                                    float v0_ =  v0*cosPI + v1*sinPI;
-                                    float v1_ = -v0*sinPI + v1*cosPI;
-                                    v0 = v0_;
-                                    v1 = v1_;
-                                }
-                            }
-                        }
-                    }
-
-                    cv::Vec3f out;
-                    float sumWeight = 0.0f;
-
-                    for (int k = 0; k < N; ++k)
-                    {
-                        mean[k] /= weight[k];
-                        sqMean[k] = sqMean[k] / weight[k] - mean[k].mul(mean[k]);
-
-                        float sigma2 = std::abs(sqMean[k][0]) + std::abs(sqMean[k][1]) + std::abs(sqMean[k][2]);
-                        float w = 1.0f / (1.0f + std::pow(sigma2, 0.5f * q));
-
-                        sumWeight += w;
-                        out += mean[k] * w;
-                    }
-
-                    dst.at<cv::Vec3b>(y, x) = out / sumWeight;
-                }
-            }
-        });
+    anisotropicKuwaharaFilter_impl<3>(src, oriAni, dst, radius, N, q, alpha, kernel);
 }
 
 void anisotropicKuwaharaFilter(cv::InputArray src_, cv::OutputArray dst_,
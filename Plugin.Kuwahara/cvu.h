@@ -28,6 +28,8 @@
 namespace cvu
 {
 void KuwaharaFilter(cv::InputArray src, cv::OutputArray dst, int radius);
+// Same as above but uses summed-area tables - cost per pixel doesn't depend on radius
+void KuwaharaFilterIntegral(cv::InputArray src, cv::OutputArray dst, int radius);
 // Based on paper Artistic edge and corner enhancing smoothing, G. Papari, N. Petkov, P. Campisi
 void generalizedKuwaharaFilter(cv::InputArray src_, cv::OutputArray dst_,
                                int radius = 6, int N = 8,
@@ -0,0 +1,572 @@
+/*
+ * Copyright (c) 2013-2014 Kajetan Swierk <k0zmo@outlook.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ *
+ */
+
+#include "Logic/NodeSystem.h"
+#include "Logic/NodeTree.h"
+#include "Logic/NodeType.h"
+#include "Logic/NodeLink.h"
+#include "Logic/NodeException.h"
+#include "Logic/NodeTreeSerializer.h"
+#include "Logic/NodeResolver.h"
+#include "Logic/NodeProfiler.h"
+#include "Logic/ImageBufferPool.h"
+
+#include "Logic/OpenCL/IGpuNodeModule.h"
+
+#include "Kommon/HighResolutionClock.h"
+#include "Kommon/ModulePath.h"
+#include "Kommon/StringUtils.h"
+
+#include <QDir>
+#include <QFileInfo>
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <map>
+#include <regex>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+#if K_SYSTEM == K_SYSTEM_WINDOWS
+const QString pluginExtensionName = QStringLiteral("*.dll");
+#elif K_SYSTEM == K_SYSTEM_LINUX
+const QString pluginExtensionName = QStringLiteral("*.so");
+#endif
+
+struct Options
+{
+    string treePath;
+    vector<string> properties;
+    vector<string> outputs;
+    vector<string> plugins;
+    string input;
+    string sourceNode;
+    string outputDir = ".";
+    string profilePath;
+    string tracePath;
+    int frames = 0;
+    bool parallel = false;
+    bool pipelined = false;
+    bool useGpu = true;
+    bool warmUp = true;
+    bool gpuProfiling = false;
+};
+
+struct NodeTimings
+{
+    size_t calls = 0;
+    double total = 0.0;
+    double max = 0.0;
+    double device = 0.0;
+    // Frame of the last recorded call
+    std::uint64_t frame = 0;
+};
+
+void printUsage()
+{
+    cout << "Usage: Mouve.Runner <tree file> [options]\n"
+        "Options:\n"
+        "  -s, --set p://node/property=value  Override node property value\n"
+        "  -i, --input <path>                 Image, directory, glob pattern\n"
+        "                                     (e.g. images/*.png) or video file\n"
+        "      --source <node>                Node the input is fed to (by default\n"
+        "                                     first node with a file/video path)\n"
+        "  -n, --frames <count>               Number of frames to process\n"
+        "                                     (default: until input is exhausted)\n"
+        "  -o, --output o://node/socket       Image output socket to save (repeatable)\n"
+        "  -d, --output-dir <dir>             Directory for saved outputs (default: .)\n"
+        "      --parallel                     Execute independent nodes concurrently\n"
+        "      --pipelined                    Overlap processing of consecutive frames\n"
+        "                                     (saved outputs are named after the frame\n"
+        "                                     that produced them)\n"
+        "      --profile <file>               Save per-node latency statistics as JSON\n"
+        "      --trace <file>                 Save Chrome trace event file\n"
+        "      --plugin <path>                Load additional plugin (repeatable)\n"
+        "      --no-gpu                       Don't initialize OpenCL module\n"
+        "      --no-warm-up                   Build OpenCL kernels lazily on first use\n"
+        "      --gpu-profiling                Measure device time of OpenCL commands\n"
+        "                                     (implied by --profile and --trace)\n"
+        "  -h, --help                         Show this help\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    auto nextValue = [&](int& i) -> string {
+        if(i + 1 >= argc)
+            throw invalid_argument(string_format("Missing value for %s", argv[i]));
+        return argv[++i];
+    };
+
+    for(int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if(arg == "-h" || arg == "--help")
+            return false;
+        else if(arg == "-s" || arg == "--set")
+            options.properties.push_back(nextValue(i));
+        else if(arg == "-i" || arg == "--input")
+            options.input = nextValue(i);
+        else if(arg == "--source")
+            options.sourceNode = nextValue(i);
+        else if(arg == "-n" || arg == "--frames")
+            options.frames = stoi(nextValue(i));
+        else if(arg == "-o" || arg == "--output")
+            options.outputs.push_back(nextValue(i));
+        else if(arg == "-d" || arg == "--output-dir")
+            options.outputDir = nextValue(i);
+        else if(arg == "--parallel")
+            options.parallel = true;
+        else if(arg == "--pipelined")
+            options.pipelined = true;
+        else if(arg == "--profile")
+            options.profilePath = nextValue(i);
+        else if(arg == "--trace")
+            options.tracePath = nextValue(i);
+        else if(arg == "--plugin")
+            options.plugins.push_back(nextValue(i));
+        else if(arg == "--no-gpu")
+            options.useGpu = false;
+        else if(arg == "--no-warm-up")
+            options.warmUp = false;
+        else if(arg == "--gpu-profiling")
+            options.gpuProfiling = true;
+        else if(!arg.empty() && arg[0] != '-' && options.treePath.empty())
+            options.treePath = arg;
+        else
+            throw invalid_argument(string_format("Unknown option: %s", arg.c_str()));
+    }
+
+    return !options.treePath.empty();
+}
+
+void loadPlugins(NodeSystem& nodeSystem, const vector<string>& extraPlugins)
+{
+    QFileInfo execInfo(QString::fromStdString(executablePath()));
+    QDir pluginDir = execInfo.absoluteDir();
+
+    vector<string> plugins;
+    if(pluginDir.cd(QStringLiteral("plugins")))
+    {
+        for(const auto& pluginInfo : pluginDir.entryInfoList(
+                QStringList(pluginExtensionName), QDir::Files))
+            plugins.push_back(pluginInfo.absoluteFilePath().toStdString());
+    }
+    plugins.insert(end(plugins), begin(extraPlugins), end(extraPlugins));
+
+    for(const auto& plugin : plugins)
+    {
+        try
+        {
+            nodeSystem.loadPlugin(plugin);
+        }
+        catch(exception& ex)
+        {
+            cerr << "Couldn't load plugin " << plugin << " - details: " << ex.what() << endl;
+        }
+    }
+}
+
+NodeProperty parseProperty(EPropertyType type, const string& value)
+{
+    switch(type)
+    {
+    case EPropertyType::Boolean:
+        return NodeProperty{value == "true" || value == "1"};
+    case EPropertyType::Integer:
+        return NodeProperty{stoi(value)};
+    case EPropertyType::Double:
+        return NodeProperty{stod(value)};
+    case EPropertyType::Enum:
+        return NodeProperty{Enum(stoi(value))};
+    case EPropertyType::Matrix:
+    {
+        Matrix3x3 matrix;
+        size_t pos = 0;
+        for(int i = 0; i < 9 && pos < value.size(); ++i)
+        {
+            size_t next = value.find(',', pos);
+            matrix.v[i] = stod(value.substr(pos, next - pos));
+            pos = next == string::npos ? value.size() : next + 1;
+        }
+        return NodeProperty{matrix};
+    }
+    case EPropertyType::Filepath:
+        return NodeProperty{Filepath{value}};
+    case EPropertyType::String:
+        return NodeProperty{value};
+    default:
+        return NodeProperty{};
+    }
+}
+
+void overrideProperty(NodeTree& nodeTree, NodeResolver& resolver, const string& assignment)
+{
+    regex rx("^p://([^/]+)/([^=]+)=(.*)$");
+    smatch match;
+
+    if(!regex_match(assignment, match, rx))
+    {
+        throw invalid_argument(string_format(
+            "Bad property assignment: %s", assignment.c_str()));
+    }
+
+    NodeID nodeID = resolver.resolveNode(match[1].str());
+    PropertyID propID = resolver.resolveProperty(nodeID, match[2].str());
+    if(propID == InvalidPropertyID)
+    {
+        throw invalid_argument(string_format(
+            "No such property: %s", assignment.c_str()));
+    }
+
+    EPropertyType type = resolver.propertyConfig(nodeID, propID).type();
+    if(!nodeTree.nodeSetProperty(nodeID, propID, parseProperty(type, match[3].str())))
+    {
+        throw invalid_argument(string_format(
+            "Invalid value for property: %s", assignment.c_str()));
+    }
+
+    nodeTree.tagNode(nodeID);
+}
+
+// Returns sorted list of files if given path is a directory or glob pattern
+vector<string> listImages(const string& path)
+{
+    static const QStringList imageFilters = {
+        "*.bmp", "*.dib", "*.jpeg", "*.jpg", "*.jpe", "*.jp2", "*.png",
+        "*.pbm", "*.pgm", "*.ppm", "*.sr", "*.ras", "*.tiff", "*.tif"};
+
+    QString qpath = QString::fromStdString(path);
+    QFileInfo info(qpath);
+    QDir dir;
+    QStringList filters;
+
+    if(info.isDir())
+    {
+        dir = QDir(qpath);
+        filters = imageFilters;
+    }
+    else if(qpath.contains('*') || qpath.contains('?'))
+    {
+        dir = info.absoluteDir();
+        filters << info.fileName();
+    }
+    else
+    {
+        return {};
+    }
+
+    vector<string> files;
+    for(const auto& fileInfo : dir.entryInfoList(filters, QDir::Files, QDir::Name))
+        files.push_back(fileInfo.absoluteFilePath().toStdString());
+    return files;
+}
+
+NodeID findSourceNode(NodeTree& nodeTree, NodeResolver& resolver, const string& nodeName)
+{
+    if(!nodeName.empty())
+        return resolver.resolveNode(nodeName);
+
+    auto nodeIt = nodeTree.createNodeIterator();
+    NodeID nodeID;
+    while(nodeIt->next(nodeID))
+    {
+        if(resolver.resolveProperty(nodeID, "Video path") != InvalidPropertyID ||
+           resolver.resolveProperty(nodeID, "File path") != InvalidPropertyID)
+            return nodeID;
+    }
+
+    return InvalidNodeID;
+}
+
+// Saves outputs produced since last call, named after the frame that produced
+// them (in pipelined mode downstream nodes are one frame behind)
+void saveOutputs(NodeTree& nodeTree, NodeResolver& resolver,
+                 const vector<SocketAddress>& outputs,
+                 vector<std::uint64_t>& savedFrames,
+                 const string& outputDir)
+{
+    QDir dir(QString::fromStdString(outputDir));
+
+    for(size_t i = 0; i < outputs.size(); ++i)
+    {
+        const SocketAddress& addr = outputs[i];
+        std::uint64_t frame = nodeTree.outputFrame(addr.node);
+        if(frame == 0 || frame == savedFrames[i])
+            continue;
+        savedFrames[i] = frame;
+
+        const NodeFlowData& data = nodeTree.outputSocket(addr.node, addr.socket);
+        if(!data.isValidImage())
+            continue;
+
+        const string& socketName = resolver.outputSocketConfig(addr.node, addr.socket).name();
+        string fileName = string_format("%s.%s.%06d.png",
+            nodeTree.nodeName(addr.node).c_str(), socketName.c_str(), int(frame - 1));
+        data.saveToDisk(dir.absoluteFilePath(QString::fromStdString(fileName)).toStdString());
+    }
+}
+
+// Records timings of nodes executed since last call
+void collectTimings(NodeTree& nodeTree, map<NodeID, NodeTimings>& timings)
+{
+    auto nodeIt = nodeTree.createNodeIterator();
+    NodeID nodeID;
+    while(nodeIt->next(nodeID))
+    {
+        std::uint64_t frame = nodeTree.outputFrame(nodeID);
+        if(frame == 0 || frame == timings[nodeID].frame)
+            continue;
+
+        NodeTimings& t = timings[nodeID];
+        double elapsed = nodeTree.nodeTimeElapsed(nodeID);
+        t.frame = frame;
+        ++t.calls;
+        t.total += elapsed;
+        t.max = std::max(t.max, elapsed);
+        t.device += nodeTree.nodeDeviceTimeElapsed(nodeID);
+    }
+}
+
+void printTimings(NodeTree& nodeTree, const map<NodeID, NodeTimings>& timings,
+                  int frames, double totalTime, std::uint64_t bytesCopied)
+{
+    vector<pair<NodeID, NodeTimings>> sorted(begin(timings), end(timings));
+    sort(begin(sorted), end(sorted), [](const pair<NodeID, NodeTimings>& lhs,
+                                        const pair<NodeID, NodeTimings>& rhs) {
+        return lhs.second.total > rhs.second.total;
+    });
+
+    // Device times are only known for offloading nodes with profiling enabled
+    bool hasDeviceTimes = any_of(begin(sorted), end(sorted), 
+        [](const pair<NodeID, NodeTimings>& entry) { return entry.second.device > 0.0; });
+
+    cout << "\n" << left << setw(32) << "Node" << right
+         << setw(10) << "Calls" << setw(14) << "Avg [ms]"
+         << setw(14) << "Max [ms]" << setw(14) << "Total [ms]";
+    if(hasDeviceTimes)
+        cout << setw(16) << "Device avg [ms]";
+    cout << "\n";
+
+    for(const auto& entry : sorted)
+    {
+        const NodeTimings& t = entry.second;
+        cout << left << setw(32) << nodeTree.nodeName(entry.first) << right
+             << setw(10) << t.calls << fixed << setprecision(3)
+             << setw(14) << (t.calls > 0 ? t.total / t.calls : 0.0)
+             << setw(14) << t.max << setw(14) << t.total;
+        if(hasDeviceTimes)
+            cout << setw(16) << (t.calls > 0 ? t.device / t.calls : 0.0);
+        cout << "\n";
+    }
+
+    double fps = totalTime > 0.0 ? frames / (totalTime * 1e-3) : 0.0;
+    cout << "\nProcessed " << frames << " frame(s) in " << fixed << setprecision(3)
+         << totalTime << " ms (" << setprecision(2) << fps << " FPS)" << endl;
+
+    ImageBufferPool::Statistics pool = nodeTree.bufferPool().statistics();
+    cout << "Buffer pool: " << pool.hits << " hit(s), " << pool.misses << " miss(es), "
+         << pool.buffers << " buffer(s), " << setprecision(1)
+         << pool.bytes / (1024.0 * 1024.0) << " MB" << endl;
+    cout << "Flow data copied: " << bytesCopied << " byte(s)";
+    if(frames > 0)
+        cout << " (" << bytesCopied / frames << " per frame)";
+    cout << endl;
+}
+
+int run(const Options& options)
+{
+    NodeSystem nodeSystem;
+    shared_ptr<IGpuNodeModule> gpuModule;
+
+    if(options.useGpu)
+    {
+        gpuModule = createGpuModule();
+        if(gpuModule)
+        {
+            gpuModule->setInteractiveInit(false); // Just use default device
+            gpuModule->setProfilingEnabled(options.gpuProfiling 
+                || !options.profilePath.empty() || !options.tracePath.empty());
+            nodeSystem.registerNodeModule(gpuModule);
+        }
+    }
+
+    loadPlugins(nodeSystem, options.plugins);
+
+    shared_ptr<NodeTree> nodeTree = nodeSystem.createNodeTree();
+    NodeTreeSerializer nodeTreeSerializer;
+    nodeTreeSerializer.deserializeFromFile(*nodeTree, options.treePath);
+    for(const auto& warning : nodeTreeSerializer.warnings())
+        cerr << "Warning: " << warning << endl;
+
+    // Build kernels of loaded GPU nodes now instead of during first frame
+    if(gpuModule && options.warmUp)
+    {
+        gpuModule->warmUp(true, [](const GpuProgramBuildInfo& buildInfo,
+                                   size_t builtCount, size_t totalCount) {
+            cout << "[" << builtCount << "/" << totalCount << "] " << buildInfo.programName;
+            if(!buildInfo.options.empty())
+                cout << " (" << buildInfo.options << ")";
+            cout << ": " << fixed << setprecision(1) << buildInfo.elapsed << " ms" << endl;
+            if(!buildInfo.built)
+                cerr << "Warning: couldn't build " << buildInfo.programName << ":\n"
+                     << buildInfo.log << endl;
+        });
+    }
+
+    nodeTree->setParallelExecution(options.parallel);
+    nodeTree->setPipelinedExecution(options.pipelined);
+    nodeTree->setProfilingEnabled(!options.profilePath.empty() || !options.tracePath.empty());
+
+    NodeResolver resolver(nodeTree);
+
+    for(const auto& assignment : options.properties)
+        overrideProperty(*nodeTree, resolver, assignment);
+
+    vector<SocketAddress> outputs;
+    for(const auto& uri : options.outputs)
+    {
+        SocketAddress addr = resolver.resolveSocketAddress(uri);
+        if(!addr.isValid() || !addr.isOutput)
+            throw invalid_argument(string_format("No such output socket: %s", uri.c_str()));
+        outputs.push_back(addr);
+    }
+
+    // Feed input to the source node
+    vector<string> images;
+    NodeID sourceID = InvalidNodeID;
+    PropertyID sourcePathID = InvalidPropertyID;
+
+    if(!options.input.empty())
+    {
+        sourceID = findSourceNode(*nodeTree, resolver, options.sourceNode);
+        if(sourceID == InvalidNodeID)
+            throw invalid_argument("Couldn't find source node for the input");
+
+        images = listImages(options.input);
+        PropertyID videoPathID = resolver.resolveProperty(sourceID, "Video path");
+        sourcePathID = resolver.resolveProperty(sourceID, "File path");
+
+        // Video is fed once, images one by one
+        if(images.empty() && videoPathID != InvalidPropertyID)
+            sourcePathID = videoPathID;
+        else if(images.empty())
+            images.push_back(options.input);
+
+        if(sourcePathID == InvalidPropertyID)
+        {
+            throw invalid_argument(string_format("Node %s can't be fed with %s",
+                nodeTree->nodeName(sourceID).c_str(), options.input.c_str()));
+        }
+
+        if(images.empty())
+        {
+            nodeTree->nodeSetProperty(sourceID, sourcePathID, Filepath{options.input});
+            nodeTree->tagNode(sourceID);
+        }
+    }
+
+    map<NodeID, NodeTimings> timings;
+    vector<std::uint64_t> savedFrames(outputs.size(), 0);
+    std::uint64_t bytesCopied = 0;
+    bool withInit = true;
+    int frame = 0;
+    HighResolutionClock::time_point start = HighResolutionClock::now();
+
+    while(options.frames <= 0 || frame < options.frames)
+    {
+        if(!images.empty())
+        {
+            if(frame >= static_cast<int>(images.size()))
+                break;
+            nodeTree->nodeSetProperty(sourceID, sourcePathID, Filepath{images[frame]});
+            nodeTree->tagNode(sourceID);
+        }
+        else if(!withInit && nodeTree->prepareList().empty())
+        {
+            // No more data
+            break;
+        }
+
+        nodeTree->execute(withInit);
+        withInit = false;
+        bytesCopied += nodeTree->bytesCopied();
+
+        collectTimings(*nodeTree, timings);
+        saveOutputs(*nodeTree, resolver, outputs, savedFrames, options.outputDir);
+        ++frame;
+    }
+
+    // Last frame is still pending in downstream stage of pipelined tree
+    nodeTree->flushPipeline();
+    bytesCopied += nodeTree->bytesCopied();
+    collectTimings(*nodeTree, timings);
+    saveOutputs(*nodeTree, resolver, outputs, savedFrames, options.outputDir);
+    double totalTime = convertToMilliseconds(HighResolutionClock::now() - start);
+    nodeTree->notifyFinish();
+
+    printTimings(*nodeTree, timings, frame, totalTime, bytesCopied);
+
+    if(!options.profilePath.empty())
+        nodeTree->profiler()->saveJson(options.profilePath);
+    if(!options.tracePath.empty())
+        nodeTree->profiler()->saveChromeTrace(options.tracePath);
+
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        Options options;
+        if(!parseOptions(argc, argv, options))
+        {
+            printUsage();
+            return 1;
+        }
+
+        return run(options);
+    }
+    catch(ExecutionError& ex)
+    {
+        cerr << "Execution error in:\nNode: " << ex.nodeName << "\n"
+            "Node typename: " << ex.nodeTypeName << "\n\nError message:\n" << ex.errorMessage << endl;
+    }
+    catch(BadConnectionException& ex)
+    {
+        cerr << "Bad connection at node " << ex.node << ", socket " << int(ex.socket) << endl;
+    }
+    catch(exception& ex)
+    {
+        cerr << ex.what() << endl;
+    }
+
+    return 1;
+}
@@ -103,6 +103,7 @@ Controller::Controller(QWidget* parent, Qt::WindowFlags flags)
     , _treeWorker(new TreeWorker())
     , _progressBar(nullptr)
     , _gpuModule(createGpuModule())
+    , _actionGpuProfiling(nullptr)
     , _jaiModule(createJaiModule())
     , _ui(new Ui::MainWindow())
     , _previewWidget(nullptr)
@@ -923,6 +924,8 @@ void Controller::switchToVideoMode()
     _ui->actionPause->setEnabled(false);
     _ui->actionStop->setEnabled(false);
 
+    // Hashing every frame would only slow down stream processing
+    _nodeTree->setMemoizationEnabled(false);
     _videoMode = true;
 }
 
@@ -936,6 +939,7 @@ void Controller::switchToImageMode()
     _ui->actionPause->setEnabled(false);
     _ui->actionStop->setEnabled(false);
 
+    _nodeTree->setMemoizationEnabled(true);
     _videoMode = false;
 }
 
@@ -1035,6 +1039,22 @@ void Controller::updatePreviewImpl()
                     _previewWidget->show(outputData.getImageRgb());
                     return;
 
+#if defined(HAVE_OPENCL)
+                // Downloaded on demand, host copy is kept until node is executed again
+                case ENodeFlowDataType::DeviceImage:
+                case ENodeFlowDataType::DeviceImageMono:
+                case ENodeFlowDataType::DeviceImageRgb:
+                    try
+                    {
+                        _previewWidget->show(outputData.getImage());
+                        return;
+                    }
+                    catch(std::exception&)
+                    {
+                    }
+                    break;
+#endif
+
                 default:
                     break;
                 }
@@ -1083,6 +1103,10 @@ void Controller::setInteractive(bool allowed)
 #if defined(HAVE_JAI)
     _actionDevices->setEnabled(allowed);
 #endif
+
+    // Command queues can't be recreated while the tree is being executed
+    if(_actionGpuProfiling)
+        _actionGpuProfiling->setEnabled(allowed);
 }
 
 void Controller::updateTitleBar()
@@ -1152,6 +1176,7 @@ void Controller::createNewNodeScene()
 {
     // Create new tree model
     _nodeTree = _nodeSystem->createNodeTree();
+    _nodeTree->setMemoizationEnabled(!_videoMode);
     _treeWorker->setNodeTree(_nodeTree);
 
     // Create new tree view (node scene)
@@ -1259,6 +1284,7 @@ bool Controller::openTreeFromFile(const QString& filePath)
         updateRecentFileActions(filePath);
         updateTitleBar();
         fitToView();
+        warmUpGpuModule();
 
         qDebug() << "Node tree successfully opened and read from file:" << filePath;
     }
@@ -1865,6 +1891,9 @@ void Controller::updatePreview(bool res)
         totalTimeElapsed += elapsed;
         QString text = QString::number(elapsed, 'f', 3);
         text += QStringLiteral(" ms");
+        double deviceElapsed = _nodeTree->nodeDeviceTimeElapsed(nodeID);
+        if(deviceElapsed > 0.0)
+            text += QString(" (device: %1 ms)").arg(QString::number(deviceElapsed, 'f', 3));
         _nodeViews[nodeID]->setTimeInfo(text);
     }
 
@@ -2169,9 +2198,14 @@ void Controller::initGpuModule(QMenu* menuModules)
 
     _actionInteractiveSetup = new QAction(QStringLiteral("Init module"), this);
     _actionListPrograms = new QAction(QStringLiteral("List programs"), this);
+    _actionGpuProfiling = new QAction(QStringLiteral("Measure device time"), this);
+    _actionGpuProfiling->setCheckable(true);
+    _actionGpuProfiling->setChecked(_gpuModule->isProfilingEnabled());
 
     connect(_actionListPrograms, &QAction::triggered,
         this, &Controller::showProgramsList);
+    connect(_actionGpuProfiling, &QAction::toggled, 
+        [=](bool checked) { _gpuModule->setProfilingEnabled(checked); });
     connect(_actionInteractiveSetup, &QAction::triggered,
         [=]
     {
@@ -2202,6 +2236,7 @@ void Controller::initGpuModule(QMenu* menuModules)
     auto menuGpu = menuModules->addMenu("GPU");
     menuGpu->addAction(_actionInteractiveSetup);
     menuGpu->addAction(_actionListPrograms);
+    menuGpu->addAction(_actionGpuProfiling);
 }
 
 void Controller::showProgramsList()
@@ -2313,6 +2348,48 @@ void Controller::showProgramsList()
     dialog.exec();
 }
 
+void Controller::warmUpGpuModule()
+{
+    if(!_gpuModule || !_gpuModule->isInitialized())
+        return;
+
+    QProgressDialog	progress;
+    progress.setLabel(new QLabel("Building OpenCL programs...", &progress));
+    progress.setCancelButton(nullptr);
+    progress.setRange(0, 0);
+    progress.setWindowModality(Qt::ApplicationModal);
+
+    std::vector<GpuProgramBuildInfo> buildInfos;
+    std::thread buildThread([&] {
+        buildInfos = _gpuModule->warmUp(true, [&](const GpuProgramBuildInfo& buildInfo,
+                                                 size_t builtCount, size_t totalCount) {
+            QMetaObject::invokeMethod(&progress, "setMaximum", Qt::QueuedConnection, 
+                Q_ARG(int, int(totalCount)));
+            QMetaObject::invokeMethod(&progress, "setValue", Qt::QueuedConnection,
+                Q_ARG(int, int(builtCount)));
+            Q_UNUSED(buildInfo);
+        });
+        QMetaObject::invokeMethod(&progress, "close", Qt::QueuedConnection);
+    });
+
+    progress.exec();
+    buildThread.join(); // when user forced progress dialog to be closed
+
+    for(const auto& buildInfo : buildInfos)
+    {
+        if(buildInfo.built)
+        {
+            qDebug() << "Built OpenCL program" << buildInfo.programName.c_str() 
+                << buildInfo.options.c_str() << "in" << buildInfo.elapsed << "ms";
+        }
+        else
+        {
+            qWarning() << "Couldn't build OpenCL program" << buildInfo.programName.c_str()
+                << buildInfo.options.c_str() << ":" << buildInfo.log.c_str();
+        }
+    }
+}
+
 /// TODO: Move to separate file
 #include "ui_Camera.h"
 
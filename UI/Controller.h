@@ -217,9 +217,11 @@ private:
     std::shared_ptr<IGpuNodeModule> _gpuModule;
     QAction* _actionListPrograms;
     QAction* _actionInteractiveSetup;
+    QAction* _actionGpuProfiling;
 
     void showProgramsList();
     void initGpuModule(QMenu* menuModules);
+    void warmUpGpuModule();
 
     //
     // JAI Module